@@ -82,7 +82,7 @@ namespace graphene { namespace app {
     {
        if( api_name == "database_api" )
        {
-          _database_api = std::make_shared< database_api >( std::ref( *_app.chain_database() ) );
+          _database_api = std::make_shared< database_api >( std::ref( *_app.chain_database() ), _app.listing_feed(), _app.subscriptions() );
        }
        else if( api_name == "block_api" )
        {
@@ -333,6 +333,52 @@ namespace graphene { namespace app {
        return result;
     }
 
+    namespace {
+
+    /**
+     * Get operations from a range of account history index ordered by (account, value, sequence), going from
+     * most recent ones. Like get_account_history(), returns operations with IDs from start down to, but not including,
+     * stop, where default start means the most recent operation and default stop means the very first one.
+     */
+    template<typename Index, typename Value>
+    vector<operation_history_object> get_account_history_range( const database& db,
+                                                                const Index& idx,
+                                                                const account_id_type account,
+                                                                const Value value,
+                                                                const operation_history_id_type start,
+                                                                const operation_history_id_type stop,
+                                                                const unsigned limit )
+    {
+       vector<operation_history_object> result;
+
+       // Operation IDs grow together with account history sequence, so find sequence of the start operation.
+       uint32_t start_sequence = std::numeric_limits<uint32_t>::max();
+       if( start != operation_history_id_type() )
+       {
+          const auto& by_op_idx = db.get_index_type<account_transaction_history_index>().indices().get<by_op>();
+          auto start_itr = by_op_idx.upper_bound( boost::make_tuple( account, start ) );
+          if( start_itr == by_op_idx.begin() )
+             return result;
+          --start_itr;
+          if( start_itr->account != account )
+             return result;
+          start_sequence = start_itr->sequence;
+       }
+
+       const auto begin = idx.lower_bound( boost::make_tuple( account, value ) );
+       auto itr = idx.upper_bound( boost::make_tuple( account, value, start_sequence ) );
+       while( itr != begin && result.size() < limit )
+       {
+          --itr;
+          if( stop != operation_history_id_type() && itr->operation_id.instance.value <= stop.instance.value )
+             break;
+          result.push_back( itr->operation_id(db) );
+       }
+       return result;
+    }
+
+    } // anonymous namespace
+
     vector<operation_history_object> history_api::get_account_history( account_id_type account,
                                                                        operation_history_id_type stop,
                                                                        unsigned limit,
@@ -374,30 +420,8 @@ namespace graphene { namespace app {
        FC_ASSERT( _app.chain_database() );
        const auto& db = *_app.chain_database();
        FC_ASSERT( limit <= 100 );
-       vector<operation_history_object> result;
-       const auto& stats = account(db).statistics(db);
-       if( stats.most_recent_op == account_transaction_history_id_type() ) return result;
-       const account_transaction_history_object* node = &stats.most_recent_op(db);
-       if( start == operation_history_id_type() )
-          start = node->operation_id;
-
-       while(node && node->operation_id.instance.value > stop.instance.value && result.size() < limit)
-       {
-          if( node->operation_id.instance.value <= start.instance.value ) {
-
-             if(node->operation_id(db).op.which() == operation_id)
-               result.push_back( node->operation_id(db) );
-             }
-          if( node->next == account_transaction_history_id_type() )
-             node = nullptr;
-          else node = &node->next(db);
-       }
-       if( stop.instance.value == 0 && result.size() < limit ) {
-           node = db.find(account_transaction_history_id_type());
-           if( node && node->account == account && node->operation_id(db).op.which() == operation_id )
-              result.push_back(node->operation_id(db));
-       }
-       return result;
+       const auto& by_type_idx = db.get_index_type<account_transaction_history_index>().indices().get<by_type_seq>();
+       return get_account_history_range( db, by_type_idx, account, int32_t(operation_id), start, stop, limit );
     }
 
 
@@ -495,73 +519,10 @@ namespace graphene { namespace app {
             FC_ASSERT( _app.chain_database() );
             FC_ASSERT( limit <= 100 );
 
-            vector<operation_history_object> result;
-
             const auto& db = *_app.chain_database();
-            const auto& stats = account_id(db).statistics(db);
-
-            // Most recent operation is null, nothing to return.
-            if( stats.most_recent_op == account_transaction_history_id_type() )
-            {
-                return result;
-            }
-
-            const account_transaction_history_object* node = &stats.most_recent_op(db);
-            // If start is not specified, set it to most recent operation.
-            if( start == operation_history_id_type() )
-            {
-                start = node->operation_id;
-            }
-
-            // Check if current node represents a sale operation.
-            const auto is_purchase = [&node, &db, account_id, is_buyer]{
-                const operation_history_object op_history = node->operation_id(db);
-                const bool is_transfer_sale = (op_history.op.which() == operation::tag<transfer_operation>::value)
-                        && op_history.op.get<transfer_operation>().listing.valid()
-                        && (
-                            (is_buyer && (op_history.op.get<transfer_operation>().from == account_id))
-                            || (!is_buyer && (op_history.op.get<transfer_operation>().to == account_id))
-                            );
-                const bool is_escrow_sale = (op_history.op.which() == operation::tag<omnibazaar::escrow_create_operation>::value)
-                        && op_history.op.get<omnibazaar::escrow_create_operation>().listing.valid()
-                        && (
-                            (is_buyer && (op_history.op.get<omnibazaar::escrow_create_operation>().buyer == account_id))
-                            || (!is_buyer && (op_history.op.get<omnibazaar::escrow_create_operation>().seller == account_id))
-                            );
-                        ;
-                return is_transfer_sale || is_escrow_sale;
-            };
-
-            // Traverse the list of operations starting from most recent and back.
-            while( node && node->operation_id.instance.value > stop.instance.value && result.size() < limit )
-            {
-                if( node->operation_id.instance.value <= start.instance.value )
-                {
-                    if( is_purchase() )
-                    {
-                        result.push_back( node->operation_id(db) );
-                    }
-                }
-                if( node->next == account_transaction_history_id_type() )
-                {
-                    node = nullptr;
-                }
-                else
-                {
-                    node = &node->next(db);
-                }
-            }
-
-            if( stop.instance.value == 0 && result.size() < limit )
-            {
-                node = db.find(account_transaction_history_id_type());
-                if( node && (node->account == account_id) && is_purchase() )
-                {
-                    result.push_back( node->operation_id(db) );
-                }
-            }
-
-            return result;
+            const uint8_t role = is_buyer ? marketplace_role_buyer : marketplace_role_seller;
+            const auto& by_role_idx = db.get_index_type<account_transaction_history_index>().indices().get<by_role_seq>();
+            return get_account_history_range( db, by_role_idx, account_id, role, start, stop, limit );
         }
         FC_CAPTURE_AND_RETHROW( (account_id) );
     }
@@ -51,6 +51,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include <iostream>
+#include <thread>
 
 #include <fc/log/file_appender.hpp>
 #include <fc/log/logger.hpp>
@@ -62,6 +63,7 @@
 
 #include <../omnibazaar/mail_storage.hpp>
 #include <../omnibazaar/mail_controller.hpp>
+#include <../omnibazaar/listing_feed.hpp>
 
 namespace graphene { namespace app {
 using net::item_hash_t;
@@ -228,6 +230,8 @@ namespace detail {
                                               _chain_db->head_block_id()),
                                  std::vector<uint32_t>());
 		 _p2p_network->initialize_mail_sender();
+         if( _options->count("mail-targeted-routing") )
+            _p2p_network->mail_set_targeted_routing( _options->at("mail-targeted-routing").as<bool>() );
       } FC_CAPTURE_AND_RETHROW() }
 
       std::vector<fc::ip::endpoint> resolve_string_to_ip_endpoints(const std::string& endpoint_string)
@@ -406,6 +410,27 @@ namespace detail {
          }
          _chain_db->add_checkpoints( loaded_checkpoints );
 
+         if( _options->count("block-log-sync-interval") )
+            _chain_db->set_block_log_sync_interval( _options->at("block-log-sync-interval").as<uint32_t>() );
+
+         if( _options->count("packed-undo") )
+            _chain_db->set_packed_undo_values( _options->at("packed-undo").as<bool>() );
+
+         if( _options->count("worker-threads") )
+         {
+            uint32_t threads = _options->at("worker-threads").as<uint32_t>();
+            _chain_db->set_worker_threads( threads > 0 ? threads : std::max( 1u, std::thread::hardware_concurrency() ) );
+         }
+
+         if( _options->count("signature-cache-size") )
+            graphene::chain::set_signature_cache_capacity( _options->at("signature-cache-size").as<uint32_t>() );
+
+         if( _options->count("check-vote-weights") )
+            _chain_db->set_check_vote_weights( _options->at("check-vote-weights").as<bool>() );
+
+         if( _options->count("fork-db-size") )
+            _chain_db->set_fork_db_max_bytes( uint64_t(_options->at("fork-db-size").as<uint32_t>()) * 1024 * 1024 );
+
          if( _options->count("replay-blockchain") )
             _chain_db->wipe( _data_dir / "blockchain", false );
 
@@ -419,6 +444,9 @@ namespace detail {
             throw;
          }
 
+         _listing_feed = std::make_shared<omnibazaar::listing_feed>( std::ref(*_chain_db), _options->at("listing-feed-size").as<uint32_t>() );
+         _subscriptions = std::make_shared<subscription_dispatcher>( std::ref(*_chain_db) );
+
          if( _options->count("force-validate") )
          {
             ilog( "All transaction signatures will be validated" );
@@ -928,6 +956,8 @@ namespace detail {
 
       std::shared_ptr<omnibazaar::mail_storage> _mail_storage;
       std::shared_ptr<omnibazaar::mail_controller> _mail_controller;
+      std::shared_ptr<omnibazaar::listing_feed> _listing_feed;
+      std::shared_ptr<subscription_dispatcher> _subscriptions;
    };
 
 }
@@ -970,6 +1000,23 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("api-access", bpo::value<boost::filesystem::path>(), "JSON file specifying API permissions")
          ("plugins", bpo::value<string>(), "Space-separated list of plugins to activate")
          ("mail-dir", bpo::value<boost::filesystem::path>()->implicit_value("mails"), "Folder name for storing mails")
+         ("mail-targeted-routing", bpo::bool_switch()->default_value(false),
+          "Send mails only to peers which advertised that mail recipient is subscribed on them, if there are any")
+         ("block-log-sync-interval", bpo::value<uint32_t>()->default_value(1000),
+          "Number of stored blocks after which block log is synced to disk, 0 to sync only on shutdown")
+         ("packed-undo", bpo::bool_switch()->default_value(false),
+          "Keep old object values in undo history packed instead of full copies, using less memory but more CPU")
+         ("worker-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads recovering transaction signature keys before transactions are applied and tallying votes "
+          "during maintenance, 0 to use number of CPU cores")
+         ("signature-cache-size", bpo::value<uint32_t>()->default_value(10000),
+          "Number of public keys recovered from transaction signatures kept in memory, 0 to disable the cache")
+         ("check-vote-weights", bpo::bool_switch()->default_value(false),
+          "Tally stake of all accounts every maintenance and log an error if it differs from incrementally maintained vote weights")
+         ("fork-db-size", bpo::value<uint32_t>()->default_value(256),
+          "Megabytes of blocks from competing forks kept in memory, 0 for no limit")
+         ("listing-feed-size", bpo::value<uint32_t>()->default_value(100000),
+          "Number of recent listing changes kept in memory for publishers to resume listing change feed")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -1153,5 +1200,15 @@ std::shared_ptr<omnibazaar::mail_controller> application::mail_controller()const
     return my->_mail_controller;
 }
 
+std::shared_ptr<omnibazaar::listing_feed> application::listing_feed()const
+{
+    return my->_listing_feed;
+}
+
+std::shared_ptr<subscription_dispatcher> application::subscriptions()const
+{
+    return my->_subscriptions;
+}
+
 // namespace detail
 } }
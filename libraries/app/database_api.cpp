@@ -25,7 +25,6 @@
 #include <graphene/app/database_api.hpp>
 #include <graphene/chain/get_config.hpp>
 
-#include <fc/bloom_filter.hpp>
 #include <fc/smart_ref_impl.hpp>
 
 #include <fc/crypto/hex.hpp>
@@ -36,6 +35,7 @@
 #include <boost/multiprecision/cpp_int.hpp>
 
 #include <cctype>
+#include <limits>
 
 #include <cfenv>
 #include <iostream>
@@ -54,7 +54,8 @@ class database_api_impl;
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 {
    public:
-      database_api_impl( graphene::chain::database& db );
+      database_api_impl( graphene::chain::database& db, std::shared_ptr<omnibazaar::listing_feed> listing_feed,
+                         std::shared_ptr<subscription_dispatcher> dispatcher );
       ~database_api_impl();
 
 
@@ -81,6 +82,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       dynamic_global_property_object get_dynamic_global_properties()const;
       omnibazaar::reserved_names_object get_reserved_names()const;
       account_id_type get_founder_account()const;
+      vector<undo_level_usage> get_undo_memory_usage()const;
+      signature_cache_stats get_signature_cache_stats()const;
 
       // Keys
       vector<vector<account_id_type>> get_key_references( vector<public_key_type> key )const;
@@ -96,8 +99,43 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       uint64_t get_account_count()const;
       std::vector<std::string> get_publisher_nodes_names();
       vector<account_object_name> filter_current_escrows(uint32_t start, uint32_t limit, const std::string& search_term) const;
+      vector<account_object_name> search_escrows(const string& search_term, const bool substring,
+                                                 const string& start_name, const uint32_t limit) const;
+      vector<account_object_name> list_escrows_by_score(const optional<account_id_type>& start, const uint32_t limit) const;
 	  uint32_t get_number_of_escrows() const;
       map<string,uint64_t> list_account_reputation_votes(const uint64_t start, const uint32_t limit) const;
+      vector<account_rank> list_ranked_accounts(const account_ranking ranking, const uint64_t start, const uint32_t limit) const;
+      account_rank get_account_rank(const account_ranking ranking, const account_id_type account) const;
+
+      // Accounts ranking helpers for ranked account indices, which are sorted in ascending order.
+      template<typename Tag, typename Value>
+      vector<account_rank> list_ranked_accounts(const uint64_t start, const uint32_t limit, const Value& value) const
+      {
+         FC_ASSERT( limit <= 1000 );
+
+         vector<account_rank> result;
+         const auto& idx = _db.get_index_type<account_index>().indices().get<Tag>();
+         if( start >= idx.size() )
+            return result;
+
+         auto iter = idx.nth( idx.size() - 1 - start );
+         for( uint64_t rank = start; result.size() < limit; ++rank )
+         {
+            result.push_back( account_rank{ iter->id, iter->name, value(*iter), rank } );
+            if( iter == idx.begin() )
+               break;
+            --iter;
+         }
+         return result;
+      }
+
+      template<typename Tag, typename Value>
+      account_rank get_account_rank(const account_id_type account, const Value& value) const
+      {
+         const account_object& obj = account(_db);
+         const auto& idx = _db.get_index_type<account_index>().indices().get<Tag>();
+         return account_rank{ obj.id, obj.name, value(obj), idx.size() - 1 - idx.rank( idx.iterator_to(obj) ) };
+      }
       vector<account_statistics_object> get_account_statistics(const vector<account_id_type> &accounts) const;
 
       // Balances
@@ -168,52 +206,67 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       share_type get_welcome_bonus_amount()const;
       bool is_referral_bonus_available()const;
       bool is_sale_bonus_available(const account_id_type& seller_id, const account_id_type& buyer_id)const;
+      vector<account_id_type> get_seller_buyers(const account_id_type seller_id, const account_id_type start, const uint32_t limit)const;
 
       // Escrows
       vector<omnibazaar::escrow_object> get_escrow_objects( const string& account_name )const;
       set<account_id_type> get_implicit_escrows(const account_id_type target_account_id);
+      vector<account_id_type> get_account_escrows(const account_id_type account_id, const account_id_type start, const uint32_t limit)const;
 
       // Marketplace
       bool check_listing_exists( const listing_id_type &id )const;
       vector<omnibazaar::listing_object> get_listings_by_seller(const string& seller_name);
       uint64_t get_listings_count()const;
+      vector<listing_summary> get_seller_listings(const account_id_type seller, const listing_id_type start, const uint32_t limit)const;
+      vector<listing_summary> get_publisher_listings(const account_id_type publisher, const listing_id_type start, const uint32_t limit)const;
+      vector<listing_summary> get_seller_listings_by_update_time(const account_id_type seller, const time_point_sec start_time,
+                                                                 const listing_id_type start, const uint32_t limit)const;
+      vector<listing_summary> get_publisher_listings_by_update_time(const account_id_type publisher, const time_point_sec start_time,
+                                                                    const listing_id_type start, const uint32_t limit)const;
+      vector<listing_summary> get_listings_by_update_time(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const;
+      vector<listing_summary> get_listings_by_expiration(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const;
+      vector<listing_summary> get_listings_by_price(const asset_id_type asset_id, const share_type min_amount, const share_type max_amount,
+                                                    const listing_id_type start, const uint32_t limit)const;
+      vector<listing_summary> get_listings_by_priority_fee(const uint16_t min_priority_fee, const listing_id_type start, const uint32_t limit)const;
+      vector<omnibazaar::listing_change> get_listing_changes(const account_id_type publisher, const uint32_t start_block,
+                                                             const uint32_t start_op, const uint32_t limit)const;
+      void subscribe_to_listing_changes(std::function<void(const variant&)> callback, const account_id_type publisher,
+                                        const uint32_t start_block, const uint32_t start_op);
+      void unsubscribe_from_listing_changes(const account_id_type publisher);
+
+      // Get up to limit listings from index starting at lower_bound, while they satisfy in_range predicate.
+      template<typename Tag, typename Key, typename Predicate>
+      vector<listing_summary> get_listings_page(const Key& lower_bound, const Predicate& in_range, const uint32_t limit)const
+      {
+         FC_ASSERT( limit <= 100 );
+
+         vector<listing_summary> result;
+         const auto& index = _db.get_index_type<omnibazaar::listing_index>().indices().get<Tag>();
+         for(auto iter = index.lower_bound(lower_bound);
+             result.size() < limit && iter != index.end() && in_range(*iter);
+             ++iter)
+         {
+            result.emplace_back(*iter);
+         }
+         return result;
+      }
 
       // Exchange
       vector<omnibazaar::exchange_object> lookup_exchange_objects(const exchange_id_type lower_bound_id, uint32_t limit);
       vector<omnibazaar::exchange_object> lookup_exchange_objects_by_currency(const string currency, const exchange_id_type lower_bound_id, uint32_t limit);
 
    //private:
-      template<typename T>
-      void subscribe_to_item( const T& i )const
+      // Only object ids are matched against changed objects.
+      void subscribe_to_item( const object_id_type& id )const
       {
-         auto vec = fc::raw::pack(i);
-         if( !_subscribe_callback )
-            return;
-
-         if( !is_subscribed_to_item(i) )
-         {
-            idump((i));
-            _subscribe_filter.insert( vec.data(), vec.size() );//(vecconst char*)&i, sizeof(i) );
-         }
+         if( _subscriber.valid() )
+            _dispatcher->subscribe_to_object( *_subscriber, id );
       }
 
-      template<typename T>
-      bool is_subscribed_to_item( const T& i )const
+      template<uint8_t SpaceID, uint8_t TypeID, typename T>
+      void subscribe_to_item( const object_id<SpaceID,TypeID,T>& id )const
       {
-         if( !_subscribe_callback )
-            return false;
-
-         return _subscribe_filter.contains( i );
-      }
-
-      bool is_impacted_account( const flat_set<account_id_type>& accounts)
-      {
-         if( !_subscribed_accounts.size() || !accounts.size() )
-            return false;
-
-         return std::any_of(accounts.begin(), accounts.end(), [this](const account_id_type& account) {
-            return _subscribed_accounts.find(account) != _subscribed_accounts.end();
-         });
+         subscribe_to_item( object_id_type(id) );
       }
 
       template<typename T>
@@ -230,20 +283,19 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
          }
       }
 
-      void broadcast_updates( const vector<variant>& updates );
       void broadcast_market_updates( const market_queue_type& queue);
-      void handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object);
+      // Object subscriptions are served by _dispatcher, this only handles market subscriptions.
+      void handle_object_changed(bool full_object, const vector<object_id_type>& ids, std::function<const object*(object_id_type id)> find_object);
 
       /** called every time a block is applied to report the objects that were changed */
       void on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
       void on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
       void on_objects_removed(const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts);
       void on_applied_block();
+      void on_listing_changes(const vector<omnibazaar::listing_change>& changes);
 
-      bool _notify_remove_create = false;
-      mutable fc::bloom_filter _subscribe_filter;
-      std::set<account_id_type> _subscribed_accounts;
-      std::function<void(const fc::variant&)> _subscribe_callback;
+      std::shared_ptr<subscription_dispatcher> _dispatcher;
+      optional<subscription_dispatcher::subscriber_id_type> _subscriber;
       std::function<void(const fc::variant&)> _pending_trx_callback;
       std::function<void(const fc::variant&)> _block_applied_callback;
 
@@ -253,6 +305,9 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       boost::signals2::scoped_connection                                                                                           _applied_block_connection;
       boost::signals2::scoped_connection                                                                                           _pending_trx_connection;
       map< pair<asset_id_type,asset_id_type>, std::function<void(const variant&)> >      _market_subscriptions;
+      std::shared_ptr<omnibazaar::listing_feed>                                           _listing_feed;
+      boost::signals2::scoped_connection                                                  _listing_changes_connection;
+      map< account_id_type, std::function<void(const variant&)> >                         _listing_subscriptions;
       graphene::chain::database&                                                                                                            _db;
 };
 
@@ -262,13 +317,19 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 //                                                                  //
 //////////////////////////////////////////////////////////////////////
 
-database_api::database_api( graphene::chain::database& db )
-   : my( new database_api_impl( db ) ) {}
+database_api::database_api( graphene::chain::database& db, std::shared_ptr<omnibazaar::listing_feed> listing_feed,
+                            std::shared_ptr<subscription_dispatcher> dispatcher )
+   : my( new database_api_impl( db, listing_feed, dispatcher ) ) {}
 
 database_api::~database_api() {}
 
-database_api_impl::database_api_impl( graphene::chain::database& db ):_db(db)
+database_api_impl::database_api_impl( graphene::chain::database& db, std::shared_ptr<omnibazaar::listing_feed> listing_feed,
+                                      std::shared_ptr<subscription_dispatcher> dispatcher )
+   :_dispatcher(dispatcher), _listing_feed(listing_feed), _db(db)
 {
+   if( !_dispatcher )
+      _dispatcher = std::make_shared<subscription_dispatcher>( std::ref(_db) );
+
    wlog("creating database api ${x}", ("x",int64_t(this)) );
    _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) {
                                 on_objects_new(ids, impacted_accounts);
@@ -284,11 +345,17 @@ database_api_impl::database_api_impl( graphene::chain::database& db ):_db(db)
    _pending_trx_connection = _db.on_pending_transaction.connect([this](const signed_transaction& trx ){
                          if( _pending_trx_callback ) _pending_trx_callback( fc::variant(trx) );
                       });
+   if( _listing_feed )
+      _listing_changes_connection = _listing_feed->changes_applied.connect([this](const vector<omnibazaar::listing_change>& changes){
+                                on_listing_changes(changes);
+                                });
 }
 
 database_api_impl::~database_api_impl()
 {
    elog("freeing database api ${x}", ("x",int64_t(this)) );
+   if( _subscriber.valid() )
+      _dispatcher->remove_subscriber( *_subscriber );
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -304,7 +371,7 @@ fc::variants database_api::get_objects(const vector<object_id_type>& ids)const
 
 fc::variants database_api_impl::get_objects(const vector<object_id_type>& ids)const
 {
-   if( _subscribe_callback )  {
+   if( _subscriber.valid() )  {
       for( auto id : ids )
       {
          if( id.type() == operation_history_object_type && id.space() == protocol_ids ) continue;
@@ -340,17 +407,12 @@ void database_api::set_subscribe_callback( std::function<void(const variant&)> c
 
 void database_api_impl::set_subscribe_callback( std::function<void(const variant&)> cb, bool notify_remove_create )
 {
-   //edump((clear_filter));
-   _subscribe_callback = cb;
-   _notify_remove_create = notify_remove_create;
-   _subscribed_accounts.clear();
+   if( _subscriber.valid() )
+      _dispatcher->remove_subscriber( *_subscriber );
+   _subscriber.reset();
 
-   static fc::bloom_parameters param;
-   param.projected_element_count    = 10000;
-   param.false_positive_probability = 1.0/100;
-   param.maximum_size = 1024*8*8*2;
-   param.compute_optimal_parameters();
-   _subscribe_filter = fc::bloom_filter(param);
+   if( cb )
+      _subscriber = _dispatcher->add_subscriber( cb, notify_remove_create );
 }
 
 void database_api::set_pending_transaction_callback( std::function<void(const variant&)> cb )
@@ -382,6 +444,7 @@ void database_api_impl::cancel_all_subscriptions()
 {
    set_subscribe_callback( std::function<void(const fc::variant&)>(), true);
    _market_subscriptions.clear();
+   _listing_subscriptions.clear();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -525,6 +588,26 @@ account_id_type database_api_impl::get_founder_account()const
     return _db.get_founder_account();
 }
 
+vector<undo_level_usage> database_api::get_undo_memory_usage()const
+{
+    return my->get_undo_memory_usage();
+}
+
+vector<undo_level_usage> database_api_impl::get_undo_memory_usage()const
+{
+    return _db._undo_db.get_memory_usage();
+}
+
+signature_cache_stats database_api::get_signature_cache_stats()const
+{
+    return my->get_signature_cache_stats();
+}
+
+signature_cache_stats database_api_impl::get_signature_cache_stats()const
+{
+    return graphene::chain::get_signature_cache_stats();
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Keys                                                             //
@@ -554,13 +637,6 @@ vector<vector<account_id_type>> database_api_impl::get_key_references( vector<pu
       address a4( pts_address(key, true, 0)  );
       address a5( key );
 
-      subscribe_to_item( key );
-      subscribe_to_item( a1 );
-      subscribe_to_item( a2 );
-      subscribe_to_item( a3 );
-      subscribe_to_item( a4 );
-      subscribe_to_item( a5 );
-
       const auto& idx = _db.get_index_type<account_index>();
       const auto& aidx = dynamic_cast<const primary_index<account_index>&>(idx);
       const auto& refs = aidx.get_secondary_index<graphene::chain::account_member_index>();
@@ -589,8 +665,9 @@ vector<vector<account_id_type>> database_api_impl::get_key_references( vector<pu
       final_result.emplace_back( std::move(result) );
    }
 
-   for( auto i : final_result )
-      subscribe_to_item(i);
+   for( const auto& accounts : final_result )
+      for( const account_id_type& account : accounts )
+         subscribe_to_item( account );
 
    return final_result;
 }
@@ -677,8 +754,8 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
 
       if( subscribe )
       {
-         if(_subscribed_accounts.size() < 100) {
-            _subscribed_accounts.insert( account->get_id() );
+         if( _subscriber.valid() && _dispatcher->get_subscribed_accounts_count( *_subscriber ) < 100 ) {
+            _dispatcher->subscribe_to_account( *_subscriber, account->get_id() );
             subscribe_to_item( account->id );
          }
       }
@@ -911,7 +988,35 @@ uint32_t database_api_impl::get_number_of_escrows() const
 {
 	const auto& idx = dynamic_cast<const primary_index<account_index>&>(_db.get_index_type<account_index>());
 	const auto& escrow_idx = idx.get_secondary_index<account_escrow_index>();
-	return escrow_idx.current_escrows.size();
+	return escrow_idx.size();
+}
+
+vector<account_object_name> database_api::search_escrows(const string& search_term, const bool substring,
+                                                         const string& start_name, const uint32_t limit) const
+{
+    return my->search_escrows(search_term, substring, start_name, limit);
+}
+
+vector<account_object_name> database_api_impl::search_escrows(const string& search_term, const bool substring,
+                                                              const string& start_name, const uint32_t limit) const
+{
+    FC_ASSERT( limit <= 1000 );
+    const auto& idx = dynamic_cast<const primary_index<account_index>&>(_db.get_index_type<account_index>());
+    const auto& escrow_idx = idx.get_secondary_index<account_escrow_index>();
+    return escrow_idx.search_by_name(search_term, substring, start_name, limit);
+}
+
+vector<account_object_name> database_api::list_escrows_by_score(const optional<account_id_type>& start, const uint32_t limit) const
+{
+    return my->list_escrows_by_score(start, limit);
+}
+
+vector<account_object_name> database_api_impl::list_escrows_by_score(const optional<account_id_type>& start, const uint32_t limit) const
+{
+    FC_ASSERT( limit <= 1000 );
+    const auto& idx = dynamic_cast<const primary_index<account_index>&>(_db.get_index_type<account_index>());
+    const auto& escrow_idx = idx.get_secondary_index<account_escrow_index>();
+    return escrow_idx.list_by_score(start, limit);
 }
 
 map<string,uint64_t> database_api::list_account_reputation_votes(const uint64_t start, const uint32_t limit) const
@@ -924,17 +1029,53 @@ map<string,uint64_t> database_api_impl::list_account_reputation_votes(const uint
     FC_ASSERT(limit <= 1000);
 
     map<string, uint64_t> result;
-    const auto& accounts_reputations = _db.get_index_type<account_index>().indices().get<by_reputation_votes>();
-    auto iter = accounts_reputations.crbegin();
-    std::advance(iter, std::min(start, uint64_t(accounts_reputations.size())));
-    while(result.size() < limit && iter != accounts_reputations.crend())
+    for(const account_rank& item : list_ranked_accounts(ranking_reputation_votes, start, limit))
     {
-        result[iter->name] = iter->reputation_votes_count;
-        ++iter;
+        result[item.name] = item.value;
     }
     return result;
 }
 
+vector<account_rank> database_api::list_ranked_accounts(const account_ranking ranking, const uint64_t start, const uint32_t limit) const
+{
+    return my->list_ranked_accounts(ranking, start, limit);
+}
+
+vector<account_rank> database_api_impl::list_ranked_accounts(const account_ranking ranking, const uint64_t start, const uint32_t limit) const
+{
+    switch(ranking)
+    {
+    case ranking_reputation_votes:
+        return list_ranked_accounts<by_reputation_votes>(start, limit, [](const account_object& a){ return a.reputation_votes_count; });
+    case ranking_listings_count:
+        return list_ranked_accounts<by_listings_count>(start, limit, [](const account_object& a){ return a.listings_count; });
+    case ranking_pop_score:
+        return list_ranked_accounts<by_pop_score>(start, limit, [](const account_object& a){ return a.pop_score; });
+    default:
+        FC_THROW( "Unknown account ranking ${r}", ("r", ranking) );
+    }
+}
+
+account_rank database_api::get_account_rank(const account_ranking ranking, const account_id_type account) const
+{
+    return my->get_account_rank(ranking, account);
+}
+
+account_rank database_api_impl::get_account_rank(const account_ranking ranking, const account_id_type account) const
+{
+    switch(ranking)
+    {
+    case ranking_reputation_votes:
+        return get_account_rank<by_reputation_votes>(account, [](const account_object& a){ return a.reputation_votes_count; });
+    case ranking_listings_count:
+        return get_account_rank<by_listings_count>(account, [](const account_object& a){ return a.listings_count; });
+    case ranking_pop_score:
+        return get_account_rank<by_pop_score>(account, [](const account_object& a){ return a.pop_score; });
+    default:
+        FC_THROW( "Unknown account ranking ${r}", ("r", ranking) );
+    }
+}
+
 vector<account_statistics_object> database_api::get_account_statistics(const vector<account_id_type> &accounts) const
 {
     return my->get_account_statistics(accounts);
@@ -1017,7 +1158,6 @@ vector<balance_object> database_api_impl::get_balance_objects( const vector<addr
 
       for( const auto& owner : addrs )
       {
-         subscribe_to_item( owner );
          auto itr = by_owner_idx.lower_bound( boost::make_tuple( owner, asset_id_type(0) ) );
          while( itr != by_owner_idx.end() && itr->owner == owner )
          {
@@ -2258,17 +2398,6 @@ vector<blinded_balance_object> database_api_impl::get_blinded_balances( const fl
 //                                                                  //
 //////////////////////////////////////////////////////////////////////
 
-void database_api_impl::broadcast_updates( const vector<variant>& updates )
-{
-   if( updates.size() && _subscribe_callback ) {
-      auto capture_this = shared_from_this();
-      fc::async([capture_this,updates](){
-          if(capture_this->_subscribe_callback)
-            capture_this->_subscribe_callback( fc::variant(updates) );
-      });
-   }
-}
-
 void database_api_impl::broadcast_market_updates( const market_queue_type& queue)
 {
    if( queue.size() )
@@ -2287,7 +2416,7 @@ void database_api_impl::broadcast_market_updates( const market_queue_type& queue
 
 void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts)
 {
-   handle_object_changed(_notify_remove_create, false, ids, impacted_accounts,
+   handle_object_changed(false, ids,
       [objs](object_id_type id) -> const object* {
          auto it = std::find_if(
                objs.begin(), objs.end(),
@@ -2303,46 +2432,20 @@ void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, c
 
 void database_api_impl::on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
 {
-   handle_object_changed(_notify_remove_create, true, ids, impacted_accounts,
+   handle_object_changed(true, ids,
       std::bind(&object_database::find_object, &_db, std::placeholders::_1)
    );
 }
 
 void database_api_impl::on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
 {
-   handle_object_changed(false, true, ids, impacted_accounts,
+   handle_object_changed(true, ids,
       std::bind(&object_database::find_object, &_db, std::placeholders::_1)
    );
 }
 
-void database_api_impl::handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object)
+void database_api_impl::handle_object_changed(bool full_object, const vector<object_id_type>& ids, std::function<const object*(object_id_type id)> find_object)
 {
-   if( _subscribe_callback )
-   {
-      vector<variant> updates;
-
-      for(auto id : ids)
-      {
-         if( force_notify || is_subscribed_to_item(id) || is_impacted_account(impacted_accounts) )
-         {
-            if( full_object )
-            {
-               auto obj = find_object(id);
-               if( obj )
-               {
-                  updates.emplace_back( obj->to_variant() );
-               }
-            }
-            else
-            {
-               updates.emplace_back( id );
-            }
-         }
-      }
-
-      broadcast_updates(updates);
-   }
-
    if( _market_subscriptions.size() )
    {
       market_queue_type broadcast_queue;
@@ -2419,6 +2522,38 @@ void database_api_impl::on_applied_block()
    });
 }
 
+/** note: this method cannot yield because it is called in the middle of
+ * apply a block.
+ */
+void database_api_impl::on_listing_changes(const vector<omnibazaar::listing_change>& changes)
+{
+   if( _listing_subscriptions.empty() )
+      return;
+
+   map< account_id_type, vector<omnibazaar::listing_change> > subscribed_changes;
+   for( const auto& item : _listing_subscriptions )
+   {
+      for( const omnibazaar::listing_change& change : changes )
+      {
+         if( change.is_relevant(item.first) )
+            subscribed_changes[item.first].push_back(change);
+      }
+   }
+   if( subscribed_changes.empty() )
+      return;
+
+   /// we need to ensure the database_api is not deleted for the life of the async operation
+   auto capture_this = shared_from_this();
+   fc::async([this,capture_this,subscribed_changes](){
+      for( const auto& item : subscribed_changes )
+      {
+         auto itr = _listing_subscriptions.find(item.first);
+         if( itr != _listing_subscriptions.end() )
+            itr->second(fc::variant(item.second));
+      }
+   });
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Bonuses                                                          //
@@ -2465,6 +2600,26 @@ bool database_api_impl::is_sale_bonus_available(const account_id_type& seller_id
     return _db.is_sale_bonus_available(seller_id, buyer_id);
 }
 
+vector<account_id_type> database_api::get_seller_buyers(const account_id_type seller_id, const account_id_type start, const uint32_t limit)const
+{
+    return my->get_seller_buyers(seller_id, start, limit);
+}
+
+vector<account_id_type> database_api_impl::get_seller_buyers(const account_id_type seller_id, const account_id_type start, const uint32_t limit)const
+{
+    FC_ASSERT( limit <= 1000 );
+
+    vector<account_id_type> result;
+    const auto& buyers_idx = _db.get_index_type<omnibazaar::seller_buyer_index>().indices().get<omnibazaar::by_seller_buyer>();
+    for(auto iter = buyers_idx.lower_bound(boost::make_tuple(seller_id, start));
+        result.size() < limit && iter != buyers_idx.end() && iter->seller == seller_id;
+        ++iter)
+    {
+        result.push_back(iter->buyer);
+    }
+    return result;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Escrows                                                          //
@@ -2510,6 +2665,26 @@ set<account_id_type> database_api_impl::get_implicit_escrows(const account_id_ty
     return _db.get_implicit_escrows(target_account_id);
 }
 
+vector<account_id_type> database_api::get_account_escrows(const account_id_type account_id, const account_id_type start, const uint32_t limit)const
+{
+    return my->get_account_escrows(account_id, start, limit);
+}
+
+vector<account_id_type> database_api_impl::get_account_escrows(const account_id_type account_id, const account_id_type start, const uint32_t limit)const
+{
+    FC_ASSERT( limit <= 1000 );
+
+    vector<account_id_type> result;
+    const auto& links_idx = _db.get_index_type<omnibazaar::account_escrow_link_index>().indices().get<omnibazaar::by_account_escrow>();
+    for(auto iter = links_idx.lower_bound(boost::make_tuple(account_id, start));
+        result.size() < limit && iter != links_idx.end() && iter->account == account_id;
+        ++iter)
+    {
+        result.push_back(iter->escrow);
+    }
+    return result;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Marketplace                                                      //
@@ -2541,7 +2716,7 @@ vector<omnibazaar::listing_object> database_api_impl::get_listings_by_seller(con
     vector<omnibazaar::listing_object> result;
 
     const auto& index = _db.get_index_type<omnibazaar::listing_index>().indices().get<omnibazaar::by_seller>();
-    auto iter = index.equal_range((*seller_obj).get_id());
+    auto iter = index.equal_range(boost::make_tuple((*seller_obj).get_id()));
     while(iter.first != iter.second)
     {
         result.push_back(*iter.first++);
@@ -2560,6 +2735,165 @@ uint64_t database_api_impl::get_listings_count()const
     return _db.get_index_type<omnibazaar::listing_index>().indices().size();
 }
 
+vector<listing_summary> database_api::get_seller_listings(const account_id_type seller, const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_seller_listings(seller, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_seller_listings(const account_id_type seller, const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_seller>(
+                boost::make_tuple(seller, object_id_type(start)),
+                [&](const omnibazaar::listing_object& o){ return o.seller == seller; },
+                limit);
+}
+
+vector<listing_summary> database_api::get_publisher_listings(const account_id_type publisher, const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_publisher_listings(publisher, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_publisher_listings(const account_id_type publisher, const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_publisher>(
+                boost::make_tuple(publisher, object_id_type(start)),
+                [&](const omnibazaar::listing_object& o){ return o.publisher == publisher; },
+                limit);
+}
+
+vector<listing_summary> database_api::get_seller_listings_by_update_time(const account_id_type seller, const time_point_sec start_time,
+                                                                         const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_seller_listings_by_update_time(seller, start_time, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_seller_listings_by_update_time(const account_id_type seller, const time_point_sec start_time,
+                                                                              const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_seller_update_time>(
+                boost::make_tuple(seller, start_time, object_id_type(start)),
+                [&](const omnibazaar::listing_object& o){ return o.seller == seller; },
+                limit);
+}
+
+vector<listing_summary> database_api::get_publisher_listings_by_update_time(const account_id_type publisher, const time_point_sec start_time,
+                                                                            const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_publisher_listings_by_update_time(publisher, start_time, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_publisher_listings_by_update_time(const account_id_type publisher, const time_point_sec start_time,
+                                                                                 const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_publisher_update_time>(
+                boost::make_tuple(publisher, start_time, object_id_type(start)),
+                [&](const omnibazaar::listing_object& o){ return o.publisher == publisher; },
+                limit);
+}
+
+vector<listing_summary> database_api::get_listings_by_update_time(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_listings_by_update_time(start_time, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_listings_by_update_time(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_update_time>(
+                boost::make_tuple(start_time, object_id_type(start)),
+                [](const omnibazaar::listing_object&){ return true; },
+                limit);
+}
+
+vector<listing_summary> database_api::get_listings_by_expiration(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_listings_by_expiration(start_time, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_listings_by_expiration(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_expiration>(
+                boost::make_tuple(start_time, object_id_type(start)),
+                [](const omnibazaar::listing_object&){ return true; },
+                limit);
+}
+
+vector<listing_summary> database_api::get_listings_by_price(const asset_id_type asset_id, const share_type min_amount, const share_type max_amount,
+                                                            const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_listings_by_price(asset_id, min_amount, max_amount, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_listings_by_price(const asset_id_type asset_id, const share_type min_amount, const share_type max_amount,
+                                                                 const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_price>(
+                boost::make_tuple(asset_id, min_amount, object_id_type(start)),
+                [&](const omnibazaar::listing_object& o){ return o.price.asset_id == asset_id && o.price.amount <= max_amount; },
+                limit);
+}
+
+vector<listing_summary> database_api::get_listings_by_priority_fee(const uint16_t min_priority_fee, const listing_id_type start, const uint32_t limit)const
+{
+    return my->get_listings_by_priority_fee(min_priority_fee, start, limit);
+}
+
+vector<listing_summary> database_api_impl::get_listings_by_priority_fee(const uint16_t min_priority_fee, const listing_id_type start, const uint32_t limit)const
+{
+    return get_listings_page<omnibazaar::by_priority_fee>(
+                boost::make_tuple(min_priority_fee, object_id_type(start)),
+                [](const omnibazaar::listing_object&){ return true; },
+                limit);
+}
+
+vector<omnibazaar::listing_change> database_api::get_listing_changes(const account_id_type publisher, const uint32_t start_block,
+                                                                    const uint32_t start_op, const uint32_t limit)const
+{
+    return my->get_listing_changes(publisher, start_block, start_op, limit);
+}
+
+vector<omnibazaar::listing_change> database_api_impl::get_listing_changes(const account_id_type publisher, const uint32_t start_block,
+                                                                         const uint32_t start_op, const uint32_t limit)const
+{
+    FC_ASSERT( limit <= 1000 );
+    FC_ASSERT( _listing_feed, "Listing change feed is not enabled." );
+    return _listing_feed->get_changes(publisher, start_block, start_op, limit);
+}
+
+void database_api::subscribe_to_listing_changes(std::function<void(const variant&)> callback, const account_id_type publisher,
+                                                const uint32_t start_block, const uint32_t start_op)
+{
+    my->subscribe_to_listing_changes(callback, publisher, start_block, start_op);
+}
+
+void database_api_impl::subscribe_to_listing_changes(std::function<void(const variant&)> callback, const account_id_type publisher,
+                                                     const uint32_t start_block, const uint32_t start_op)
+{
+    FC_ASSERT( _listing_feed, "Listing change feed is not enabled." );
+
+    // Feed is updated only by the thread that calls this method, so no changes can be missed between
+    // getting past changes and subscribing to new ones.
+    const vector<omnibazaar::listing_change> missed = _listing_feed->get_changes(publisher, start_block, start_op,
+                                                                                std::numeric_limits<uint32_t>::max());
+    _listing_subscriptions[publisher] = callback;
+    if( !missed.empty() )
+    {
+        auto capture_this = shared_from_this();
+        fc::async([capture_this,callback,missed](){
+            callback(fc::variant(missed));
+        });
+    }
+}
+
+void database_api::unsubscribe_from_listing_changes(const account_id_type publisher)
+{
+    my->unsubscribe_from_listing_changes(publisher);
+}
+
+void database_api_impl::unsubscribe_from_listing_changes(const account_id_type publisher)
+{
+    _listing_subscriptions.erase(publisher);
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Exchange                                                         //
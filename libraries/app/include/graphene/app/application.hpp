@@ -32,6 +32,7 @@
 namespace omnibazaar {
     class mail_storage;
     class mail_controller;
+    class listing_feed;
 }
 
 namespace graphene { namespace app {
@@ -39,6 +40,7 @@ namespace graphene { namespace app {
    using std::string;
 
    class abstract_plugin;
+   class subscription_dispatcher;
 
    class application
    {
@@ -87,6 +89,9 @@ namespace graphene { namespace app {
          std::shared_ptr<chain::database> chain_database()const;
          std::shared_ptr<omnibazaar::mail_storage> mail_storage()const;
          std::shared_ptr<omnibazaar::mail_controller> mail_controller()const;
+         std::shared_ptr<omnibazaar::listing_feed> listing_feed()const;
+         /** object change subscriptions shared by database APIs of all connections */
+         std::shared_ptr<subscription_dispatcher> subscriptions()const;
 
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <graphene/app/full_account.hpp>
+#include <graphene/app/subscription_dispatcher.hpp>
 
 #include <graphene/chain/protocol/types.hpp>
 
@@ -42,8 +43,11 @@
 #include <graphene/chain/witness_object.hpp>
 #include <../omnibazaar/escrow_object.hpp>
 #include <../omnibazaar/listing_object.hpp>
+#include <../omnibazaar/listing_feed.hpp>
 #include <../omnibazaar/exchange_object.hpp>
 #include <../omnibazaar/reserved_names_object.hpp>
+#include <../omnibazaar/seller_buyer_object.hpp>
+#include <../omnibazaar/account_escrow_link_object.hpp>
 
 #include <graphene/market_history/market_history_plugin.hpp>
 
@@ -116,6 +120,50 @@ struct market_trade
    account_id_type            side2_account_id = GRAPHENE_NULL_ACCOUNT;
 };
 
+/**
+ * @brief Criteria by which accounts are ranked, from the largest value.
+ */
+enum account_ranking
+{
+   ranking_reputation_votes,
+   ranking_listings_count,
+   ranking_pop_score
+};
+
+/**
+ * @brief Account position in ranking.
+ */
+struct account_rank
+{
+   account_id_type            id;
+   string                     name;
+   uint64_t                   value = 0;
+   /// Zero-based position of account, accounts with equal values are ordered by descending ID.
+   uint64_t                   rank = 0;
+};
+
+/**
+ * @brief Listing fields needed to page through marketplace, without lists of reporting accounts.
+ */
+struct listing_summary
+{
+   listing_summary() {}
+   explicit listing_summary( const omnibazaar::listing_object& o )
+      : id(o.id), seller(o.seller), publisher(o.publisher), price(o.price), listing_hash(o.listing_hash),
+        quantity(o.quantity), priority_fee(o.priority_fee), expiration_time(o.expiration_time), updated_at(o.updated_at)
+   {}
+
+   listing_id_type            id;
+   account_id_type            seller;
+   account_id_type            publisher;
+   asset                      price;
+   fc::sha256                 listing_hash;
+   uint32_t                   quantity = 0;
+   uint16_t                   priority_fee = 0;
+   time_point_sec             expiration_time;
+   time_point_sec             updated_at;
+};
+
 /**
  * @brief The database_api class implements the RPC API for the chain database.
  *
@@ -126,7 +174,8 @@ struct market_trade
 class database_api
 {
    public:
-      database_api(graphene::chain::database& db);
+      database_api(graphene::chain::database& db, std::shared_ptr<omnibazaar::listing_feed> listing_feed = nullptr,
+                   std::shared_ptr<subscription_dispatcher> dispatcher = nullptr);
       ~database_api();
 
       /////////////
@@ -232,6 +281,20 @@ class database_api
        * @brief Get current recipient of Founder Bonus
        */
       account_id_type get_founder_account()const;
+
+      /**
+       * @brief Get memory held by old object values in undo history
+       * @return Usage of each undo state from oldest to newest, in total and per object type
+       *
+       * Sizes of objects which are not packed in undo history are estimated by their packed size.
+       */
+      vector<undo_level_usage> get_undo_memory_usage()const;
+
+      /**
+       * @brief Get statistics of the cache of public keys recovered from transaction signatures
+       * @return Cache capacity, current size and number of lookups that found or missed a key
+       */
+      signature_cache_stats get_signature_cache_stats()const;
       //////////
       // Keys //
       //////////
@@ -312,6 +375,23 @@ class database_api
 	  */
       vector<account_object_name> filter_current_escrows(uint32_t start, uint32_t limit, const std::string& search_term) const;
 
+      /**
+       * @param search_term Text to search in escrow names.
+       * @param substring true to find names containing search_term, false to find names starting with it.
+       * @param start_name Lower bound of the first name to return, pass name of the last result to get next page.
+       * @param limit Maximum number of results to return - must not exceed 1000.
+       * @return Escrow agents with matching names, sorted by name.
+       */
+      vector<account_object_name> search_escrows(const string& search_term, const bool substring,
+                                                 const string& start_name, const uint32_t limit) const;
+
+      /**
+       * @param start First escrow agent to return, pass the last result to get next page. If not set, start with the best one.
+       * @param limit Maximum number of results to return - must not exceed 1000.
+       * @return Escrow agents sorted by PoP score and then by reputation score in descending order.
+       */
+      vector<account_object_name> list_escrows_by_score(const optional<account_id_type>& start, const uint32_t limit) const;
+
       /**
        * @param start Index of first item to return.
        * @param limit Maximum number of results to return - must not exceed 1000.
@@ -319,6 +399,21 @@ class database_api
        */
       map<string, uint64_t> list_account_reputation_votes(const uint64_t start, const uint32_t limit) const;
 
+      /**
+       * @param ranking criteria by which accounts are ranked.
+       * @param start Rank of first account to return.
+       * @param limit Maximum number of results to return - must not exceed 1000.
+       * @return accounts in ranking order, starting with the largest value.
+       */
+      vector<account_rank> list_ranked_accounts(const account_ranking ranking, const uint64_t start, const uint32_t limit) const;
+
+      /**
+       * @param ranking criteria by which accounts are ranked.
+       * @param account Account to find in ranking.
+       * @return position of account in ranking.
+       */
+      account_rank get_account_rank(const account_ranking ranking, const account_id_type account) const;
+
       /**
        * @param accounts Accounts for which to return statistics - must not exceed 1000.
        * @return statistics objects for specified accounts.
@@ -697,6 +792,15 @@ class database_api
         */
       bool is_sale_bonus_available(const account_id_type& seller_id, const account_id_type& buyer_id)const;
 
+      /**
+        * @brief Page through users that bought something from seller and were counted for Sale Bonus.
+        * @param seller_id seller account ID
+        * @param start first buyer ID to return, buyers are sorted by ID
+        * @param limit maximum number of results to return, must not exceed 1000
+        * @return list of buyer IDs
+        */
+      vector<account_id_type> get_seller_buyers(const account_id_type seller_id, const account_id_type start, const uint32_t limit)const;
+
       /////////////
       // Escrows //
       /////////////
@@ -713,6 +817,15 @@ class database_api
         */
       set<account_id_type> get_implicit_escrows(const account_id_type target_account_id);
 
+      /**
+        * @brief Page through escrow agents explicitly approved by account.
+        * @param account_id account which approves escrows.
+        * @param start first escrow ID to return, escrows are sorted by ID
+        * @param limit maximum number of results to return, must not exceed 1000
+        * @return list of approved escrow agents.
+        */
+      vector<account_id_type> get_account_escrows(const account_id_type account_id, const account_id_type start, const uint32_t limit)const;
+
       /////////////////
       // Marketplace //
       /////////////////
@@ -732,6 +845,66 @@ class database_api
        */
       uint64_t get_listings_count()const;
 
+      /**
+       * The following methods page through listings sorted by some key and then by listing ID.
+       * To get the next page, pass key values and ID of the last returned listing, skipping it in results.
+       * @param start lower bound of listing ID among listings with equal key
+       * @param limit maximum number of results to return, must not exceed 100
+       */
+      /// @return Listings of specified seller, sorted by ID.
+      vector<listing_summary> get_seller_listings(const account_id_type seller, const listing_id_type start, const uint32_t limit)const;
+      /// @return Listings hosted by specified publisher, sorted by ID.
+      vector<listing_summary> get_publisher_listings(const account_id_type publisher, const listing_id_type start, const uint32_t limit)const;
+      /// @return Listings of specified seller updated at or after @p start_time, sorted by update time.
+      vector<listing_summary> get_seller_listings_by_update_time(const account_id_type seller, const time_point_sec start_time,
+                                                                 const listing_id_type start, const uint32_t limit)const;
+      /// @return Listings hosted by specified publisher updated at or after @p start_time, sorted by update time.
+      vector<listing_summary> get_publisher_listings_by_update_time(const account_id_type publisher, const time_point_sec start_time,
+                                                                    const listing_id_type start, const uint32_t limit)const;
+      /// @return Listings updated at or after @p start_time, sorted by update time.
+      vector<listing_summary> get_listings_by_update_time(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const;
+      /// @return Listings expiring at or after @p start_time, sorted by expiration time.
+      vector<listing_summary> get_listings_by_expiration(const time_point_sec start_time, const listing_id_type start, const uint32_t limit)const;
+      /// @return Listings priced in @p asset_id with amount from @p min_amount to @p max_amount, sorted by price.
+      vector<listing_summary> get_listings_by_price(const asset_id_type asset_id, const share_type min_amount, const share_type max_amount,
+                                                    const listing_id_type start, const uint32_t limit)const;
+      /// @return Listings with priority fee of at least @p min_priority_fee, sorted by priority fee.
+      vector<listing_summary> get_listings_by_priority_fee(const uint16_t min_priority_fee, const listing_id_type start, const uint32_t limit)const;
+
+      /**
+       * @brief Get recent changes of listings hosted by publisher
+       * @param publisher publisher account, changes of listings moved from it to another publisher are included
+       * @param start_block block number of the first change to return
+       * @param start_op index of the first change to return among operations applied in start_block
+       * @param limit maximum number of results to return, must not exceed 1000
+       * @return changes sorted by block number and operation index
+       *
+       * Only changes of irreversible blocks are returned, so they are never reverted by chain reorganization.
+       * Node keeps only limited number of recent changes. If changes starting at specified position are
+       * no longer available, an exception is thrown and publisher has to resync from current listings.
+       * To resume after the last processed change, pass its block number and operation index incremented by one.
+       * After syncing from current listings, pass next block number and 0.
+       */
+      vector<omnibazaar::listing_change> get_listing_changes(const account_id_type publisher, const uint32_t start_block,
+                                                             const uint32_t start_op, const uint32_t limit)const;
+
+      /**
+       * @brief Request notification of changes of listings hosted by publisher
+       * @param callback callback which receives vector of changes of blocks as they become irreversible
+       * @param publisher publisher account
+       * @param start_block block number of the first change to notify, see @ref get_listing_changes
+       * @param start_op operation index of the first change to notify
+       *
+       * Changes which were already applied starting from specified position are sent right away.
+       */
+      void subscribe_to_listing_changes(std::function<void(const variant&)> callback, const account_id_type publisher,
+                                        const uint32_t start_block, const uint32_t start_op);
+
+      /**
+       * @brief Stop receiving notifications of changes of listings hosted by publisher
+       */
+      void unsubscribe_from_listing_changes(const account_id_type publisher);
+
       //////////////
       // Exchange //
       //////////////
@@ -766,6 +939,10 @@ FC_REFLECT( graphene::app::market_ticker,
             (time)(base)(quote)(latest)(lowest_ask)(highest_bid)(percent_change)(base_volume)(quote_volume) );
 FC_REFLECT( graphene::app::market_volume, (time)(base)(quote)(base_volume)(quote_volume) );
 FC_REFLECT( graphene::app::market_trade, (sequence)(date)(price)(amount)(value)(side1_account_id)(side2_account_id) );
+FC_REFLECT_ENUM( graphene::app::account_ranking, (ranking_reputation_votes)(ranking_listings_count)(ranking_pop_score) );
+FC_REFLECT( graphene::app::account_rank, (id)(name)(value)(rank) );
+FC_REFLECT( graphene::app::listing_summary,
+            (id)(seller)(publisher)(price)(listing_hash)(quantity)(priority_fee)(expiration_time)(updated_at) );
 
 FC_API(graphene::app::database_api,
    // Objects
@@ -792,6 +969,8 @@ FC_API(graphene::app::database_api,
    (get_dynamic_global_properties)
    (get_reserved_names)
    (get_founder_account)
+   (get_undo_memory_usage)
+   (get_signature_cache_stats)
 
    // Keys
    (get_key_references)
@@ -807,6 +986,8 @@ FC_API(graphene::app::database_api,
    (get_account_count)
    (get_publisher_nodes_names)
    (list_account_reputation_votes)
+   (list_ranked_accounts)
+   (get_account_rank)
    (get_account_statistics)
 
    // Balances
@@ -877,17 +1058,32 @@ FC_API(graphene::app::database_api,
     (get_welcome_bonus_amount)
     (is_referral_bonus_available)
     (is_sale_bonus_available)
+    (get_seller_buyers)
 
     // Escrows
     (get_escrow_objects)
 	(get_number_of_escrows)
 	(filter_current_escrows)
+    (search_escrows)
+    (list_escrows_by_score)
     (get_implicit_escrows)
+    (get_account_escrows)
 
     // Marketplace
     (check_listing_exists)
     (get_listings_by_seller)
     (get_listings_count)
+    (get_seller_listings)
+    (get_publisher_listings)
+    (get_seller_listings_by_update_time)
+    (get_publisher_listings_by_update_time)
+    (get_listings_by_update_time)
+    (get_listings_by_expiration)
+    (get_listings_by_price)
+    (get_listings_by_priority_fee)
+    (get_listing_changes)
+    (subscribe_to_listing_changes)
+    (unsubscribe_from_listing_changes)
 
     // Exchange
     (lookup_exchange_objects)
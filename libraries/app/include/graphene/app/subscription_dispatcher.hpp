@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <fc/variant.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+
+namespace graphene { namespace app {
+
+   using namespace graphene::chain;
+
+   /**
+    *  @brief Delivers object change notifications to subscribers of all API connections.
+    *
+    *  Every changed object is converted to variant once, no matter how many subscribers it is delivered to.
+    *  Subscribers are found through indexes of subscribed objects and accounts instead of checking every
+    *  subscriber. Notifications are delivered in a separate task after changes are applied, with one
+    *  call per subscriber for every batch of changes reported by the database.
+    *
+    *  No thread sync is required provided it is used only by the thread that applies blocks.
+    */
+   class subscription_dispatcher : public std::enable_shared_from_this<subscription_dispatcher>
+   {
+      public:
+         typedef std::function<void(const fc::variant&)> callback_type;
+         typedef uint64_t                               subscriber_id_type;
+
+         subscription_dispatcher( database& db );
+
+         /**
+          *  @brief Register subscriber to be notified of changes of objects it subscribes to.
+          *  @param notify_remove_create true to be notified of all created and removed objects.
+          */
+         subscriber_id_type add_subscriber( callback_type callback, bool notify_remove_create );
+         /** Unregister subscriber and drop its subscriptions, notifications not delivered yet are dropped too. */
+         void remove_subscriber( subscriber_id_type subscriber );
+
+         void subscribe_to_object( subscriber_id_type subscriber, object_id_type id );
+         bool is_subscribed_to_object( subscriber_id_type subscriber, object_id_type id )const;
+         /** Subscribe to changes of all objects which impact account, like its balances and history. */
+         void subscribe_to_account( subscriber_id_type subscriber, account_id_type account );
+         size_t get_subscribed_accounts_count( subscriber_id_type subscriber )const;
+
+      private:
+         struct subscriber_info
+         {
+            callback_type             callback;
+            bool                      notify_remove_create = false;
+            std::set<object_id_type>  objects;
+            std::set<account_id_type> accounts;
+         };
+
+         void on_objects_changed( bool notify_remove_create, bool full_object, const vector<object_id_type>& ids,
+                                  const flat_set<account_id_type>& impacted_accounts,
+                                  const std::function<const object*(object_id_type)>& find_object );
+
+         database&                                                      _db;
+         subscriber_id_type                                             _next_subscriber_id = 0;
+         std::map<subscriber_id_type, subscriber_info>                  _subscribers;
+         std::unordered_map<object_id_type, std::set<subscriber_id_type>> _object_subscribers;
+         std::map<account_id_type, std::set<subscriber_id_type>>        _account_subscribers;
+         std::set<subscriber_id_type>                                   _remove_create_subscribers;
+
+         boost::signals2::scoped_connection                             _new_connection;
+         boost::signals2::scoped_connection                             _change_connection;
+         boost::signals2::scoped_connection                             _removed_connection;
+   };
+
+} } // graphene::app
@@ -0,0 +1,174 @@
+#include <listing_feed.hpp>
+#include <../omnibazaar/listing_object.hpp>
+
+#include <algorithm>
+
+bool omnibazaar::listing_change::is_relevant(const graphene::chain::account_id_type publisher_id)const
+{
+    return publisher == publisher_id || (previous_publisher.valid() && *previous_publisher == publisher_id);
+}
+
+omnibazaar::listing_feed::listing_feed(graphene::chain::database& db, const uint32_t capacity)
+    : _db(db)
+    , _capacity(capacity)
+    , _kept_from(db.head_block_num() + 1, 0)
+{
+    for(const listing_object& listing : _db.get_index_type<listing_index>().indices())
+    {
+        _owners[listing.id.instance()] = listing_owners{listing.seller, listing.publisher};
+    }
+
+    _applied_block_connection = _db.applied_block.connect([this](const graphene::chain::signed_block& block){
+        on_applied_block(block);
+    });
+}
+
+std::vector<omnibazaar::listing_change> omnibazaar::listing_feed::get_changes(const graphene::chain::account_id_type publisher,
+                                                                              const uint32_t start_block, const uint32_t start_op,
+                                                                              const uint32_t limit)const
+{
+    FC_ASSERT( std::make_pair(start_block, start_op) >= _kept_from,
+               "Listing changes starting at block ${b} are no longer available, resync is required.",
+               ("b", start_block) );
+
+    std::vector<listing_change> result;
+    auto iter = std::lower_bound(_changes.begin(), _changes.end(), std::make_pair(start_block, start_op),
+                                 [](const listing_change& change, const std::pair<uint32_t, uint32_t>& cursor){
+        return std::make_pair(change.block_num, change.op_index) < cursor;
+    });
+    for(; result.size() < limit && iter != _changes.end(); ++iter)
+    {
+        if(iter->is_relevant(publisher))
+            result.push_back(*iter);
+    }
+    return result;
+}
+
+void omnibazaar::listing_feed::on_applied_block(const graphene::chain::signed_block& block)
+{
+    const uint32_t block_num = block.block_num();
+
+    // Block replaces previously applied one after chain reorganization. Its changes were not reported yet,
+    // so they are only dropped, and listing owners are restored in reverse order of changes.
+    while(!_pending.empty() && _pending.back().change.block_num >= block_num)
+    {
+        const pending_change& reverted = _pending.back();
+        if(reverted.previous_owners.valid())
+            _owners[reverted.change.listing_id.instance.value] = *reverted.previous_owners;
+        else
+            _owners.erase(reverted.change.listing_id.instance.value);
+        _pending.pop_back();
+    }
+
+    const auto& ops = _db.get_applied_operations();
+    for(size_t i = 0; i < ops.size(); ++i)
+    {
+        if(!ops[i].valid())
+            continue;
+
+        pending_change pending;
+        pending.change.block_num = block_num;
+        pending.change.op_index = i;
+        if(make_change(*ops[i], pending))
+            _pending.push_back(pending);
+    }
+
+    const uint32_t last_irreversible_block = _db.get_dynamic_global_properties().last_irreversible_block_num;
+    std::vector<listing_change> changes;
+    while(!_pending.empty() && _pending.front().change.block_num <= last_irreversible_block)
+    {
+        changes.push_back(_pending.front().change);
+        _pending.pop_front();
+    }
+
+    if(changes.empty())
+        return;
+
+    _changes.insert(_changes.end(), changes.begin(), changes.end());
+    while(_changes.size() > _capacity)
+    {
+        _kept_from = std::make_pair(_changes.front().block_num, _changes.front().op_index + 1);
+        _changes.pop_front();
+    }
+
+    changes_applied(changes);
+}
+
+void omnibazaar::listing_feed::set_owners(pending_change& pending, const fc::optional<listing_owners>& owners)
+{
+    const uint64_t instance = pending.change.listing_id.instance.value;
+    const auto iter = _owners.find(instance);
+    if(iter != _owners.end())
+        pending.previous_owners = iter->second;
+
+    if(owners.valid())
+        _owners[instance] = *owners;
+    else if(iter != _owners.end())
+        _owners.erase(iter);
+}
+
+bool omnibazaar::listing_feed::make_change(const graphene::chain::operation_history_object& op, pending_change& pending)
+{
+    // Get owners of listing from the last change, or from the listing itself if feed missed it.
+    const auto get_owners = [this](const graphene::chain::listing_id_type id) -> listing_owners {
+        const auto iter = _owners.find(id.instance.value);
+        if(iter != _owners.end())
+            return iter->second;
+        if(const listing_object* listing = _db.find(id))
+            return listing_owners{listing->seller, listing->publisher};
+        return listing_owners();
+    };
+
+    listing_change& change = pending.change;
+    switch(op.op.which())
+    {
+    case graphene::chain::operation::tag<listing_create_operation>::value:
+    {
+        const auto& create_op = op.op.get<listing_create_operation>();
+        change.type = listing_created;
+        change.listing_id = op.result.get<graphene::chain::object_id_type>();
+        change.seller = create_op.seller;
+        change.publisher = create_op.publisher;
+        set_owners(pending, listing_owners{change.seller, change.publisher});
+        return true;
+    }
+    case graphene::chain::operation::tag<listing_update_operation>::value:
+    {
+        const auto& update_op = op.op.get<listing_update_operation>();
+        const listing_owners owners = get_owners(update_op.listing_id);
+        change.type = listing_updated;
+        change.listing_id = update_op.listing_id;
+        change.seller = update_op.seller;
+        change.publisher = update_op.publisher.valid() ? *update_op.publisher : owners.publisher;
+        if(change.publisher != owners.publisher)
+            change.previous_publisher = owners.publisher;
+        set_owners(pending, listing_owners{change.seller, change.publisher});
+        return true;
+    }
+    case graphene::chain::operation::tag<listing_delete_operation>::value:
+    {
+        const auto& delete_op = op.op.get<listing_delete_operation>();
+        const listing_owners owners = get_owners(delete_op.listing_id);
+        change.type = listing_deleted;
+        change.listing_id = delete_op.listing_id;
+        change.seller = delete_op.seller;
+        change.publisher = owners.publisher;
+        set_owners(pending, fc::optional<listing_owners>());
+        return true;
+    }
+    case graphene::chain::operation::tag<listing_report_operation>::value:
+    {
+        const auto& report_op = op.op.get<listing_report_operation>();
+        const listing_owners owners = get_owners(report_op.listing_id);
+        change.type = listing_reported;
+        change.listing_id = report_op.listing_id;
+        change.seller = owners.seller;
+        change.publisher = owners.publisher;
+        // Owners are not changed, but kept for restoring them in the same way as after other changes.
+        set_owners(pending, owners);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
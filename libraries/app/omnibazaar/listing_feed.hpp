@@ -0,0 +1,103 @@
+#pragma once
+
+#include <graphene/chain/database.hpp>
+#include <fc/signals.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace omnibazaar {
+
+    // Kind of change made to marketplace listing.
+    enum listing_change_type
+    {
+        listing_created = 0,
+        listing_updated = 1,
+        listing_deleted = 2,
+        listing_reported = 3
+    };
+
+    // Single change of marketplace listing. Changes are ordered by block number and index of the operation
+    // among all operations applied in that block, which together serve as a cursor for resuming the feed.
+    struct listing_change
+    {
+        uint32_t block_num = 0;
+        uint32_t op_index = 0;
+        uint8_t type = listing_created;
+        graphene::chain::listing_id_type listing_id;
+        graphene::chain::account_id_type seller;
+        graphene::chain::account_id_type publisher;
+        // Publisher that hosted listing before this change, if the change moved listing to another publisher.
+        fc::optional<graphene::chain::account_id_type> previous_publisher;
+
+        // Check if this change should be reported to specified publisher.
+        bool is_relevant(const graphene::chain::account_id_type publisher_id)const;
+    };
+
+    // Class for keeping recent listing changes, so that publishers can follow changes of listings they host
+    // instead of rescanning all listings, and resume after reconnect from the first change they did not process.
+    //
+    // Changes are kept only in memory, up to specified number of them. Publishers that fall further behind,
+    // or reconnect after node restart, have to resync from current listings.
+    // Changes are reported only after their blocks become irreversible, so that publishers never receive changes
+    // which are reverted by chain reorganization. Changes of reversible blocks are held back, and dropped together
+    // with listing owners they set when their blocks are replaced.
+    // No thread sync is required provided it is called only by thread that applies blocks.
+    class listing_feed
+    {
+    public:
+        listing_feed(graphene::chain::database& db, const uint32_t capacity);
+
+        // Get up to limit changes relevant to publisher, starting at specified block number and operation index.
+        // Throws if some of those changes are no longer kept.
+        std::vector<listing_change> get_changes(const graphene::chain::account_id_type publisher,
+                                                const uint32_t start_block, const uint32_t start_op,
+                                                const uint32_t limit)const;
+
+        // Emitted after blocks that changed any listings become irreversible, with all changes of those blocks.
+        fc::signal<void(const std::vector<listing_change>&)> changes_applied;
+
+    private:
+        // Owners of existing listings, needed to report changes of listings which are already deleted.
+        struct listing_owners
+        {
+            graphene::chain::account_id_type seller;
+            graphene::chain::account_id_type publisher;
+        };
+
+        // Change of reversible block, with owners which listing had before it, to restore them if block is replaced.
+        struct pending_change
+        {
+            listing_change change;
+            fc::optional<listing_owners> previous_owners;
+        };
+
+        void on_applied_block(const graphene::chain::signed_block& block);
+        // Fill listing change details from operation. Returns false if operation does not change listings.
+        bool make_change(const graphene::chain::operation_history_object& op, pending_change& pending);
+        // Set owners of listing, remembering the previous ones in pending change.
+        void set_owners(pending_change& pending, const fc::optional<listing_owners>& owners);
+
+        graphene::chain::database& _db;
+        const uint32_t _capacity;
+        std::deque<pending_change> _pending;
+        std::deque<listing_change> _changes;
+        // Cursor starting from which all changes are kept.
+        std::pair<uint32_t, uint32_t> _kept_from;
+        std::unordered_map<uint64_t, listing_owners> _owners;
+        boost::signals2::scoped_connection _applied_block_connection;
+    };
+}
+
+FC_REFLECT_ENUM(omnibazaar::listing_change_type, (listing_created)(listing_updated)(listing_deleted)(listing_reported))
+FC_REFLECT(omnibazaar::listing_change,
+           (block_num)
+           (op_index)
+           (type)
+           (listing_id)
+           (seller)
+           (publisher)
+           (previous_publisher)
+           )
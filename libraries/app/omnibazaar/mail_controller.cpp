@@ -7,6 +7,11 @@
 #include <fc/thread/scoped_lock.hpp>
 
 static const int TIMER_TICK_INTERVAL_IN_SECONDS = 1;
+// Delay before the first re-send of a mail or notification. It is doubled after every attempt up to the maximum.
+static const uint32_t INITIAL_RETRY_DELAY_IN_SECONDS = 5;
+static const uint32_t MAX_RETRY_DELAY_IN_SECONDS = 10 * 60;
+// Maximum number of mails and notifications re-sent during one tick.
+static const size_t MAX_RETRIES_PER_TICK = 100;
 
 namespace omnibazaar {
 
@@ -19,6 +24,12 @@ namespace omnibazaar {
         _received_mail_connection = _app.p2p_node()->mail_received.connect([this](const std::string& u){ on_mail_received(u); });
         _confirm_received_mail_connection = _app.p2p_node()->mail_confirm_received.connect([this](const std::string& u){ on_mail_confirm_received(u); });
 
+        mail_ilog("Scheduling re-send of stored mails.");
+        for(const std::string& mail_uuid : _app.mail_storage()->get_pending_mails())
+            schedule_retry(mail_uuid, false, true);
+        for(const std::string& mail_uuid : _app.mail_storage()->get_received_mails())
+            schedule_retry(mail_uuid, true, true);
+
         mail_ilog("Starting mail processing loop.");
         start_mail_processing_loop();
     }
@@ -42,6 +53,7 @@ namespace omnibazaar {
         _app.mail_storage()->store(mail);
         // Send mail to other backend nodes.
         _app.p2p_node()->mail_send(mail);
+        schedule_retry(mail.uuid, false, true);
         // If receiving user is connected to this node, send mail directly.
         const auto itr = _receive_callbacks.find(mail.recipient);
         if(itr != _receive_callbacks.end())
@@ -59,6 +71,8 @@ namespace omnibazaar {
             const fc::scoped_lock<fc::spin_lock> lock(_receive_callbacks_lock);
             _receive_callbacks[receiver_name] = cb;
         }
+        // Let other nodes know that mails for this receiver should be delivered here.
+        _app.p2p_node()->mail_set_subscribed(receiver_name, true);
         // Send any pending mails to this callback.
         const std::vector<mail_object> mails = _app.mail_storage()->get_mails_by_receiver(receiver_name);
         std::vector<fc::variant> data;
@@ -71,10 +85,16 @@ namespace omnibazaar {
     {
         mail_ddump((mail_uuid));
 
-        // Move mail to delivered folder.
+        // Mark mail as delivered in storage.
         _app.mail_storage()->set_received(mail_uuid);
         // Send notification that mail was received.
         _app.p2p_node()->mail_send_received(mail_uuid);
+        // Mail itself no longer needs to be re-sent, but notification does until sender confirms it.
+        {
+            const fc::scoped_lock<fc::spin_lock> lock(_retries_lock);
+            _retries.erase(std::make_pair(mail_uuid, false));
+        }
+        schedule_retry(mail_uuid, true, true);
         // If sender is connected to this node, notify about successful mail delivery.
         const auto itr = _send_callbacks.find(mail_uuid);
         if(itr != _send_callbacks.end())
@@ -89,6 +109,7 @@ namespace omnibazaar {
 
         // Mail is now fully sent and confirmed by both sides, remove it from storage.
         _app.mail_storage()->remove(mail_uuid);
+        cancel_retries(mail_uuid);
         // Send notification to other nodes.
         _app.p2p_node()->mail_send_confirm_received(mail_uuid);
     }
@@ -112,74 +133,129 @@ namespace omnibazaar {
 
     void mail_controller::mail_sending_tick()
     {
-        mail_dlog("Processing pending mails.");
-        // Re-send mails that were not successfully delivered to receivers.
-        const std::vector<fc::path> pending_mails = _app.mail_storage()->get_pending_mails();
-        for(const auto& path : pending_mails)
+        // Collect mails and notifications which are due, skipping queue items of cancelled or rescheduled retries.
+        const fc::time_point now = fc::time_point::now();
+        std::vector<std::pair<std::string, bool>> due_retries;
         {
-            mail_dlog("Processing mail file '${file}'.", ("file", path));
-            if(!fc::exists(path))
+            const fc::scoped_lock<fc::spin_lock> lock(_retries_lock);
+            while(!_retry_queue.empty() && _retry_queue.top().due <= now && due_retries.size() < MAX_RETRIES_PER_TICK)
             {
-                mail_wlog("File '${path}' does not exist.", ("path", path));
-                continue;
+                const retry_item item = _retry_queue.top();
+                _retry_queue.pop();
+                const auto itr = _retries.find(std::make_pair(item.mail_uuid, item.is_notification));
+                if(itr != _retries.end() && itr->second.due == item.due)
+                {
+                    due_retries.push_back(itr->first);
+                }
             }
+        }
 
-            const fc::variant var = fc::json::from_file(path);
-            if(var.is_null())
-            {
-                mail_wlog("Unable to read mail object ${obj} from '${path}'.", ("obj", var)("path", path));
-                continue;
-            }
+        if(due_retries.empty())
+        {
+            return;
+        }
 
-            const mail_object mail = var.as<mail_object>();
-            // Send mail to other backend nodes.
-            _app.p2p_node()->mail_send(mail);
-            // If receiving user is connected to this node, send mail directly.
-            callback_type cb = nullptr;
+        mail_dlog("Re-sending ${n} mails and notifications.", ("n", due_retries.size()));
+        for(const auto& retry : due_retries)
+        {
+            if(retry.second)
             {
-                const fc::scoped_lock<fc::spin_lock> lock(_receive_callbacks_lock);
-                const auto itr = _receive_callbacks.find(mail.recipient);
-                if(itr != _receive_callbacks.end())
-                {
-                    cb = itr->second;
-                }
+                resend_notification(retry.first);
+                schedule_retry(retry.first, true, false);
             }
-            if(cb)
+            else if(resend_mail(retry.first))
             {
-                exec_callback(cb, { fc::variant(mail) });
+                schedule_retry(retry.first, false, false);
             }
             else
             {
-                mail_wlog("Unable to find receive callback for '${mail}'.", ("mail", mail.recipient));
+                // Mail was delivered or removed without going through this controller.
+                const fc::scoped_lock<fc::spin_lock> lock(_retries_lock);
+                _retries.erase(retry);
             }
         }
+    }
 
-        mail_dlog("Processing delivered mails.");
-        // Re-send notifications to senders for mails that were delivered to receivers.
-        const std::vector<std::string> pending_notifications = _app.mail_storage()->get_received_mails();
-        for(const auto& mail_uuid : pending_notifications)
+    bool mail_controller::resend_mail(const std::string& mail_uuid)
+    {
+        mail_ddump((mail_uuid));
+
+        const fc::optional<mail_object> mail = _app.mail_storage()->get_pending_mail(mail_uuid);
+        if(!mail.valid())
         {
-            // Send notification that mail was received.
-            _app.p2p_node()->mail_send_received(mail_uuid);
-            // If sender is connected to this node, notify about successful mail delivery.
-            callback_type cb = nullptr;
-            {
-                const fc::scoped_lock<fc::spin_lock> lock(_send_callbacks_lock);
-                const auto itr = _send_callbacks.find(mail_uuid);
-                if(itr != _send_callbacks.end())
-                {
-                    cb = itr->second;
-                }
-            }
-            if(cb)
+            mail_dlog("Mail '${uuid}' is no longer pending.", ("uuid", mail_uuid));
+            return false;
+        }
+
+        // Send mail to other backend nodes.
+        _app.p2p_node()->mail_send(*mail);
+        // If receiving user is connected to this node, send mail directly.
+        callback_type cb = nullptr;
+        {
+            const fc::scoped_lock<fc::spin_lock> lock(_receive_callbacks_lock);
+            const auto itr = _receive_callbacks.find(mail->recipient);
+            if(itr != _receive_callbacks.end())
             {
-                exec_callback(cb, { fc::variant(graphene::app::network_broadcast_api::send_confirmation{mail_uuid}) });
+                cb = itr->second;
             }
-            else
+        }
+        if(cb)
+        {
+            exec_callback(cb, { fc::variant(*mail) });
+        }
+        else
+        {
+            mail_dlog("Unable to find receive callback for '${mail}'.", ("mail", mail->recipient));
+        }
+        return true;
+    }
+
+    void mail_controller::resend_notification(const std::string& mail_uuid)
+    {
+        mail_ddump((mail_uuid));
+
+        // Send notification that mail was received.
+        _app.p2p_node()->mail_send_received(mail_uuid);
+        // If sender is connected to this node, notify about successful mail delivery.
+        callback_type cb = nullptr;
+        {
+            const fc::scoped_lock<fc::spin_lock> lock(_send_callbacks_lock);
+            const auto itr = _send_callbacks.find(mail_uuid);
+            if(itr != _send_callbacks.end())
             {
-                mail_wlog("Unable to find send callback for '${mail}'.", ("mail", mail_uuid));
+                cb = itr->second;
             }
         }
+        if(cb)
+        {
+            exec_callback(cb, { fc::variant(graphene::app::network_broadcast_api::send_confirmation{mail_uuid}) });
+        }
+        else
+        {
+            mail_dlog("Unable to find send callback for '${mail}'.", ("mail", mail_uuid));
+        }
+    }
+
+    void mail_controller::schedule_retry(const std::string& mail_uuid, const bool is_notification, const bool reset)
+    {
+        const fc::scoped_lock<fc::spin_lock> lock(_retries_lock);
+
+        retry_state& state = _retries[std::make_pair(mail_uuid, is_notification)];
+        if(reset)
+        {
+            state.attempts = 0;
+        }
+        const uint32_t delay = std::min(INITIAL_RETRY_DELAY_IN_SECONDS << std::min(state.attempts, 16u), MAX_RETRY_DELAY_IN_SECONDS);
+        ++state.attempts;
+        state.due = fc::time_point::now() + fc::seconds(delay);
+        _retry_queue.push(retry_item{ state.due, mail_uuid, is_notification });
+    }
+
+    void mail_controller::cancel_retries(const std::string& mail_uuid)
+    {
+        const fc::scoped_lock<fc::spin_lock> lock(_retries_lock);
+        _retries.erase(std::make_pair(mail_uuid, false));
+        _retries.erase(std::make_pair(mail_uuid, true));
     }
 
     void mail_controller::on_new_mail(const mail_object& mail)
@@ -242,6 +318,7 @@ namespace omnibazaar {
 
         // Mail reception is confirmed by sender, remove it from storage.
         _app.mail_storage()->remove(mail_uuid);
+        cancel_retries(mail_uuid);
     }
 
     void mail_controller::exec_callback(callback_type callback, const std::vector<fc::variant> &objects)
@@ -277,8 +354,11 @@ namespace omnibazaar {
 
         for(auto itr = callbacks.cbegin(); itr != callbacks.cend(); ++itr)
         {
-            const fc::scoped_lock<fc::spin_lock> lock(_receive_callbacks_lock);
-            _receive_callbacks.erase(itr->first);
+            {
+                const fc::scoped_lock<fc::spin_lock> lock(_receive_callbacks_lock);
+                _receive_callbacks.erase(itr->first);
+            }
+            _app.p2p_node()->mail_set_subscribed(itr->first, false);
         }
     }
 
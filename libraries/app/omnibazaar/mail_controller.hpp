@@ -5,6 +5,8 @@
 #include <fc/thread/future.hpp>
 #include <fc/thread/spin_lock.hpp>
 #include <fc/reflect/reflect.hpp>
+#include <map>
+#include <queue>
 
 namespace graphene { namespace app {
     class application;
@@ -45,12 +47,44 @@ namespace omnibazaar {
         // Start background thread that continuously tries to re-send pending messages
         // and notifications about message delivery.
         void start_mail_processing_loop();
+        // Re-send mails and notifications which are due for retry, but no more than a fixed number per tick.
         void mail_sending_tick();
+        // Returns false if mail is no longer pending.
+        bool resend_mail(const std::string& mail_uuid);
+        void resend_notification(const std::string& mail_uuid);
+
+        // Schedule next re-send of specified mail or delivery notification.
+        // Delay doubles after every attempt unless reset is requested.
+        void schedule_retry(const std::string& mail_uuid, const bool is_notification, const bool reset);
+        // Stop re-sending specified mail and its delivery notification.
+        void cancel_retries(const std::string& mail_uuid);
 
         void exec_callback(callback_type callback, const std::vector<fc::variant>& objects);
 
+        // Scheduled re-send of a mail or of a delivery notification.
+        struct retry_item
+        {
+            fc::time_point due;
+            std::string mail_uuid;
+            bool is_notification;
+
+            bool operator>(const retry_item& other)const { return due > other.due; }
+        };
+
+        struct retry_state
+        {
+            fc::time_point due;
+            uint32_t attempts = 0;
+        };
+
         graphene::app::application& _app;
         fc::thread _thread;
+        // Queue of retries ordered by due time. Items are not removed when retry is cancelled or rescheduled,
+        // instead they are skipped if they don't match current state in _retries.
+        std::priority_queue<retry_item, std::vector<retry_item>, std::greater<retry_item>> _retry_queue;
+        // Current retry state for every mail UUID and notification flag.
+        std::map<std::pair<std::string, bool>, retry_state> _retries;
+        fc::spin_lock _retries_lock;
         std::unordered_map<std::string, callback_type> _send_callbacks;
         std::unordered_map<std::string, callback_type> _receive_callbacks;
         fc::spin_lock _send_callbacks_lock;
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/subscription_dispatcher.hpp>
+
+#include <fc/thread/thread.hpp>
+
+namespace graphene { namespace app {
+
+subscription_dispatcher::subscription_dispatcher( database& db )
+   :_db(db)
+{
+   _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) {
+                                on_objects_changed(true, true, ids, impacted_accounts,
+                                   std::bind(&object_database::find_object, &_db, std::placeholders::_1));
+                                });
+   _change_connection = _db.changed_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) {
+                                on_objects_changed(false, true, ids, impacted_accounts,
+                                   std::bind(&object_database::find_object, &_db, std::placeholders::_1));
+                                });
+   _removed_connection = _db.removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts) {
+                                on_objects_changed(true, false, ids, impacted_accounts,
+                                   [](object_id_type) -> const object* { return nullptr; });
+                                });
+}
+
+subscription_dispatcher::subscriber_id_type subscription_dispatcher::add_subscriber( callback_type callback, bool notify_remove_create )
+{
+   const subscriber_id_type subscriber = _next_subscriber_id++;
+   subscriber_info& info = _subscribers[subscriber];
+   info.callback = std::move(callback);
+   info.notify_remove_create = notify_remove_create;
+   if( notify_remove_create )
+      _remove_create_subscribers.insert( subscriber );
+   return subscriber;
+}
+
+void subscription_dispatcher::remove_subscriber( subscriber_id_type subscriber )
+{
+   auto itr = _subscribers.find( subscriber );
+   if( itr == _subscribers.end() )
+      return;
+
+   for( const object_id_type& id : itr->second.objects )
+   {
+      auto object_itr = _object_subscribers.find( id );
+      object_itr->second.erase( subscriber );
+      if( object_itr->second.empty() )
+         _object_subscribers.erase( object_itr );
+   }
+   for( const account_id_type& account : itr->second.accounts )
+   {
+      auto account_itr = _account_subscribers.find( account );
+      account_itr->second.erase( subscriber );
+      if( account_itr->second.empty() )
+         _account_subscribers.erase( account_itr );
+   }
+   _remove_create_subscribers.erase( subscriber );
+   _subscribers.erase( itr );
+}
+
+void subscription_dispatcher::subscribe_to_object( subscriber_id_type subscriber, object_id_type id )
+{
+   auto itr = _subscribers.find( subscriber );
+   if( itr == _subscribers.end() )
+      return;
+
+   if( itr->second.objects.insert( id ).second )
+      _object_subscribers[id].insert( subscriber );
+}
+
+bool subscription_dispatcher::is_subscribed_to_object( subscriber_id_type subscriber, object_id_type id )const
+{
+   auto itr = _subscribers.find( subscriber );
+   return itr != _subscribers.end() && itr->second.objects.find( id ) != itr->second.objects.end();
+}
+
+void subscription_dispatcher::subscribe_to_account( subscriber_id_type subscriber, account_id_type account )
+{
+   auto itr = _subscribers.find( subscriber );
+   if( itr == _subscribers.end() )
+      return;
+
+   if( itr->second.accounts.insert( account ).second )
+      _account_subscribers[account].insert( subscriber );
+}
+
+size_t subscription_dispatcher::get_subscribed_accounts_count( subscriber_id_type subscriber )const
+{
+   auto itr = _subscribers.find( subscriber );
+   return itr != _subscribers.end() ? itr->second.accounts.size() : 0;
+}
+
+void subscription_dispatcher::on_objects_changed( bool notify_remove_create, bool full_object, const vector<object_id_type>& ids,
+                                                  const flat_set<account_id_type>& impacted_accounts,
+                                                  const std::function<const object*(object_id_type)>& find_object )
+{
+   if( _subscribers.empty() )
+      return;
+
+   // Subscribers which get every object of this batch.
+   std::set<subscriber_id_type> batch_subscribers;
+   if( notify_remove_create )
+      batch_subscribers = _remove_create_subscribers;
+   for( const account_id_type& account : impacted_accounts )
+   {
+      auto itr = _account_subscribers.find( account );
+      if( itr != _account_subscribers.end() )
+         batch_subscribers.insert( itr->second.begin(), itr->second.end() );
+   }
+
+   std::map<subscriber_id_type, vector<fc::variant>> updates;
+   for( const object_id_type& id : ids )
+   {
+      const auto object_itr = _object_subscribers.find( id );
+      if( batch_subscribers.empty() && object_itr == _object_subscribers.end() )
+         continue;
+
+      // Converted once, copies of the variant share its contents.
+      fc::variant update;
+      if( full_object )
+      {
+         const object* obj = find_object( id );
+         if( obj == nullptr )
+            continue;
+         update = obj->to_variant();
+      }
+      else
+      {
+         update = fc::variant( id );
+      }
+
+      for( const subscriber_id_type subscriber : batch_subscribers )
+         updates[subscriber].push_back( update );
+      if( object_itr != _object_subscribers.end() )
+      {
+         for( const subscriber_id_type subscriber : object_itr->second )
+         {
+            if( batch_subscribers.find( subscriber ) == batch_subscribers.end() )
+               updates[subscriber].push_back( update );
+         }
+      }
+   }
+
+   if( updates.empty() )
+      return;
+
+   auto capture_this = shared_from_this();
+   fc::async([capture_this, updates](){
+      for( const auto& item : updates )
+      {
+         auto itr = capture_this->_subscribers.find( item.first );
+         if( itr == capture_this->_subscribers.end() || !itr->second.callback )
+            continue;
+
+         try
+         {
+            itr->second.callback( fc::variant( item.second ) );
+         }
+         catch( const fc::exception& e )
+         {
+            wlog( "Failed to notify subscriber ${s}: ${e}", ("s",item.first)("e",e.to_detail_string()) );
+         }
+      }
+   });
+}
+
+} } // graphene::app
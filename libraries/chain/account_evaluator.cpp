@@ -382,11 +382,6 @@ void_result account_update_evaluator::do_apply( const account_update_operation&
           a.escrow_fee = *o.escrow_fee;
       }
 
-      if(o.escrows)
-      {
-          a.escrows = *o.escrows;
-      }
-
       // This must be evaluated after 'is_a_publisher' update.
       if(a.is_a_publisher)
       {
@@ -429,6 +424,11 @@ void_result account_update_evaluator::do_apply( const account_update_operation&
       sa_after = a.has_special_authority();
    });
 
+   if( o.escrows )
+   {
+      d.update_account_escrows( o.account, *o.escrows );
+   }
+
    if( sa_before && (!sa_after) )
    {
       const auto& sa_idx = d.get_index_type< special_authority_index >().indices().get<by_account>();
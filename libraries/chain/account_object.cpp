@@ -28,6 +28,7 @@
 #include <fc/uint128.hpp>
 
 #include "omnibazaar_util.hpp"
+#include <reputation_vote_object.hpp>
 
 namespace graphene { namespace chain {
 
@@ -250,121 +251,459 @@ void account_member_index::object_modified(const object& after)
 void account_referrer_index::object_inserted( const object& obj )
 {
     const account_object& a = static_cast<const account_object&>(obj);
-    referred_by[a.referrer].insert(a.get_id());
+    add_referral(a.referrer, a.get_id());
 }
 void account_referrer_index::object_removed( const object& obj )
 {
     const account_object& a = static_cast<const account_object&>(obj);
-    const auto& iter = referred_by.find(a.referrer);
+    remove_referral(a.referrer, a.get_id());
+}
+void account_referrer_index::about_to_modify( const object& before )
+{
+    const account_object& a = static_cast<const account_object&>(before);
+    before_referrer = a.referrer;
+}
+void account_referrer_index::object_modified( const object& after  )
+{
+    const account_object& a = static_cast<const account_object&>(after);
+    if(a.referrer != before_referrer)
+    {
+        remove_referral(before_referrer, a.get_id());
+        add_referral(a.referrer, a.get_id());
+    }
+}
+
+size_t account_referrer_index::max_referred()const
+{
+    return referred_counts.empty() ? 0 : *referred_counts.rbegin();
+}
+
+void account_referrer_index::add_referral( account_id_type referrer, account_id_type referred )
+{
+    auto& referred_accounts = referred_by[referrer];
+    const size_t old_count = referred_accounts.size();
+    referred_accounts.insert(referred);
+    update_referred_count(old_count, referred_accounts.size());
+}
+
+void account_referrer_index::remove_referral( account_id_type referrer, account_id_type referred )
+{
+    const auto& iter = referred_by.find(referrer);
     if(iter == referred_by.cend())
         return;
 
-    iter->second.erase(a.get_id());
+    const size_t old_count = iter->second.size();
+    iter->second.erase(referred);
+    update_referred_count(old_count, iter->second.size());
     if(iter->second.size() <= 0)
     {
         referred_by.erase(iter);
     }
 }
-void account_referrer_index::about_to_modify( const object& before )
+
+void account_referrer_index::update_referred_count( size_t old_count, size_t new_count )
 {
-    object_removed(before);
+    if(old_count == new_count)
+        return;
+    if(old_count > 0)
+        referred_counts.erase(referred_counts.find(old_count));
+    if(new_count > 0)
+        referred_counts.insert(new_count);
 }
-void account_referrer_index::object_modified( const object& after  )
+
+void account_score_index::object_inserted( const object& obj )
 {
-    object_inserted(after);
+    const account_object& a = static_cast<const account_object&>(obj);
+    changed_accounts.insert(a.get_id());
+    // Referrer's Referral Score depends on the number of accounts it referred.
+    changed_accounts.insert(a.referrer);
 }
 
-void account_escrow_index::object_inserted( const object& obj )
+void account_score_index::object_removed( const object& obj )
 {
     const account_object& a = static_cast<const account_object&>(obj);
-    if(a.is_an_escrow)
+    changed_accounts.erase(a.get_id());
+    changed_accounts.insert(a.referrer);
+}
+
+void account_score_index::about_to_modify( const object& before )
+{
+    const account_object& a = static_cast<const account_object&>(before);
+    before_referrer = a.referrer;
+}
+
+void account_score_index::object_modified( const object& after  )
+{
+    const account_object& a = static_cast<const account_object&>(after);
+    changed_accounts.insert(a.get_id());
+    if(a.referrer != before_referrer)
     {
-		account_object_name newObj(a.get_id(), a.name);
-		this->insert_keeping_sorted(newObj);
+        changed_accounts.insert(before_referrer);
+        changed_accounts.insert(a.referrer);
     }
 }
 
-void account_escrow_index::object_removed( const object& obj )
+void account_reputation_weight_index::object_inserted( const object& obj )
+{
+    const account_statistics_object& s = static_cast<const account_statistics_object&>(obj);
+    if(s.reputation_weight_sum > 0)
+        weight_sums.insert(s.reputation_weight_sum);
+    changed_accounts.insert(s.owner);
+}
+
+void account_reputation_weight_index::object_removed( const object& obj )
+{
+    const account_statistics_object& s = static_cast<const account_statistics_object&>(obj);
+    if(s.reputation_weight_sum > 0)
+        weight_sums.erase(weight_sums.find(s.reputation_weight_sum));
+}
+
+void account_reputation_weight_index::about_to_modify( const object& before )
+{
+    const account_statistics_object& s = static_cast<const account_statistics_object&>(before);
+    before_weighted_votes_sum = s.reputation_weighted_votes_sum;
+    before_weight_sum = s.reputation_weight_sum;
+}
+
+void account_reputation_weight_index::object_modified( const object& after  )
+{
+    // Statistics are modified on every fee payment, so only do the work when reputation actually changed.
+    const account_statistics_object& s = static_cast<const account_statistics_object&>(after);
+    if(s.reputation_weighted_votes_sum == before_weighted_votes_sum && s.reputation_weight_sum == before_weight_sum)
+        return;
+
+    if(s.reputation_weight_sum != before_weight_sum)
+    {
+        if(before_weight_sum > 0)
+            weight_sums.erase(weight_sums.find(before_weight_sum));
+        if(s.reputation_weight_sum > 0)
+            weight_sums.insert(s.reputation_weight_sum);
+    }
+    changed_accounts.insert(s.owner);
+}
+
+fc::uint128_t account_reputation_weight_index::max_weight_sum()const
+{
+    return weight_sums.empty() ? fc::uint128_t(0) : *weight_sums.rbegin();
+}
+
+account_vote_weight_index::stake_entry& account_vote_weight_index::get_entry( account_id_type account )
+{
+    if( account.instance.value >= entries.size() )
+        entries.resize( account.instance.value + 1 );
+    return entries[account.instance.value];
+}
+
+account_id_type account_vote_weight_index::get_opinion_account( account_id_type account, const stake_entry& entry )const
+{
+    return entry.voting_account == GRAPHENE_PROXY_TO_SELF_ACCOUNT ? account : entry.voting_account;
+}
+
+void account_vote_weight_index::add_votes( const flat_set<vote_id_type>& votes, uint64_t stake )
+{
+    for( const vote_id_type& id : votes )
+    {
+        if( id.instance() >= vote_totals.size() )
+            vote_totals.resize( id.instance() + 1 );
+        vote_totals[id.instance()] += stake;
+    }
+}
+
+void account_vote_weight_index::adjust_stake( account_id_type account, int64_t delta )
+{
+    if( delta == 0 )
+        return;
+
+    stake_entry& entry = get_entry( account );
+    entry.stake += uint64_t(delta);
+    stake_entry& opinion_entry = get_entry( get_opinion_account( account, entry ) );
+    opinion_entry.voting_stake += uint64_t(delta);
+    add_votes( opinion_entry.votes, uint64_t(delta) );
+    total_stake += uint64_t(delta);
+}
+
+void account_vote_weight_index::set_options( account_id_type account, account_id_type voting_account,
+                                             const flat_set<vote_id_type>& votes )
+{
+    stake_entry& entry = get_entry( account );
+    if( entry.voting_account == voting_account && entry.votes == votes )
+        return;
+
+    // Take stake of the account away from its old voting account, move stake voting through the account
+    // from old to new votes, then give stake of the account to its new voting account.
+    const uint64_t stake = entry.stake;
+    adjust_stake( account, -int64_t(stake) );
+
+    stake_entry& changed_entry = get_entry( account );
+    add_votes( changed_entry.votes, uint64_t(0) - changed_entry.voting_stake );
+    add_votes( votes, changed_entry.voting_stake );
+    changed_entry.votes = votes;
+    changed_entry.voting_account = voting_account;
+
+    adjust_stake( account, int64_t(stake) );
+}
+
+uint64_t account_vote_weight_index::get_votes( vector<uint64_t>& votes )const
+{
+    const size_t count = std::min( votes.size(), vote_totals.size() );
+    std::copy( vote_totals.begin(), vote_totals.begin() + count, votes.begin() );
+    std::fill( votes.begin() + count, votes.end(), 0 );
+    return total_stake;
+}
+
+void account_vote_weight_index::object_inserted( const object& obj )
 {
     const account_object& a = static_cast<const account_object&>(obj);
-   
-	auto escrow_it = std::lower_bound(current_escrows.begin(), current_escrows.end(), a.name, account_object_name_comparer());
+    set_options( a.id, a.options.voting_account, a.options.votes );
+}
+
+void account_vote_weight_index::object_removed( const object& obj )
+{
+    const account_object& a = static_cast<const account_object&>(obj);
+    set_options( a.id, GRAPHENE_PROXY_TO_SELF_ACCOUNT, flat_set<vote_id_type>() );
+}
+
+void account_vote_weight_index::object_modified( const object& after  )
+{
+    const account_object& a = static_cast<const account_object&>(after);
+    set_options( a.id, a.options.voting_account, a.options.votes );
+}
+
+void account_balance_vote_weight_index::object_inserted( const object& obj )
+{
+    const account_balance_object& b = static_cast<const account_balance_object&>(obj);
+    if( b.asset_type == asset_id_type() )
+        vote_weights->adjust_stake( b.owner, b.balance.value );
+}
 
-	if (escrow_it != current_escrows.end() && escrow_it->id == a.get_id())
-	{
-		current_escrows.erase(escrow_it);
-	}
+void account_balance_vote_weight_index::object_removed( const object& obj )
+{
+    const account_balance_object& b = static_cast<const account_balance_object&>(obj);
+    if( b.asset_type == asset_id_type() )
+        vote_weights->adjust_stake( b.owner, -b.balance.value );
+}
+
+void account_balance_vote_weight_index::about_to_modify( const object& before )
+{
+    before_balance = static_cast<const account_balance_object&>(before).balance;
+}
+
+void account_balance_vote_weight_index::object_modified( const object& after  )
+{
+    const account_balance_object& b = static_cast<const account_balance_object&>(after);
+    if( b.asset_type == asset_id_type() )
+        vote_weights->adjust_stake( b.owner, (b.balance - before_balance).value );
+}
+
+void account_statistics_vote_weight_index::object_inserted( const object& obj )
+{
+    const account_statistics_object& s = static_cast<const account_statistics_object&>(obj);
+    vote_weights->adjust_stake( s.owner, s.total_core_in_orders.value );
+}
+
+void account_statistics_vote_weight_index::object_removed( const object& obj )
+{
+    const account_statistics_object& s = static_cast<const account_statistics_object&>(obj);
+    vote_weights->adjust_stake( s.owner, -s.total_core_in_orders.value );
 }
 
-void account_escrow_index::about_to_modify( const object& before )
+void account_statistics_vote_weight_index::about_to_modify( const object& before )
 {
+    before_core_in_orders = static_cast<const account_statistics_object&>(before).total_core_in_orders;
+}
+
+void account_statistics_vote_weight_index::object_modified( const object& after  )
+{
+    const account_statistics_object& s = static_cast<const account_statistics_object&>(after);
+    vote_weights->adjust_stake( s.owner, (s.total_core_in_orders - before_core_in_orders).value );
+}
+
+void account_escrow_index::object_inserted( const object& obj )
+{
+    const account_object& a = static_cast<const account_object&>(obj);
+    if(a.is_an_escrow)
+    {
+        add(a);
+    }
+}
+
+void account_escrow_index::object_removed( const object& obj )
+{
+    remove(obj.id);
 }
 
 void account_escrow_index::object_modified( const object& after  )
 {
     const account_object& a = static_cast<const account_object&>(after);
-	
+
+    const auto iter = escrows.find(a.id);
+    if(iter != escrows.end())
+    {
+        // Most account changes don't affect escrow lookup.
+        if(a.is_an_escrow
+                && iter->second.name == a.name
+                && iter->second.pop_score == a.pop_score
+                && iter->second.reputation_score == a.reputation_score)
+        {
+            return;
+        }
+        remove(a.id);
+    }
+
     if(a.is_an_escrow)
     {
-		// check whether to add a new account_object_name or just to update the existing one
-		auto escrow_it = std::lower_bound(current_escrows.begin(), current_escrows.end(), a.name, account_object_name_comparer());
-
-		if (escrow_it == current_escrows.end() || escrow_it->id != a.get_id())
-		{
-			// this means add
-			account_object_name newObj(a.get_id(), a.name);
-			current_escrows.insert(escrow_it, newObj);
-		}
-		else
-		{
-			// this means update
-			escrow_it->name = a.name;
-		}		
+        add(a);
     }
-    else
+}
+
+account_escrow_index::score_key account_escrow_index::get_score_key( account_id_type id, const escrow_info& info )
+{
+    return std::make_tuple(info.pop_score, info.reputation_score, id);
+}
+
+std::set<std::string> account_escrow_index::get_trigrams( const std::string& name )
+{
+    std::set<std::string> result;
+    for(size_t i = 0; i + 3 <= name.size(); ++i)
     {
-		this->object_removed(a);
+        result.insert(name.substr(i, 3));
     }
+    return result;
 }
 
+void account_escrow_index::add( const account_object& a )
+{
+    const escrow_info info{a.name, a.pop_score, a.reputation_score};
+    escrows[a.id] = info;
+    escrows_by_name[a.name] = a.id;
+    escrows_by_score.insert(get_score_key(a.id, info));
+    for(const std::string& trigram : get_trigrams(a.name))
+    {
+        escrows_by_trigram[trigram].insert(a.id);
+    }
+}
 
-void account_escrow_index::insert_keeping_sorted(const account_object_name& account_object_name)
+void account_escrow_index::remove( account_id_type id )
 {
-	auto escrow_it = std::lower_bound(current_escrows.begin(), current_escrows.end(), account_object_name.name, account_object_name_comparer());
-	current_escrows.insert(escrow_it, account_object_name);
+    const auto iter = escrows.find(id);
+    if(iter == escrows.end())
+    {
+        return;
+    }
+
+    const escrow_info& info = iter->second;
+    escrows_by_name.erase(info.name);
+    escrows_by_score.erase(get_score_key(id, info));
+    for(const std::string& trigram : get_trigrams(info.name))
+    {
+        const auto trigram_iter = escrows_by_trigram.find(trigram);
+        trigram_iter->second.erase(id);
+        if(trigram_iter->second.empty())
+        {
+            escrows_by_trigram.erase(trigram_iter);
+        }
+    }
+    escrows.erase(iter);
 }
 
 std::vector<account_object_name> account_escrow_index::filter_by_name(uint32_t start, uint32_t limit, const std::string& search_term) const
 {
-	std::vector<account_object_name> result;
-	result.reserve(limit);
+    std::vector<account_object_name> result;
 
-	// find the first match for the search_term
-	auto escrow_it = std::lower_bound(current_escrows.begin(), current_escrows.end(), search_term, account_object_name_comparer()); 
+    // find the first match for the search_term and skip 'start' matches
+    auto escrow_it = escrows_by_name.lower_bound(search_term);
+    for(uint32_t i = 0; i < start && escrow_it != escrows_by_name.end() && escrow_it->first.compare(0, search_term.size(), search_term) == 0; ++i)
+    {
+        ++escrow_it;
+    }
 
-	// check if we can advance the iterator 'start' times
-	if (escrow_it - current_escrows.begin() + start >= current_escrows.size())
-	{
-		return result;
-	}
+    // names that start with search term are sorted together, so we're done at the first one that doesn't
+    for(; escrow_it != escrows_by_name.end() && result.size() < limit; ++escrow_it)
+    {
+        if(escrow_it->first.compare(0, search_term.size(), search_term) != 0)
+            break;
+        result.emplace_back(escrow_it->second, escrow_it->first);
+    }
 
-	// advance the iterator 'start' times
-	escrow_it += start;
-	
-	while (escrow_it != current_escrows.end() && result.size() < limit)
-	{
-		// get the current escrow name
-		const std::string current_escrow_name = escrow_it->name;
-		
-		// if the escrow name doesn't start with search term, we're done
-		if (current_escrow_name.find(search_term) != 0)
-			break;
+    return result;
+}
 
-		result.push_back(*escrow_it);
-		escrow_it++;
-	}
+std::vector<account_object_name> account_escrow_index::search_by_name(const std::string& search_term, bool substring,
+                                                                      const std::string& start_name, uint32_t limit) const
+{
+    std::vector<account_object_name> result;
 
-	return result;
+    if(!substring)
+    {
+        const std::string& lower_bound = std::max(search_term, start_name);
+        for(auto escrow_it = escrows_by_name.lower_bound(lower_bound);
+            escrow_it != escrows_by_name.end() && result.size() < limit && escrow_it->first.compare(0, search_term.size(), search_term) == 0;
+            ++escrow_it)
+        {
+            result.emplace_back(escrow_it->second, escrow_it->first);
+        }
+        return result;
+    }
+
+    const std::set<std::string> trigrams = get_trigrams(search_term);
+    if(trigrams.empty())
+    {
+        // Search term is too short to use trigrams, but it is contained in most names anyway.
+        for(auto escrow_it = escrows_by_name.lower_bound(start_name);
+            escrow_it != escrows_by_name.end() && result.size() < limit;
+            ++escrow_it)
+        {
+            if(escrow_it->first.find(search_term) != std::string::npos)
+                result.emplace_back(escrow_it->second, escrow_it->first);
+        }
+        return result;
+    }
+
+    // Candidates are escrows which have the least common trigram of search term.
+    const std::set<account_id_type>* candidates = nullptr;
+    for(const std::string& trigram : trigrams)
+    {
+        const auto trigram_iter = escrows_by_trigram.find(trigram);
+        if(trigram_iter == escrows_by_trigram.end())
+            return result;
+        if(candidates == nullptr || trigram_iter->second.size() < candidates->size())
+            candidates = &trigram_iter->second;
+    }
+
+    for(const account_id_type& id : *candidates)
+    {
+        const std::string& name = escrows.at(id).name;
+        if(name >= start_name && name.find(search_term) != std::string::npos)
+            result.emplace_back(id, name);
+    }
+    std::sort(result.begin(), result.end(), [](const account_object_name& a, const account_object_name& b){
+        return a.name < b.name;
+    });
+    if(result.size() > limit)
+        result.resize(limit);
+
+    return result;
+}
+
+std::vector<account_object_name> account_escrow_index::list_by_score(const optional<account_id_type>& start, uint32_t limit) const
+{
+    std::vector<account_object_name> result;
+
+    auto escrow_it = escrows_by_score.begin();
+    if(start.valid())
+    {
+        const auto start_it = escrows.find(*start);
+        FC_ASSERT( start_it != escrows.end(), "Account ${a} is not an escrow.", ("a", *start) );
+        escrow_it = escrows_by_score.find(get_score_key(*start, start_it->second));
+    }
+
+    for(; escrow_it != escrows_by_score.end() && result.size() < limit; ++escrow_it)
+    {
+        const account_id_type id = std::get<2>(*escrow_it);
+        result.emplace_back(id, escrows.at(id).name);
+    }
+
+    return result;
 }
 
 void account_object::update_reputation(database& db, const account_id_type target, const account_id_type from, const uint16_t reputation, const asset amount)
@@ -372,23 +711,59 @@ void account_object::update_reputation(database& db, const account_id_type targe
     pop_dlog("Updating reputation vote ${vote} for ${seller} from ${buyer}.",
              ("vote", reputation)("seller", target)("buyer", from));
 
-    // Temporarily update reputation_votes to calculate Reputation Score for display.
-    account_object target_account = target(db);
-    account_statistics_object stats = target_account.statistics(db);
-    if(reputation == OMNIBAZAAR_REPUTATION_DEFAULT)
-        stats.reputation_votes.erase(from);
-    else
-        stats.reputation_votes[from] = std::make_pair(reputation, amount);
-
-    // Calculate score outside of database::modify callback.
-    fc::uint128_t weighted_votes_sum = 0;
-    fc::uint128_t weight_sum = 0;
-    for(const auto& iter : stats.reputation_votes)
+    // Each vote is a separate object, so changing one vote doesn't copy all other votes of target account into undo state.
+    // Running sums are adjusted by the difference between old and new vote, so that score is calculated without iterating all votes.
+    fc::uint128_t weighted_votes_sum_delta_add = 0;
+    fc::uint128_t weighted_votes_sum_delta_sub = 0;
+    fc::uint128_t weight_sum_delta_add = 0;
+    fc::uint128_t weight_sum_delta_sub = 0;
+    int64_t votes_count_delta = 0;
+
+    const auto& votes_idx = db.get_index_type<omnibazaar::reputation_vote_index>().indices().get<omnibazaar::by_target_voter>();
+    const auto old_vote = votes_idx.find(boost::make_tuple(target, from));
+    if(old_vote != votes_idx.end())
     {
-        const std::pair<uint16_t, asset> vote_info = iter.second;
-        weighted_votes_sum += fc::uint128_t(vote_info.first) * vote_info.second.amount.value;
-        weight_sum += vote_info.second.amount.value;
+        weighted_votes_sum_delta_sub = fc::uint128_t(old_vote->reputation) * old_vote->amount.amount.value;
+        weight_sum_delta_sub = old_vote->amount.amount.value;
     }
+
+    // Default reputation votes do not count towards Reputation Score
+    // so there's no point in storing them and wasting space.
+    if(reputation != OMNIBAZAAR_REPUTATION_DEFAULT)
+    {
+        weighted_votes_sum_delta_add = fc::uint128_t(reputation) * amount.amount.value;
+        weight_sum_delta_add = amount.amount.value;
+        if(old_vote != votes_idx.end())
+        {
+            db.modify(*old_vote, [&](omnibazaar::reputation_vote_object& v){
+                v.reputation = reputation;
+                v.amount = amount;
+            });
+        }
+        else
+        {
+            db.create<omnibazaar::reputation_vote_object>([&](omnibazaar::reputation_vote_object& v){
+                v.target = target;
+                v.voter = from;
+                v.reputation = reputation;
+                v.amount = amount;
+            });
+            ++votes_count_delta;
+        }
+    }
+    else if(old_vote != votes_idx.end())
+    {
+        db.remove(*old_vote);
+        --votes_count_delta;
+    }
+
+    // Update reputation for receiving account.
+    const account_statistics_object& target_stats = target(db).statistics(db);
+    db.modify(target_stats, [&](account_statistics_object& s){
+        s.reputation_weighted_votes_sum = s.reputation_weighted_votes_sum - weighted_votes_sum_delta_sub + weighted_votes_sum_delta_add;
+        s.reputation_weight_sum = s.reputation_weight_sum - weight_sum_delta_sub + weight_sum_delta_add;
+    });
+
     // Just for display, store score without transfers number weight applied.
     // Raw formula is:
     //    weighted_votes_sum
@@ -396,40 +771,19 @@ void account_object::update_reputation(database& db, const account_id_type targe
     //        weight_sum         * GRAPHENE_100_PERCENT
     // -------------------------
     // OMNIBAZAAR_REPUTATION_MAX
-    const uint16_t score = weight_sum > 0
-            ? (weighted_votes_sum * GRAPHENE_100_PERCENT / weight_sum / OMNIBAZAAR_REPUTATION_MAX).to_integer()
+    const uint16_t score = target_stats.reputation_weight_sum > 0
+            ? (target_stats.reputation_weighted_votes_sum * GRAPHENE_100_PERCENT / target_stats.reputation_weight_sum / OMNIBAZAAR_REPUTATION_MAX).to_integer()
             : 0;
     pop_ddump((score));
 
-    // Update reputation for receiving account.
-    db.modify(target(db).statistics(db), [&](account_statistics_object& s){
-        if(reputation == OMNIBAZAAR_REPUTATION_DEFAULT)
-        {
-            // Default reputation votes do not count towards Reputation Score
-            // so there's no point in storing them and wasting space.
-            s.reputation_votes.erase(from);
-        }
-        else
-        {
-            s.reputation_votes[from] = std::make_pair(reputation, amount);
-        }
-    });
-    db.modify(target(db), [&](account_object &acc){
-        acc.reputation_unweighted_score = score;
-        acc.reputation_votes_count = stats.reputation_votes.size();
-    });
-
-    // Update reputation for sending account.
-    db.modify(from(db).statistics(db), [&](account_statistics_object& s){
-        if(reputation > OMNIBAZAAR_REPUTATION_DEFAULT)
-        {
-            s.my_reputation_votes.insert(target);
-        }
-        else
-        {
-            s.my_reputation_votes.erase(target);
-        }
-    });
+    const account_object& target_account = target(db);
+    if(target_account.reputation_unweighted_score != score || votes_count_delta != 0)
+    {
+        db.modify(target_account, [&](account_object &acc){
+            acc.reputation_unweighted_score = score;
+            acc.reputation_votes_count += votes_count_delta;
+        });
+    }
 }
 
 } } // graphene::chain
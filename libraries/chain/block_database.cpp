@@ -23,9 +23,15 @@
  */
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/io/datastream.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/smart_ref_impl.hpp>
 
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
 namespace graphene { namespace chain {
 
 struct index_entry
@@ -39,40 +45,169 @@ FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
 
 namespace graphene { namespace chain {
 
+namespace {
+   // Files are grown by these amounts to avoid remapping them on every stored block.
+   const uint64_t index_chunk_size  = 4 * 1024 * 1024;
+   const uint64_t blocks_chunk_size = 64 * 1024 * 1024;
+
+   uint64_t capacity_for( uint64_t size, uint64_t chunk_size )
+   {
+      return ( size / chunk_size + 1 ) * chunk_size;
+   }
+}
+
+/**
+ * Read-write mapping of the whole file, which is resized to requested capacity first.
+ */
+class block_database::mapped_file
+{
+   public:
+      mapped_file( const fc::path& filename, uint64_t capacity )
+      :_capacity( capacity )
+      {
+         fc::resize_file( filename, capacity );
+         _mapping.reset( new fc::file_mapping( filename.generic_string().c_str(), fc::read_write ) );
+         _region.reset( new fc::mapped_region( *_mapping, fc::read_write, 0, capacity ) );
+         _data = static_cast<char*>( _region->get_address() );
+      }
+
+      char*    data()const     { return _data; }
+      uint64_t capacity()const { return _capacity; }
+      void     flush()         { _region->flush(); }
+
+   private:
+      std::unique_ptr<fc::file_mapping>  _mapping;
+      std::unique_ptr<fc::mapped_region> _region;
+      char*                              _data = nullptr;
+      uint64_t                           _capacity = 0;
+};
+
+/**
+ * Snapshot of mapped files and their used sizes. A new snapshot is published whenever sizes or mappings change,
+ * so readers never access data beyond what was completely written when they took the snapshot.
+ */
+struct block_database::mapped_state
+{
+   std::shared_ptr<mapped_file> index;
+   std::shared_ptr<mapped_file> blocks;
+   uint64_t                     index_size = 0;
+   uint64_t                     blocks_size = 0;
+
+   index_entry entry_at( uint64_t index_pos )const
+   {
+      index_entry e;
+      std::memcpy( (char*)&e, index->data() + index_pos, sizeof(e) );
+      return e;
+   }
+};
+
 void block_database::open( const fc::path& dbdir )
 { try {
+   std::lock_guard<std::mutex> lock( _write_mutex );
    fc::create_directories(dbdir);
-   _block_num_to_pos.exceptions(std::ios_base::failbit | std::ios_base::badbit);
-   _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   _blocks_filename = dbdir / "blocks";
    if( !fc::exists( _index_filename ) )
    {
-     _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+      std::ofstream( _index_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+      std::ofstream( _blocks_filename.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+   }
+   FC_ASSERT( fc::exists( _blocks_filename ), "Missing blocks file" );
+
+   const uint64_t index_file_size = fc::file_size( _index_filename );
+   const uint64_t blocks_file_size = fc::file_size( _blocks_filename );
+
+   auto state = std::make_shared<mapped_state>();
+   state->index = std::make_shared<mapped_file>( _index_filename, capacity_for( index_file_size, index_chunk_size ) );
+   state->blocks = std::make_shared<mapped_file>( _blocks_filename, capacity_for( blocks_file_size, blocks_chunk_size ) );
+   state->index_size = index_file_size - index_file_size % sizeof(index_entry);
+   state->blocks_size = blocks_file_size;
+
+   // Drop entries at the end of index that don't point to valid blocks,
+   // e.g. removed blocks or slack space left by unclean shutdown.
+   while( state->index_size >= sizeof(index_entry) )
+   {
+      const index_entry e = state->entry_at( state->index_size - sizeof(index_entry) );
+      try
+      {
+         if( read_block( *state, e ).valid() )
+            break;
+      }
+      catch (const fc::exception&)
+      {
+      }
+      catch (const std::exception&)
+      {
+      }
+      state->index_size -= sizeof(index_entry);
+   }
+   std::memset( state->index->data() + state->index_size, 0, index_file_size - state->index_size );
+
+   // Find the end of block data. This is the end of the last block unless blocks were stored out of order
+   // after switching forks, or blocks file contains slack space left by unclean shutdown.
+   uint64_t blocks_end = 0;
+   if( state->index_size > 0 )
+   {
+      const index_entry last = state->entry_at( state->index_size - sizeof(index_entry) );
+      blocks_end = last.block_pos + last.block_size;
    }
-   else
+   if( blocks_end != state->blocks_size )
    {
-     _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+      blocks_end = 0;
+      for( uint64_t index_pos = 0; index_pos < state->index_size; index_pos += sizeof(index_entry) )
+      {
+         const index_entry e = state->entry_at( index_pos );
+         if( e.block_size > 0 && e.block_pos + e.block_size <= state->blocks_size )
+            blocks_end = std::max( blocks_end, e.block_pos + e.block_size );
+      }
+      state->blocks_size = blocks_end;
    }
+
+   _unsynced_blocks = 0;
+   set_state( state );
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
 bool block_database::is_open()const
 {
-  return _blocks.is_open();
+  return get_state() != nullptr;
 }
 
 void block_database::close()
 {
-  _blocks.close();
-  _block_num_to_pos.close();
+  std::lock_guard<std::mutex> lock( _write_mutex );
+  auto state = get_state();
+  if( !state )
+     return;
+
+  state->blocks->flush();
+  state->index->flush();
+  set_state( nullptr );
+
+  // Unmap files before truncating slack space, so that files keep their original format on disk.
+  const uint64_t index_size = state->index_size;
+  const uint64_t blocks_size = state->blocks_size;
+  state.reset();
+  fc::resize_file( _index_filename, index_size );
+  fc::resize_file( _blocks_filename, blocks_size );
 }
 
 void block_database::flush()
 {
-  _blocks.flush();
-  _block_num_to_pos.flush();
+  std::lock_guard<std::mutex> lock( _write_mutex );
+  const auto state = get_state();
+  if( !state )
+     return;
+
+  // Blocks first, so that synced index never points to unsynced block data.
+  state->blocks->flush();
+  state->index->flush();
+  _unsynced_blocks = 0;
+}
+
+void block_database::set_sync_interval( uint32_t blocks )
+{
+   _sync_interval = blocks;
 }
 
 void block_database::store( const block_id_type& _id, const signed_block& b )
@@ -83,33 +218,69 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       id = b.id();
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
-   _block_num_to_pos.seekp( sizeof( index_entry ) * int64_t(block_header::num_from_id(id)) );
+
+   std::lock_guard<std::mutex> lock( _write_mutex );
+   const auto state = get_state();
+   FC_ASSERT( state, "Block database is not open" );
+
+   const auto vec = fc::raw::pack( b );
    index_entry e;
-   _blocks.seekp( 0, _blocks.end );
-   auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
+   e.block_pos  = state->blocks_size;
    e.block_size = vec.size();
    e.block_id   = id;
-   _blocks.write( vec.data(), vec.size() );
-   _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   const uint64_t index_pos = sizeof(e) * uint64_t(block_header::num_from_id(id));
+
+   auto new_state = std::make_shared<mapped_state>( *state );
+   new_state->blocks_size = e.block_pos + e.block_size;
+   if( new_state->blocks_size > new_state->blocks->capacity() )
+      new_state->blocks = std::make_shared<mapped_file>( _blocks_filename, capacity_for( new_state->blocks_size, blocks_chunk_size ) );
+   new_state->index_size = std::max( new_state->index_size, index_pos + sizeof(e) );
+   if( new_state->index_size > new_state->index->capacity() )
+      new_state->index = std::make_shared<mapped_file>( _index_filename, capacity_for( new_state->index_size, index_chunk_size ) );
+
+   // Block data is written beyond the end visible to readers, and index entry is written after it,
+   // so readers either see the old entry or the new entry pointing to complete data.
+   std::memcpy( new_state->blocks->data() + e.block_pos, vec.data(), vec.size() );
+   write_index_entry( *new_state, index_pos, e );
+   set_state( new_state );
+
+   if( _sync_interval > 0 && ++_unsynced_blocks >= _sync_interval )
+   {
+      new_state->blocks->flush();
+      new_state->index->flush();
+      _unsynced_blocks = 0;
+   }
 }
 
 void block_database::remove( const block_id_type& id )
 { try {
-   index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
-      FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block ${id} not contained in block database", ("id", id));
+   std::lock_guard<std::mutex> lock( _write_mutex );
+   const auto state = get_state();
+   FC_ASSERT( state, "Block database is not open" );
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   const uint64_t index_pos = sizeof(index_entry) * uint64_t(block_header::num_from_id(id));
+   if( index_pos + sizeof(index_entry) > state->index_size )
+      FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block ${id} not contained in block database", ("id", id));
 
+   index_entry e = state->entry_at( index_pos );
    if( e.block_id == id )
    {
       e.block_size = 0;
-      _block_num_to_pos.seekp( sizeof(e) * int64_t(block_header::num_from_id(id)) );
-      _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      write_index_entry( *state, index_pos, e );
+
+      // Drop removed entries from the end of index, so that they don't need to be skipped when looking for the last block.
+      if( index_pos + sizeof(index_entry) == state->index_size )
+      {
+         auto new_state = std::make_shared<mapped_state>( *state );
+         while( new_state->index_size >= sizeof(index_entry)
+                && new_state->entry_at( new_state->index_size - sizeof(index_entry) ).block_size == 0 )
+         {
+            new_state->index_size -= sizeof(index_entry);
+            // Readers of the previous state may still read this entry.
+            write_index_entry( *new_state, new_state->index_size, index_entry() );
+         }
+         set_state( new_state );
+      }
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
@@ -118,55 +289,41 @@ bool block_database::contains( const block_id_type& id )const
    if( id == block_id_type() )
       return false;
 
-   index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() < int64_t(index_pos + sizeof(e)) )
+   const auto state = get_state();
+   if( !state )
       return false;
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
-   return e.block_id == id && e.block_size > 0;
+   const optional<index_entry> e = read_index_entry( *state, block_header::num_from_id(id) );
+   return e.valid() && e->block_id == id && e->block_size > 0;
 }
 
 block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
-   index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_num);
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
-      FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
+   const auto state = get_state();
+   FC_ASSERT( state, "Block database is not open" );
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   const optional<index_entry> e = read_index_entry( *state, block_num );
+   if( !e.valid() )
+      FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
 
-   FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
-   return e.block_id;
+   FC_ASSERT( e->block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
+   return e->block_id;
 }
 
 optional<signed_block> block_database::fetch_optional( const block_id_type& id )const
 {
    try
    {
-      index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
-         return {};
-
-      _block_num_to_pos.seekg( index_pos );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
-      if( e.block_id != id ) return optional<signed_block>();
-
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      if (e.block_size)
-         _blocks.read( data.data(), e.block_size );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      const auto state = get_state();
+      if( !state )
+         return optional<signed_block>();
+
+      const optional<index_entry> e = read_index_entry( *state, block_header::num_from_id(id) );
+      if( !e.valid() || e->block_id != id )
+         return optional<signed_block>();
+
+      return read_block( *state, *e );
    }
    catch (const fc::exception&)
    {
@@ -181,21 +338,15 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
 {
    try
    {
-      index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_num);
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
-         return {};
-
-      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      _blocks.read( data.data(), e.block_size );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      const auto state = get_state();
+      if( !state )
+         return optional<signed_block>();
+
+      const optional<index_entry> e = read_index_entry( *state, block_num );
+      if( !e.valid() )
+         return optional<signed_block>();
+
+      return read_block( *state, *e );
    }
    catch (const fc::exception&)
    {
@@ -206,53 +357,29 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    return optional<signed_block>();
 }
 
-optional<index_entry> block_database::last_index_entry()const {
-   try
-   {
-      index_entry e;
-
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      std::streampos pos = _block_num_to_pos.tellg();
-      if( pos < long(sizeof(index_entry)) )
-         return optional<index_entry>();
-
-      pos -= pos % sizeof(index_entry);
+optional<index_entry> block_database::last_index_entry()const
+{
+   const auto state = get_state();
+   if( !state )
+      return optional<index_entry>();
 
-      _blocks.seekg( 0, _block_num_to_pos.end );
-      const std::streampos blocks_size = _blocks.tellg();
-      while( pos > 0 )
+   for( uint64_t index_pos = state->index_size; index_pos >= sizeof(index_entry); )
+   {
+      index_pos -= sizeof(index_entry);
+      const index_entry e = read_index_entry_at( *state, index_pos );
+      if( e.block_size == 0 )
+         continue;
+      try
+      {
+         if( read_block( *state, e ).valid() )
+            return e;
+      }
+      catch (const fc::exception&)
+      {
+      }
+      catch (const std::exception&)
       {
-         pos -= sizeof(index_entry);
-         _block_num_to_pos.seekg( pos );
-         _block_num_to_pos.read( (char*)&e, sizeof(e) );
-         if( _block_num_to_pos.gcount() == sizeof(e) && e.block_size > 0
-                && int64_t(e.block_pos + e.block_size) <= blocks_size )
-            try
-            {
-               vector<char> data( e.block_size );
-               _blocks.seekg( e.block_pos );
-               _blocks.read( data.data(), e.block_size );
-               if( _blocks.gcount() == long(e.block_size) )
-               {
-                  const signed_block block = fc::raw::unpack<signed_block>(data);
-                  if( block.id() == e.block_id )
-                     return e;
-               }
-            }
-            catch (const fc::exception&)
-            {
-            }
-            catch (const std::exception&)
-            {
-            }
-         fc::resize_file( _index_filename, pos );
       }
-   }
-   catch (const fc::exception&)
-   {
-   }
-   catch (const std::exception&)
-   {
    }
    return optional<index_entry>();
 }
@@ -271,4 +398,61 @@ optional<block_id_type> block_database::last_id()const
    return optional<block_id_type>();
 }
 
+optional<index_entry> block_database::read_index_entry( const mapped_state& state, uint32_t block_num )const
+{
+   const uint64_t index_pos = sizeof(index_entry) * uint64_t(block_num);
+   if( index_pos + sizeof(index_entry) > state.index_size )
+      return optional<index_entry>();
+   return read_index_entry_at( state, index_pos );
+}
+
+index_entry block_database::read_index_entry_at( const mapped_state& state, uint64_t index_pos )const
+{
+   // Entries are too large to be written atomically, so they are guarded by a sequence lock:
+   // the copy is retried if an entry was written while it was being copied.
+   while( true )
+   {
+      const uint64_t sequence = _index_sequence.load( std::memory_order_acquire );
+      if( sequence & 1 )
+         continue;
+      const index_entry e = state.entry_at( index_pos );
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if( _index_sequence.load( std::memory_order_relaxed ) == sequence )
+         return e;
+   }
+}
+
+void block_database::write_index_entry( const mapped_state& state, uint64_t index_pos, const index_entry& e )
+{
+   const uint64_t sequence = _index_sequence.load( std::memory_order_relaxed );
+   _index_sequence.store( sequence + 1, std::memory_order_relaxed );
+   std::atomic_thread_fence( std::memory_order_release );
+   std::memcpy( state.index->data() + index_pos, (const char*)&e, sizeof(e) );
+   _index_sequence.store( sequence + 2, std::memory_order_release );
+}
+
+optional<signed_block> block_database::read_block( const mapped_state& state, const index_entry& e )const
+{
+   if( e.block_size == 0 || e.block_pos + e.block_size > state.blocks_size )
+      return optional<signed_block>();
+
+   // Unpack directly from mapped memory without copying block data.
+   fc::datastream<const char*> ds( state.blocks->data() + e.block_pos, e.block_size );
+   signed_block result;
+   fc::raw::unpack( ds, result );
+   if( result.id() != e.block_id )
+      return optional<signed_block>();
+   return result;
+}
+
+std::shared_ptr<const block_database::mapped_state> block_database::get_state()const
+{
+   return std::atomic_load( &_state );
+}
+
+void block_database::set_state( const std::shared_ptr<const mapped_state>& state )
+{
+   std::atomic_store( &_state, state );
+}
+
 } }
@@ -118,6 +118,15 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   if( !(skip & (skip_transaction_signatures | skip_authority_check)) )
+   {
+      vector<const signed_transaction*> trxs;
+      trxs.reserve( new_block.transactions.size() );
+      for( const auto& trx : new_block.transactions )
+         trxs.push_back( &trx );
+      precompute_signature_keys( trxs );
+   }
+
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -305,47 +314,15 @@ processed_transaction database::push_escrow(const omnibazaar::escrow_object& esc
 {
     try
     {
-        transaction_evaluation_state eval_state(this);
-
-        // Create transaction that closes this escrow process.
-        processed_transaction ptrx;
-        ptrx.expiration = escrow.expiration_time;
-        if(release)
-        {
-            // Release funds to Seller.
-            omnibazaar::escrow_release_operation escrow_op;
-            escrow_op.escrow = escrow.id;
-            escrow_op.buyer_account = escrow.buyer;
-            escrow_op.escrow_account = escrow.escrow;
-            escrow_op.seller_account = escrow.seller;
-            escrow_op.fee_paying_account = escrow.buyer;
-            ptrx.operations.push_back(escrow_op);
-        }
-        else
-        {
-            // Return funds to Buyer.
-            omnibazaar::escrow_return_operation escrow_op;
-            escrow_op.escrow = escrow.id;
-            escrow_op.seller_account = escrow.seller;
-            escrow_op.escrow_account = escrow.escrow;
-            escrow_op.buyer_account = escrow.buyer;
-            escrow_op.fee_paying_account = escrow.seller;
-            ptrx.operations.push_back(escrow_op);
-        }
-        ptrx.validate();
-        eval_state._trx = &ptrx;
-
         size_t old_applied_ops_size = _applied_ops.size();
 
         // Apply transaction to the database.
         try
         {
             auto session = _undo_db.start_undo_session(true);
-            for(const auto& op : ptrx.operations)
-            {
-                eval_state.operation_results.emplace_back(apply_operation(eval_state, op));
-            }
+            processed_transaction ptrx = apply_escrow_expiration(escrow, release);
             session.merge();
+            return ptrx;
         }
         catch ( const fc::exception& e )
         {
@@ -364,13 +341,96 @@ processed_transaction database::push_escrow(const omnibazaar::escrow_object& esc
             elog( "e", ("e",e.to_detail_string() ) );
             throw;
         }
-
-        ptrx.operation_results = std::move(eval_state.operation_results);
-        return ptrx;
     }
     FC_CAPTURE_AND_RETHROW( (escrow) )
 }
 
+processed_transaction database::apply_escrow_expiration(const omnibazaar::escrow_object& escrow, const bool release)
+{
+    transaction_evaluation_state eval_state(this);
+
+    // Create transaction that closes this escrow process.
+    processed_transaction ptrx;
+    ptrx.expiration = escrow.expiration_time;
+    if(release)
+    {
+        // Release funds to Seller.
+        omnibazaar::escrow_release_operation escrow_op;
+        escrow_op.escrow = escrow.id;
+        escrow_op.buyer_account = escrow.buyer;
+        escrow_op.escrow_account = escrow.escrow;
+        escrow_op.seller_account = escrow.seller;
+        escrow_op.fee_paying_account = escrow.buyer;
+        ptrx.operations.push_back(escrow_op);
+    }
+    else
+    {
+        // Return funds to Buyer.
+        omnibazaar::escrow_return_operation escrow_op;
+        escrow_op.escrow = escrow.id;
+        escrow_op.seller_account = escrow.seller;
+        escrow_op.escrow_account = escrow.escrow;
+        escrow_op.buyer_account = escrow.buyer;
+        escrow_op.fee_paying_account = escrow.seller;
+        ptrx.operations.push_back(escrow_op);
+    }
+    ptrx.validate();
+    eval_state._trx = &ptrx;
+
+    for(const auto& op : ptrx.operations)
+    {
+        eval_state.operation_results.emplace_back(apply_operation(eval_state, op));
+    }
+
+    ptrx.operation_results = std::move(eval_state.operation_results);
+    return ptrx;
+}
+
+processed_transaction database::apply_listing_expiration(const omnibazaar::listing_object& listing)
+{
+    transaction_evaluation_state eval_state(this);
+
+    // Create transaction that deletes the listing.
+    omnibazaar::listing_delete_operation listing_op;
+    listing_op.listing_id = listing.id;
+    listing_op.seller = listing.seller;
+
+    processed_transaction ptrx;
+    ptrx.expiration = listing.expiration_time;
+    ptrx.operations.push_back(listing_op);
+    ptrx.validate();
+    eval_state._trx = &ptrx;
+
+    for(const auto& op : ptrx.operations)
+    {
+        eval_state.operation_results.emplace_back(apply_operation(eval_state, op));
+    }
+
+    ptrx.operation_results = std::move(eval_state.operation_results);
+    return ptrx;
+}
+
+bool database::apply_expirations_batch(const std::function<void()>& apply_all)
+{
+    const size_t old_applied_ops_size = _applied_ops.size();
+    const uint16_t old_virtual_op = _current_virtual_op;
+    try
+    {
+        auto session = _undo_db.start_undo_session(true);
+        apply_all();
+        session.merge();
+        return true;
+    }
+    catch( const fc::exception& e )
+    {
+        // Session is undone, so also drop operations applied in it and let caller process objects one by one.
+        dlog( "Failed to apply expirations in batch, processing them separately.\n${e}", ("e", e.to_detail_string()) );
+        _applied_ops.resize( old_applied_ops_size );
+        _current_virtual_op = old_virtual_op;
+        return false;
+    }
+}
+
 signed_block database::generate_block(
    fc::time_point_sec when,
    witness_id_type witness_id,
@@ -683,6 +743,28 @@ processed_transaction database::apply_transaction(const signed_transaction& trx,
    return result;
 }
 
+void database::precompute_signature_keys( const vector<const signed_transaction*>& trxs )const
+{
+   // A single transaction gains nothing from a worker thread, its keys are recovered when it is applied.
+   if( _worker_threads.empty() || trxs.size() < 2 )
+      return;
+
+   // Split transactions into contiguous chunks, one per thread, and wait until all keys are recovered.
+   const chain_id_type chain_id = get_chain_id();
+   const size_t chunk_size = (trxs.size() + _worker_threads.size() - 1) / _worker_threads.size();
+   vector<std::function<void()>> tasks;
+   for( size_t begin = 0; begin < trxs.size(); begin += chunk_size )
+   {
+      const size_t end = std::min( begin + chunk_size, trxs.size() );
+      tasks.emplace_back( [&trxs, &chain_id, begin, end]()
+      {
+         for( size_t i = begin; i < end; ++i )
+            trxs[i]->precompute_signature_keys( chain_id );
+      });
+   }
+   run_on_worker_threads( tasks );
+}
+
 processed_transaction database::_apply_transaction(const signed_transaction& trx)
 { try {
    uint32_t skip = get_node_properties().skip_flags;
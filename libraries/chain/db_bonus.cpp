@@ -1,5 +1,6 @@
 #include <graphene/chain/database.hpp>
 #include <omnibazaar_util.hpp>
+#include <seller_buyer_object.hpp>
 
 namespace graphene { namespace chain {
 
@@ -55,11 +56,11 @@ bool database::is_sale_bonus_available(const account_id_type &seller_id, const a
         return false;
     }
 
-    const account_object seller = seller_id(*this);
-    if(seller.buyers.find(buyer_id) != seller.buyers.end())
+    const auto& buyers_idx = get_index_type<omnibazaar::seller_buyer_index>().indices().get<omnibazaar::by_seller_buyer>();
+    if(buyers_idx.find(boost::make_tuple(seller_id, buyer_id)) != buyers_idx.end())
     {
         ilog("Sale bonus already received for seller '${seller}' and buyer '${buyer}'",
-             ("seller", seller.name)
+             ("seller", seller_id(*this).name)
              ("buyer", buyer_id(*this).name));
         return false;
     }
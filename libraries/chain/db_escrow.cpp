@@ -1,5 +1,7 @@
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/witness_object.hpp>
+#include <reputation_vote_object.hpp>
+#include <account_escrow_link_object.hpp>
 
 namespace graphene { namespace chain {
 
@@ -7,15 +9,15 @@ set<account_id_type> database::get_implicit_escrows(const account_id_type target
 {
     set<account_id_type> result;
 
-    const account_object target_account = target_account_id(*this);
+    const account_object& target_account = target_account_id(*this);
 
     // Add accounts that are current active witnesses.
     if(target_account.implicit_escrow_options.active_witness)
     {
         const auto& active_witnesses = get_global_properties().active_witnesses;
-        for(const auto witness_id : active_witnesses)
+        for(const witness_id_type witness_id : active_witnesses)
         {
-            const witness_object witness_obj = witness_id(*this);
+            const witness_object& witness_obj = witness_id(*this);
             if(witness_obj.witness_account(*this).is_an_escrow)
             {
                 result.insert(witness_obj.witness_account);
@@ -27,7 +29,7 @@ set<account_id_type> database::get_implicit_escrows(const account_id_type target
     if(target_account.implicit_escrow_options.voted_witness)
     {
         const auto& witness_by_vote_idx = get_index_type<witness_index>().indices().get<by_vote_id>();
-        for(const vote_id_type vote_id : target_account.options.votes)
+        for(const vote_id_type& vote_id : target_account.options.votes)
         {
             const auto witness_iter = witness_by_vote_idx.find(vote_id);
             if(witness_iter == witness_by_vote_idx.end())
@@ -43,12 +45,13 @@ set<account_id_type> database::get_implicit_escrows(const account_id_type target
     // Add accounts that target account gave positive rating to.
     if(target_account.implicit_escrow_options.positive_rating)
     {
-        const account_statistics_object& stats = target_account.statistics(*this);
-        for(const auto account_id : stats.my_reputation_votes)
+        const auto& votes_idx = get_index_type<omnibazaar::reputation_vote_index>().indices().get<omnibazaar::by_voter_target>();
+        const auto range = votes_idx.equal_range(target_account_id);
+        for(auto it = range.first; it != range.second; ++it)
         {
-            if(account_id(*this).is_an_escrow)
+            if(it->reputation > OMNIBAZAAR_REPUTATION_DEFAULT && it->target(*this).is_an_escrow)
             {
-                result.insert(account_id);
+                result.insert(it->target);
             }
         }
     }
@@ -56,4 +59,83 @@ set<account_id_type> database::get_implicit_escrows(const account_id_type target
     return result;
 }
 
+bool database::is_implicit_escrow(const account_id_type account_id, const account_id_type escrow_id) const
+{
+    // Same rules as get_implicit_escrows(), but only for a single candidate so that each rule
+    // is a lookup instead of a walk over all witnesses, votes and ratings of the account.
+    const account_object& escrow = escrow_id(*this);
+    if(!escrow.is_an_escrow)
+        return false;
+
+    const account_object& account = account_id(*this);
+
+    if(account.implicit_escrow_options.active_witness || account.implicit_escrow_options.voted_witness)
+    {
+        const auto& witness_by_account_idx = get_index_type<witness_index>().indices().get<by_account>();
+        const auto witness_iter = witness_by_account_idx.find(escrow_id);
+        if(witness_iter != witness_by_account_idx.end())
+        {
+            if(account.implicit_escrow_options.active_witness)
+            {
+                const auto& active_witnesses = get_global_properties().active_witnesses;
+                if(active_witnesses.find(witness_iter->id) != active_witnesses.end())
+                    return true;
+            }
+
+            if(account.implicit_escrow_options.voted_witness
+                    && account.options.votes.find(witness_iter->vote_id) != account.options.votes.end())
+                return true;
+        }
+    }
+
+    if(account.implicit_escrow_options.positive_rating)
+    {
+        const auto& votes_idx = get_index_type<omnibazaar::reputation_vote_index>().indices().get<omnibazaar::by_voter_target>();
+        const auto vote_iter = votes_idx.find(boost::make_tuple(account_id, escrow_id));
+        if(vote_iter != votes_idx.end() && vote_iter->reputation > OMNIBAZAAR_REPUTATION_DEFAULT)
+            return true;
+    }
+
+    return false;
+}
+
+bool database::is_acceptable_escrow(const account_id_type account_id, const account_id_type escrow_id) const
+{
+    const auto& links_idx = get_index_type<omnibazaar::account_escrow_link_index>().indices().get<omnibazaar::by_account_escrow>();
+    if(links_idx.find(boost::make_tuple(account_id, escrow_id)) != links_idx.end())
+    {
+        return true;
+    }
+
+    return is_implicit_escrow(account_id, escrow_id);
+}
+
+void database::update_account_escrows(const account_id_type account_id, const set<account_id_type>& escrows)
+{
+    const auto& links_idx = get_index_type<omnibazaar::account_escrow_link_index>().indices().get<omnibazaar::by_account_escrow>();
+
+    // Remove links that are not in the new list.
+    auto range = links_idx.equal_range(account_id);
+    for(auto it = range.first; it != range.second; )
+    {
+        const omnibazaar::account_escrow_link_object& link = *it++;
+        if(escrows.find(link.escrow) == escrows.end())
+        {
+            remove(link);
+        }
+    }
+
+    // Add links that don't exist yet.
+    for(const account_id_type escrow_id : escrows)
+    {
+        if(links_idx.find(boost::make_tuple(account_id, escrow_id)) == links_idx.end())
+        {
+            create<omnibazaar::account_escrow_link_object>([&](omnibazaar::account_escrow_link_object& link){
+                link.account = account_id;
+                link.escrow = escrow_id;
+            });
+        }
+    }
+}
+
 }}
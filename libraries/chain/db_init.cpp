@@ -76,6 +76,9 @@
 #include <exchange_evaluator.hpp>
 #include <reserved_names_object.hpp>
 #include <reserved_names_evaluator.hpp>
+#include <reputation_vote_object.hpp>
+#include <seller_buyer_object.hpp>
+#include <account_escrow_link_object.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
 #include <fc/smart_ref_impl.hpp>
@@ -218,6 +221,8 @@ void database::initialize_indexes()
    acnt_index->add_secondary_index<account_member_index>();
    acnt_index->add_secondary_index<account_referrer_index>();
    acnt_index->add_secondary_index<account_escrow_index>();
+   acnt_index->add_secondary_index<account_score_index>();
+   auto vote_weights = acnt_index->add_secondary_index<account_vote_weight_index>();
 
    add_index< primary_index<committee_member_index> >();
    add_index< primary_index<witness_index> >();
@@ -241,11 +246,17 @@ void database::initialize_indexes()
 
    //Implementation object indexes
    add_index< primary_index<transaction_index                             > >();
-   add_index< primary_index<account_balance_index                         > >();
+   auto bal_index = add_index< primary_index<account_balance_index                         > >();
+   bal_index->add_secondary_index<account_balance_vote_weight_index>()->vote_weights = vote_weights;
    add_index< primary_index<asset_bitasset_data_index                     > >();
    add_index< primary_index<simple_index<global_property_object          >> >();
    add_index< primary_index<simple_index<dynamic_global_property_object  >> >();
-   add_index< primary_index<simple_index<account_statistics_object       >> >();
+   auto stats_index = add_index< primary_index<simple_index<account_statistics_object       >> >();
+   stats_index->add_secondary_index<account_reputation_weight_index>();
+   stats_index->add_secondary_index<account_statistics_vote_weight_index>()->vote_weights = vote_weights;
+   // Balances and statistics feed stake into the vote weight index of accounts, they are loaded by the same thread.
+   add_load_dependency( *bal_index, *acnt_index );
+   add_load_dependency( *stats_index, *acnt_index );
    add_index< primary_index<simple_index<asset_dynamic_data_object       >> >();
    add_index< primary_index<simple_index<block_summary_object            >> >();
    add_index< primary_index<simple_index<chain_property_object          > > >();
@@ -255,6 +266,9 @@ void database::initialize_indexes()
    add_index< primary_index< buyback_index                                > >();
    add_index< primary_index<collateral_bid_index                          > >();
    add_index< primary_index<simple_index<omnibazaar::reserved_names_object>>>();
+   add_index< primary_index<omnibazaar::reputation_vote_index> >();
+   add_index< primary_index<omnibazaar::seller_buyer_index> >();
+   add_index< primary_index<omnibazaar::account_escrow_link_index> >();
 
    add_index< primary_index< simple_index< fba_accumulator_object       > > >();
 }
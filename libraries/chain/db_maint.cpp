@@ -227,54 +227,42 @@ void database::update_account_scores()
 
     // Referral Score
     // 1) find largest number of users referred by any user.
-    const auto& account_idx = dynamic_cast<const primary_index<account_index>&>(get_index_type<account_index>());
+    auto& account_idx = dynamic_cast<primary_index<account_index>&>(get_mutable_index_type<account_index>());
     const account_referrer_index& referrer_idx = account_idx.get_secondary_index<account_referrer_index>();
-    decltype(referrer_idx.referred_by)::mapped_type::size_type max_referred = 0;
-    for(auto iter : referrer_idx.referred_by)
-    {
-        max_referred = std::max(max_referred, iter.second.size());
-    }
-    pop_ddump((max_referred));
+    account_score_index& score_idx = account_idx.get_secondary_index<account_score_index>();
+
+    pop_score_globals globals;
+    globals.max_referred = referrer_idx.max_referred();
+    pop_ddump((globals.max_referred));
 
     // Listings Score
     // 1) get largest number of listings registered for any publisher.
     //    Index is sorted in ascending order, so use last element value.
     const auto& listing_idx = get_index_type<account_index>().indices().get<by_listings_count>();
-    const uint64_t max_listings = listing_idx.empty() ? 0 : (--listing_idx.end())->listings_count;
-    pop_ddump((max_listings));
+    globals.max_listings = listing_idx.empty() ? 0 : (--listing_idx.end())->listings_count;
+    pop_ddump((globals.max_listings));
 
     // Reputation Score
     // Get the largest number of reputation votes for any user.
     // Index is sorted in ascending order, so use last element value.
     const auto& accounts_reputations = get_index_type<account_index>().indices().get<by_reputation_votes>();
-    const uint64_t max_reputation_votes = accounts_reputations.empty() ? 0 : (--accounts_reputations.end())->reputation_votes_count;
-    pop_ddump((max_reputation_votes));
+    globals.max_reputation_votes = accounts_reputations.empty() ? 0 : (--accounts_reputations.end())->reputation_votes_count;
+    pop_ddump((globals.max_reputation_votes));
 
-    const omnibazaar::pop_weights pop_weights = get_global_properties().parameters.pop_weights;
-    const auto& all_accounts = get_index_type<account_index>().indices();
+    globals.weights = get_global_properties().parameters.pop_weights;
 
     // Reputation Score
-    // Calculate largest reputation weight of all users.
-    fc::uint128_t max_weight_sum = 0;
-    if(head_block_time() > HARDFORK_OM_713_TIME)
+    // Get largest reputation weight of all users, maintained by statistics secondary index.
+    auto& stats_idx = dynamic_cast<primary_index<simple_index<account_statistics_object>>&>(
+                get_mutable_index_type<simple_index<account_statistics_object>>());
+    account_reputation_weight_index& weight_idx = stats_idx.get_secondary_index<account_reputation_weight_index>();
+    globals.use_max_weight_sum = head_block_time() > HARDFORK_OM_713_TIME;
+    if(globals.use_max_weight_sum)
     {
-        for(const account_object& account : all_accounts)
-        {
-            const account_statistics_object& stats = account.statistics(*this);
-            if(!stats.reputation_votes.empty())
-            {
-                fc::uint128_t weight_sum = 0;
-                for(const auto& iter : stats.reputation_votes)
-                {
-                    const std::pair<uint16_t, asset> vote_info = iter.second;
-                    weight_sum += vote_info.second.amount.value;
-                }
-                max_weight_sum = std::max(max_weight_sum, weight_sum);
-            }
-        }
+        globals.max_weight_sum = weight_idx.max_weight_sum();
     }
 
-    for(const account_object& account : all_accounts)
+    const auto update_account_score = [&](const account_object& account)
     {
         uint16_t new_referral_score = account.referral_score;
         uint16_t new_listings_score = account.listings_score;
@@ -282,14 +270,14 @@ void database::update_account_scores()
 
         // Referral Score
         // 2) calculate score using number of users referred by this account and largest number of referred users.
-        if(max_referred > 0)
+        if(globals.max_referred > 0)
         {
             const auto referrer_iter = referrer_idx.referred_by.find(account.id);
             if(referrer_iter != referrer_idx.referred_by.end())
             {
                 new_referral_score = (uint64_t)referrer_iter->second.size()
                         * GRAPHENE_100_PERCENT
-                        / max_referred;
+                        / globals.max_referred;
                 pop_ddump((new_referral_score)(account.referral_score));
             }
             else
@@ -299,26 +287,20 @@ void database::update_account_scores()
         }
         else
         {
-            pop_elog("Invalid number of max referred users: ${r}.", ("r", max_referred));
+            pop_elog("Invalid number of max referred users: ${r}.", ("r", globals.max_referred));
         }
 
         // Reputation Score
         // Calculated based on reputation votes from transfer operations. Only non-default votes counts.
-        const account_statistics_object& stats = account.statistics(*this);
-        if(!stats.reputation_votes.empty())
+        if(account.reputation_votes_count > 0)
         {
-            fc::uint128_t weighted_votes_sum = 0;
-            fc::uint128_t weight_sum = 0;
-            for(const auto& iter : stats.reputation_votes)
-            {
-                const std::pair<uint16_t, asset> vote_info = iter.second;
-                weighted_votes_sum += fc::uint128_t(vote_info.first) * vote_info.second.amount.value;
-                weight_sum += vote_info.second.amount.value;
-            }
+            const account_statistics_object& stats = account.statistics(*this);
+            const fc::uint128_t weighted_votes_sum = stats.reputation_weighted_votes_sum;
+            const fc::uint128_t weight_sum = stats.reputation_weight_sum;
             pop_ddump((weighted_votes_sum)(weight_sum));
 
             // For actual score store value with transfers number weight applied.
-            if(head_block_time() <= HARDFORK_OM_713_TIME)
+            if(!globals.use_max_weight_sum)
             {
                 // Raw formula is:
                 //  weighted_votes_sum   account.reputation_votes_count
@@ -327,7 +309,7 @@ void database::update_account_scores()
                 // -----------------------------------------------------
                 //               OMNIBAZAAR_REPUTATION_MAX
                 new_reputation_score = ((weighted_votes_sum * account.reputation_votes_count * GRAPHENE_100_PERCENT)
-                        / (weight_sum * max_reputation_votes)
+                        / (weight_sum * globals.max_reputation_votes)
                         / OMNIBAZAAR_REPUTATION_MAX
                         ).to_integer();
             }
@@ -340,7 +322,7 @@ void database::update_account_scores()
                 // -----------------------------------------------------
                 //               OMNIBAZAAR_REPUTATION_MAX
                 new_reputation_score = ((weighted_votes_sum * account.reputation_votes_count * GRAPHENE_100_PERCENT)
-                        / (max_weight_sum * max_reputation_votes)
+                        / (globals.max_weight_sum * globals.max_reputation_votes)
                         / OMNIBAZAAR_REPUTATION_MAX
                         ).to_integer();
             }
@@ -354,25 +336,25 @@ void database::update_account_scores()
 
         // Listings Score
         // 2) calculate score as ratio of listings hosted by this user to max number of listings hosted by any publisher.
-        if(max_listings > 0)
+        if(globals.max_listings > 0)
         {
             new_listings_score = (fc::uint128_t(account.listings_count)
                                   * GRAPHENE_100_PERCENT
-                                  / max_listings
+                                  / globals.max_listings
                                   ).to_integer();
             pop_ddump((new_listings_score)(account.listings_score));
         }
         else
         {
-            pop_wlog("There are no listings registered in blockchain: ${c}.", ("c", max_listings));
+            pop_wlog("There are no listings registered in blockchain: ${c}.", ("c", globals.max_listings));
         }
 
-        const uint16_t new_pop_score = pop_weights.calc_pop_score(new_referral_score,
-                                                                  new_listings_score,
-                                                                  new_reputation_score,
-                                                                  account.trust_score,
-                                                                  account.reliability_score,
-                                                                  account.verified);
+        const uint16_t new_pop_score = globals.weights.calc_pop_score(new_referral_score,
+                                                                      new_listings_score,
+                                                                      new_reputation_score,
+                                                                      account.trust_score,
+                                                                      account.reliability_score,
+                                                                      account.verified);
 
         const bool changed = (new_referral_score != account.referral_score)
                 || (new_listings_score != account.listings_score)
@@ -388,7 +370,39 @@ void database::update_account_scores()
                a.pop_score = new_pop_score;
             });
         }
+    };
+
+    // Scores are a function of account's own inputs and the globals only,
+    // so if globals did not change since last maintenance, only accounts with changed inputs need recalculation.
+    // Witness scores updated above mark witness accounts as changed.
+    const bool recalculate_all = !score_idx.last_globals.valid() || (*score_idx.last_globals != globals);
+    pop_ddump((recalculate_all)(score_idx.changed_accounts.size())(weight_idx.changed_accounts.size()));
+    if(recalculate_all)
+    {
+        for(const account_object& account : get_index_type<account_index>().indices())
+        {
+            update_account_score(account);
+        }
     }
+    else
+    {
+        // Updating scores marks accounts as changed again, so work on a copy of changed accounts.
+        set<account_id_type> changed_accounts;
+        changed_accounts.swap(score_idx.changed_accounts);
+        changed_accounts.insert(weight_idx.changed_accounts.begin(), weight_idx.changed_accounts.end());
+        for(const account_id_type account_id : changed_accounts)
+        {
+            const account_object* account = find(account_id);
+            if(account != nullptr)
+            {
+                update_account_score(*account);
+            }
+        }
+    }
+
+    score_idx.changed_accounts.clear();
+    weight_idx.changed_accounts.clear();
+    score_idx.last_globals = globals;
 }
 
 void database::update_active_witnesses()
@@ -974,6 +988,112 @@ void process_hf_om_774(database& db)
     }
 }
 
+// There may be a difference between the account whose stake is voting and the one specifying opinions.
+// Usually they're the same, but if the stake account has specified a voting_account, that account is the one
+// specifying the opinions.
+const account_object& get_opinion_account( const database& db, const account_object& stake_account )
+{
+   return (stake_account.options.voting_account ==
+           GRAPHENE_PROXY_TO_SELF_ACCOUNT)? stake_account
+                             : db.get(stake_account.options.voting_account);
+}
+
+void add_account_votes( vector<uint64_t>& votes, const account_object& opinion_account, uint64_t voting_stake )
+{
+   for( vote_id_type id : opinion_account.options.votes )
+   {
+      uint32_t offset = id.instance();
+      // if they somehow managed to specify an illegal offset, ignore it.
+      if( offset < votes.size() )
+         votes[offset] += voting_stake;
+   }
+}
+
+uint64_t database::tally_base_voting_stake( vector<uint64_t>& votes )const
+{
+   std::fill( votes.begin(), votes.end(), 0 );
+
+   const auto& idx = get_index_type<account_index>().indices().get<by_name>();
+   vector<const account_object*> accounts;
+   accounts.reserve( idx.size() );
+   for( const account_object& a : idx )
+      accounts.push_back( &a );
+
+   // Tally stake in orders and liquid balance of accounts in [begin, end).
+   const auto tally = [this, &accounts]( size_t begin, size_t end, vector<uint64_t>& buffer )
+   {
+      uint64_t total_stake = 0;
+      for( size_t i = begin; i < end; ++i )
+      {
+         const account_object& stake_account = *accounts[i];
+         const auto& stats = stake_account.statistics(*this);
+         uint64_t voting_stake = stats.total_core_in_orders.value
+               + get_balance(stake_account.get_id(), asset_id_type()).amount.value;
+
+         add_account_votes( buffer, get_opinion_account(*this, stake_account), voting_stake );
+         total_stake += voting_stake;
+      }
+      return total_stake;
+   };
+
+   if( _worker_threads.empty() || accounts.empty() )
+      return tally( 0, accounts.size(), votes );
+
+   // This only reads chain state, so accounts are split across worker threads, each tallying into its own buffer,
+   // and buffers are then summed. Sums do not depend on the order of accounts, so the result is the same as of a
+   // serial tally.
+   const size_t chunk_size = (accounts.size() + _worker_threads.size() - 1) / _worker_threads.size();
+   const size_t chunks = (accounts.size() + chunk_size - 1) / chunk_size;
+   vector<vector<uint64_t>> buffers( chunks, vector<uint64_t>(votes.size(), 0) );
+   vector<uint64_t> totals( chunks, 0 );
+   vector<std::function<void()>> tasks;
+   for( size_t chunk = 0; chunk < chunks; ++chunk )
+   {
+      const size_t begin = chunk * chunk_size;
+      const size_t end = std::min( begin + chunk_size, accounts.size() );
+      tasks.emplace_back( [&tally, &buffers, &totals, chunk, begin, end]()
+      {
+         totals[chunk] = tally( begin, end, buffers[chunk] );
+      });
+   }
+   run_on_worker_threads( tasks );
+
+   uint64_t total_stake = 0;
+   for( size_t chunk = 0; chunk < chunks; ++chunk )
+   {
+      for( size_t offset = 0; offset < votes.size(); ++offset )
+         votes[offset] += buffers[chunk][offset];
+      total_stake += totals[chunk];
+   }
+   return total_stake;
+}
+
+uint64_t database::get_base_voting_stake( vector<uint64_t>& votes )const
+{
+   const auto& account_idx = dynamic_cast<const primary_index<account_index>&>(get_index_type<account_index>());
+   const uint64_t total_stake = account_idx.get_secondary_index<account_vote_weight_index>().get_votes( votes );
+   if( _check_vote_weights )
+   {
+      // Only report a mismatch, every node has to elect from the same maintained weights.
+      vector<uint64_t> tallied_votes( votes.size() );
+      const uint64_t tallied_total_stake = tally_base_voting_stake( tallied_votes );
+      if( tallied_votes != votes || tallied_total_stake != total_stake )
+         elog( "Maintained vote weights differ from full tally at block ${b}",
+               ("b",head_block_num())("maintained",total_stake)("tallied",tallied_total_stake) );
+   }
+   return total_stake;
+}
+
+bool database::check_vote_weights()const
+{
+   const auto& account_idx = dynamic_cast<const primary_index<account_index>&>(get_index_type<account_index>());
+   vector<uint64_t> votes( get_global_properties().next_available_vote_id );
+   const uint64_t total_stake = account_idx.get_secondary_index<account_vote_weight_index>().get_votes( votes );
+   vector<uint64_t> tallied_votes( votes.size() );
+   const uint64_t tallied_total_stake = tally_base_voting_stake( tallied_votes );
+   return tallied_votes == votes && tallied_total_stake == total_stake;
+}
+
 void database::perform_chain_maintenance(const signed_block& next_block, const global_property_object& global_props)
 {
    const auto& gpo = get_global_properties();
@@ -989,34 +1109,20 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
          : d(d), props(gpo)
       {
          d._vote_tally_buffer.resize(props.next_available_vote_id);
-         d._total_voting_stake = 0;
+         d._total_voting_stake = d.get_base_voting_stake(d._vote_tally_buffer);
       }
 
+      // Cashback is deposited while fees of other accounts are processed during the account maintenance pass,
+      // so it is tallied there, before fees of this account are processed.
       void operator()(const account_object& stake_account)
       {
-            // There may be a difference between the account whose stake is voting and the one specifying opinions.
-            // Usually they're the same, but if the stake account has specified a voting_account, that account is the one
-            // specifying the opinions.
-            const account_object& opinion_account =
-                  (stake_account.options.voting_account ==
-                   GRAPHENE_PROXY_TO_SELF_ACCOUNT)? stake_account
-                                     : d.get(stake_account.options.voting_account);
-
-            const auto& stats = stake_account.statistics(d);
-            uint64_t voting_stake = stats.total_core_in_orders.value
-                  + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value: 0)
-                  + d.get_balance(stake_account.get_id(), asset_id_type()).amount.value;
-
-            for( vote_id_type id : opinion_account.options.votes )
-            {
-               uint32_t offset = id.instance();
-               // if they somehow managed to specify an illegal offset, ignore it.
-               if( offset < d._vote_tally_buffer.size() )
-                  d._vote_tally_buffer[offset] += voting_stake;
-            }
+         if( !stake_account.cashback_vb.valid() )
+            return;
 
-            d._total_voting_stake += voting_stake;
-         }
+         uint64_t voting_stake = (*stake_account.cashback_vb)(d).balance.amount.value;
+         add_account_votes(d._vote_tally_buffer, get_opinion_account(d, stake_account), voting_stake);
+         d._total_voting_stake += voting_stake;
+      }
    } tally_helper(*this, gpo);
    struct process_fees_helper {
       database& d;
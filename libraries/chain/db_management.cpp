@@ -29,12 +29,145 @@
 
 #include <fc/io/fstream.hpp>
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
 
 namespace graphene { namespace chain {
 
+namespace {
+
+/**
+ * Reads blocks ahead of replay on worker threads, unpacks them and verifies their merkle roots.
+ * Blocks are handed out in order, and workers stay at most a fixed number of blocks ahead of replay,
+ * so memory use is bounded.
+ */
+class replay_prefetcher
+{
+   public:
+      struct prefetched_block
+      {
+         optional<signed_block> block;
+         bool                   merkle_valid = false;
+      };
+
+      replay_prefetcher( const block_database& blocks, uint32_t first, uint32_t last )
+      :_blocks( blocks ), _last( last ), _next_to_fetch( first ), _next_to_consume( first )
+      {
+         const uint32_t cores = std::thread::hardware_concurrency();
+         const uint32_t thread_count = cores > 1 ? cores - 1 : 1;
+         _window = thread_count * 256;
+         for( uint32_t i = 0; i < thread_count; ++i )
+            _threads.emplace_back( [this](){ worker(); } );
+      }
+
+      ~replay_prefetcher()
+      {
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _stopping = true;
+         }
+         _space_cv.notify_all();
+         for( auto& t : _threads )
+            t.join();
+      }
+
+      /// Wait for the next block in order and take it.
+      prefetched_block next()
+      {
+         const fc::time_point start = fc::time_point::now();
+         std::unique_lock<std::mutex> lock( _mutex );
+         _ready_cv.wait( lock, [this](){ return _ready.find( _next_to_consume ) != _ready.end(); } );
+         auto itr = _ready.find( _next_to_consume );
+         prefetched_block result = std::move( itr->second );
+         _ready.erase( itr );
+         ++_next_to_consume;
+         lock.unlock();
+         _space_cv.notify_all();
+         _wait_time += ( fc::time_point::now() - start ).count();
+         return result;
+      }
+
+      /// Log time spent in each stage since the previous call, as blocks per second of a single thread.
+      void log_stats( uint32_t blocks, int64_t apply_time )
+      {
+         const auto rate = []( uint32_t n, int64_t us ) { return us > 0 ? double(n) * 1000000 / us : 0.0; };
+         const int64_t read_time = _read_time.exchange( 0 );
+         const int64_t merkle_time = _merkle_time.exchange( 0 );
+         const int64_t wait_time = _wait_time;
+         _wait_time = 0;
+         ilog( "Replay stages: read ${r} blocks/s per thread, merkle ${m} blocks/s per thread with ${t} threads, "
+               "apply ${a} blocks/s, apply waited ${w} ms for blocks",
+               ("r", rate( blocks, read_time ))("m", rate( blocks, merkle_time ))("t", _threads.size())
+               ("a", rate( blocks, apply_time ))("w", wait_time / 1000) );
+      }
+
+   private:
+      void worker()
+      {
+         while( true )
+         {
+            uint32_t block_num;
+            {
+               std::unique_lock<std::mutex> lock( _mutex );
+               _space_cv.wait( lock, [this](){
+                  return _stopping || _next_to_fetch > _last || _next_to_fetch < _next_to_consume + _window;
+               } );
+               if( _stopping || _next_to_fetch > _last )
+                  return;
+               block_num = _next_to_fetch++;
+            }
+
+            prefetched_block result;
+            const fc::time_point start = fc::time_point::now();
+            result.block = _blocks.fetch_by_number( block_num );
+            const fc::time_point read_done = fc::time_point::now();
+            if( result.block.valid() )
+            {
+               try
+               {
+                  result.merkle_valid = ( result.block->transaction_merkle_root == result.block->calculate_merkle_root() );
+               }
+               catch( ... )
+               {
+                  // Replay will check it again and report the error.
+               }
+            }
+            _read_time += ( read_done - start ).count();
+            _merkle_time += ( fc::time_point::now() - read_done ).count();
+
+            {
+               std::lock_guard<std::mutex> lock( _mutex );
+               _ready.emplace( block_num, std::move( result ) );
+            }
+            _ready_cv.notify_one();
+         }
+      }
+
+      const block_database&               _blocks;
+      const uint32_t                      _last;
+      uint32_t                            _window = 0;
+      std::mutex                          _mutex;
+      std::condition_variable             _ready_cv;
+      std::condition_variable             _space_cv;
+      uint32_t                            _next_to_fetch;
+      uint32_t                            _next_to_consume;
+      std::map<uint32_t, prefetched_block> _ready;
+      bool                                _stopping = false;
+      std::vector<std::thread>            _threads;
+      std::atomic<int64_t>                _read_time{ 0 };
+      std::atomic<int64_t>                _merkle_time{ 0 };
+      int64_t                             _wait_time = 0;
+};
+
+}
+
 database::database()
 {
    initialize_indexes();
@@ -70,18 +203,32 @@ void database::reindex( fc::path data_dir )
    }
    else
       _undo_db.disable();
+
+   // Blocks are read, unpacked and checked on worker threads, and only applied here.
+   std::unique_ptr<replay_prefetcher> prefetcher( new replay_prefetcher( _block_id_to_block, head_block_num() + 1, last_block_num ) );
+   int64_t apply_time = 0;
+   uint32_t stats_blocks = 0;
    for( uint32_t i = head_block_num() + 1; i <= last_block_num; ++i )
    {
-      if( i % 10000 == 0 ) std::cerr << "   " << double(i*100)/last_block_num << "%   "<<i << " of " <<last_block_num<<"   \n";
+      if( i % 10000 == 0 )
+      {
+         std::cerr << "   " << double(i*100)/last_block_num << "%   "<<i << " of " <<last_block_num<<"   \n";
+         prefetcher->log_stats( stats_blocks, apply_time );
+         apply_time = 0;
+         stats_blocks = 0;
+      }
       if( i == flush_point )
       {
          ilog( "Writing database to disk at block ${i}", ("i",i) );
          flush();
          ilog( "Done" );
       }
-      fc::optional< signed_block > block = _block_id_to_block.fetch_by_number(i);
+      replay_prefetcher::prefetched_block prefetched = prefetcher->next();
+      fc::optional< signed_block >& block = prefetched.block;
       if( !block.valid() )
       {
+         // Stop readers before removing blocks.
+         prefetcher.reset();
          wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
          uint32_t dropped_count = 0;
          while( true )
@@ -99,13 +246,17 @@ void database::reindex( fc::path data_dir )
          wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
          break;
       }
+      // Merkle root was already verified by prefetcher.
+      const uint32_t merkle_skip = prefetched.merkle_valid ? skip_merkle_check : 0;
+      const fc::time_point apply_start = fc::time_point::now();
       if( i < undo_point )
          apply_block(*block, skip_witness_signature |
                              skip_transaction_signatures |
                              skip_transaction_dupe_check |
                              skip_tapos_check |
                              skip_witness_schedule_check |
-                             skip_authority_check);
+                             skip_authority_check |
+                             merkle_skip);
       else
       {
          _undo_db.enable();
@@ -114,9 +265,15 @@ void database::reindex( fc::path data_dir )
                             skip_transaction_dupe_check |
                             skip_tapos_check |
                             skip_witness_schedule_check |
-                            skip_authority_check);
+                            skip_authority_check |
+                            merkle_skip);
       }
+      apply_time += ( fc::time_point::now() - apply_start ).count();
+      ++stats_blocks;
    }
+   if( prefetcher )
+      prefetcher->log_stats( stats_blocks, apply_time );
+   prefetcher.reset();
    _undo_db.enable();
    auto end = fc::time_point::now();
    ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
@@ -175,6 +332,76 @@ void database::open(
    FC_CAPTURE_LOG_AND_RETHROW( (data_dir) )
 }
 
+void database::set_block_log_sync_interval(uint32_t blocks)
+{
+   _block_id_to_block.set_sync_interval(blocks);
+}
+
+void database::set_packed_undo_values(bool packed)
+{
+   _undo_db.set_packed_values(packed);
+}
+
+void database::set_worker_threads(uint32_t threads)
+{
+   _worker_threads.clear();
+   for( uint32_t i = 0; i < threads; ++i )
+      _worker_threads.emplace_back( new fc::thread( "worker" + std::to_string(i) ) );
+}
+
+void database::run_on_worker_threads(const vector<std::function<void()>>& tasks)const
+{
+   // Waiting on fc futures would let other tasks of this thread, like incoming blocks and transactions, use the
+   // database while it is in the middle of applying a block. Results are passed through std futures instead,
+   // which block this thread.
+   vector<std::future<void>> results;
+   for( size_t i = 0; i < tasks.size(); ++i )
+   {
+      auto done = std::make_shared<std::promise<void>>();
+      results.push_back( done->get_future() );
+      const std::function<void()>& task = tasks[i];
+      _worker_threads[i % _worker_threads.size()]->async( [&task, done]()
+      {
+         try
+         {
+            task();
+            done->set_value();
+         }
+         catch( ... )
+         {
+            done->set_exception( std::current_exception() );
+         }
+      }, "worker_task" );
+   }
+
+   // Wait for all tasks before rethrowing, they use data owned by the caller.
+   std::exception_ptr error;
+   for( auto& result : results )
+   {
+      try
+      {
+         result.get();
+      }
+      catch( ... )
+      {
+         if( !error )
+            error = std::current_exception();
+      }
+   }
+   if( error )
+      std::rethrow_exception( error );
+}
+
+void database::set_fork_db_max_bytes(uint64_t bytes)
+{
+   _fork_db.set_max_bytes(bytes);
+}
+
+void database::set_check_vote_weights(bool check)
+{
+   _check_vote_weights = check;
+}
+
 void database::close(bool rewind)
 {
    // TODO:  Save pending tx's on close()
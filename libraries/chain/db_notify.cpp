@@ -13,6 +13,9 @@
 #include <../omnibazaar/escrow_object.hpp>
 #include <../omnibazaar/listing_object.hpp>
 #include <../omnibazaar/exchange_object.hpp>
+#include <../omnibazaar/reputation_vote_object.hpp>
+#include <../omnibazaar/seller_buyer_object.hpp>
+#include <../omnibazaar/account_escrow_link_object.hpp>
 
 using namespace fc;
 using namespace graphene::chain;
@@ -480,6 +483,25 @@ static void get_relevant_accounts( const database& db, const object* obj, flat_s
               break;
            } case impl_reserved_names_object_type:
               break;
+             case impl_reputation_vote_object_type:{
+              const auto& aobj = dynamic_cast<const omnibazaar::reputation_vote_object*>(obj);
+              assert( aobj != nullptr );
+              accounts.insert( aobj->target );
+              accounts.insert( aobj->voter );
+              break;
+           } case impl_seller_buyer_object_type:{
+              const auto& aobj = dynamic_cast<const omnibazaar::seller_buyer_object*>(obj);
+              assert( aobj != nullptr );
+              accounts.insert( aobj->seller );
+              accounts.insert( aobj->buyer );
+              break;
+           } case impl_account_escrow_link_object_type:{
+              const auto& aobj = dynamic_cast<const omnibazaar::account_escrow_link_object*>(obj);
+              assert( aobj != nullptr );
+              accounts.insert( aobj->account );
+              accounts.insert( aobj->escrow );
+              break;
+           }
       }
    }
 } // end get_relevant_accounts( const object* obj, flat_set<account_id_type>& accounts )
@@ -516,7 +538,10 @@ void database::notify_changed_objects()
         for( const auto& item : head_undo.old_values )
         {
           changed_ids.push_back(item.first);
-          get_relevant_accounts(*this, item.second.get(), changed_accounts_impacted);
+          if( item.second.is_packed() )
+            get_relevant_accounts(*this, item.second.unpack(*this, item.first).get(), changed_accounts_impacted);
+          else
+            get_relevant_accounts(*this, item.second.get(), changed_accounts_impacted);
         }
 
         changed_objects(changed_ids, changed_accounts_impacted);
@@ -527,11 +552,17 @@ void database::notify_changed_objects()
       {
         vector<object_id_type> removed_ids; removed_ids.reserve( head_undo.removed.size() );
         vector<const object*> removed; removed.reserve( head_undo.removed.size() );
+        vector<unique_ptr<object>> unpacked;
         flat_set<account_id_type> removed_accounts_impacted;
         for( const auto& item : head_undo.removed )
         {
           removed_ids.emplace_back( item.first );
           auto obj = item.second.get();
+          if( item.second.is_packed() )
+          {
+            unpacked.push_back( item.second.unpack(*this, item.first) );
+            obj = unpacked.back().get();
+          }
           removed.emplace_back( obj );
           get_relevant_accounts(*this, obj, removed_accounts_impacted);
         }
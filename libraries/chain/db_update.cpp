@@ -193,11 +193,32 @@ void database::clear_expired_proposals()
 
 void database::clear_expired_escrows()
 {
-    // Go through the list of escrow objects and close those that are expired.
+    // Expired escrows are collected first, so that the batch and, if it fails, processing one by one below
+    // close them in the same order. Undoing the batch inserts escrows back into the expiration index,
+    // which can reorder escrows expiring at the same time.
     const auto& escrow_expiration_index = get_index_type<omnibazaar::escrow_index>().indices().get<omnibazaar::by_expiration>();
-    while( !escrow_expiration_index.empty() && escrow_expiration_index.begin()->expiration_time <= head_block_time() )
+    vector<escrow_id_type> expired;
+    for( auto itr = escrow_expiration_index.begin();
+         itr != escrow_expiration_index.end() && itr->expiration_time <= head_block_time(); ++itr )
+    {
+        expired.push_back( itr->id );
+    }
+    if( expired.empty() )
+        return;
+
+    // Release all expired escrows to Sellers at once. Normally all of them succeed,
+    // otherwise escrows are processed one by one below.
+    const bool released = apply_expirations_batch([&](){
+        for( const escrow_id_type id : expired )
+            apply_escrow_expiration(id(*this), true);
+    });
+    if( released )
+        return;
+
+    // Go through the list of escrow objects and close those that are expired.
+    for( const escrow_id_type id : expired )
     {
-        const omnibazaar::escrow_object& escrow = *escrow_expiration_index.begin();
+        const omnibazaar::escrow_object& escrow = id(*this);
         processed_transaction result;
         try
         {
@@ -239,30 +260,13 @@ void database::clear_expired_escrows()
 void database::clear_expired_listings()
 {
     const auto clear_listing = [this](const omnibazaar::listing_object& listing){
-        // Create a transaction that will delete the listing.
-
-        transaction_evaluation_state eval_state(this);
-
-        omnibazaar::listing_delete_operation listing_op;
-        listing_op.listing_id = listing.id;
-        listing_op.seller = listing.seller;
-
-        processed_transaction ptrx;
-        ptrx.expiration = listing.expiration_time;
-        ptrx.operations.push_back(listing_op);
-        ptrx.validate();
-        eval_state._trx = &ptrx;
-
         size_t old_applied_ops_size = _applied_ops.size();
 
         // Apply transaction to the database.
         try
         {
             auto session = _undo_db.start_undo_session(true);
-            for(const auto& op : ptrx.operations)
-            {
-                eval_state.operation_results.emplace_back(apply_operation(eval_state, op));
-            }
+            apply_listing_expiration(listing);
             session.merge();
         }
         catch ( const fc::exception& e )
@@ -283,32 +287,38 @@ void database::clear_expired_listings()
         }
     };
 
-    // Go through the list of listings and close those that are expired.
+    // Listings expire at their expiration time, or after maximum lifetime since last update once OM-774 is active.
+    // They are collected first for the same reason as escrows above.
+    vector<listing_id_type> expired;
     if( head_block_time() < HARDFORK_OM_774_TIME )
     {
         const auto& expiration_index = get_index_type<omnibazaar::listing_index>().indices().get<omnibazaar::by_expiration>();
-        while( !expiration_index.empty() && expiration_index.begin()->expiration_time <= head_block_time() )
-        {
-            clear_listing(*expiration_index.begin());
-        }
+        for( auto itr = expiration_index.begin(); itr != expiration_index.end() && itr->expiration_time <= head_block_time(); ++itr )
+            expired.push_back( itr->id );
     }
     else
     {
+        // Index is sorted so we can break out of the loop once we get to a listing which expiration time is in the future.
         const auto& updated_index = get_index_type<omnibazaar::listing_index>().indices().get<omnibazaar::by_update_time>();
-        while( !updated_index.empty() )
-        {
-            const omnibazaar::listing_object& listing = *updated_index.begin();
-            const auto expiration_time = listing.updated_at + get_global_properties().parameters.maximum_listing_lifetime;
-            if( expiration_time <= head_block_time() )
-            {
-                clear_listing(listing);
-            }
-            else
-            {
-                // Index is sorted so we can break out of the loop once we get to a listing which expiration time is in the future.
-                break;
-            }
-        }
+        const uint32_t lifetime = get_global_properties().parameters.maximum_listing_lifetime;
+        for( auto itr = updated_index.begin(); itr != updated_index.end() && itr->updated_at + lifetime <= head_block_time(); ++itr )
+            expired.push_back( itr->id );
+    }
+    if( expired.empty() )
+        return;
+
+    // Delete all expired listings at once. Normally all of them succeed,
+    // otherwise listings are processed one by one below.
+    const bool deleted = apply_expirations_batch([&](){
+        for( const listing_id_type id : expired )
+            apply_listing_expiration(id(*this));
+    });
+    if( deleted )
+        return;
+
+    for( const listing_id_type id : expired )
+    {
+        clear_listing(id(*this));
     }
 }
 
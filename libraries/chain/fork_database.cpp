@@ -26,6 +26,8 @@
 #include <graphene/chain/protocol/fee_schedule.hpp>
 #include <fc/smart_ref_impl.hpp>
 
+#include <unordered_set>
+
 namespace graphene { namespace chain {
 fork_database::fork_database()
 {
@@ -34,6 +36,7 @@ void fork_database::reset()
 {
    _head.reset();
    _index.clear();
+   _total_bytes = 0;
 }
 
 void fork_database::pop_block()
@@ -47,7 +50,8 @@ void fork_database::pop_block()
 void     fork_database::start_block(signed_block b)
 {
    auto item = std::make_shared<fork_item>(std::move(b));
-   _index.insert(item);
+   if( _index.insert(item).second )
+      _total_bytes += item->size;
    _head = item;
 }
 
@@ -88,7 +92,9 @@ void  fork_database::_push_block(const item_ptr& item)
       item->prev = *itr;
    }
 
-   _index.insert(item);
+   if( _index.insert(item).second )
+      _total_bytes += item->size;
+   const item_ptr previous_head = _head;
    if( !_head ) _head = item;
    else if( item->num > _head->num )
    {
@@ -97,13 +103,68 @@ void  fork_database::_push_block(const item_ptr& item)
 //      ilog( "min block in fork DB ${n}, max_size: ${m}", ("n",min_num)("m",_max_size) );
       auto& num_idx = _index.get<block_num>();
       while( num_idx.size() && (*num_idx.begin())->num < min_num )
+      {
+         _total_bytes -= (*num_idx.begin())->size;
          num_idx.erase( num_idx.begin() );
+      }
       
       _unlinked_index.get<block_num>().erase(_head->num - _max_size);
    }
+   _evict_forks( previous_head );
    //_push_next( item );
 }
 
+/**
+ *  While the blocks held take more than _max_bytes, drop the oldest blocks
+ *  that are not on the branch of the current head or of the head before the
+ *  last push, each together with all blocks built on it, so that no block
+ *  is left without its ancestors. The protected branches are bounded by
+ *  _max_size only: they are needed to pop blocks, to find the common
+ *  ancestor when switching forks and to switch back if that fails.
+ */
+void fork_database::_evict_forks( const item_ptr& previous_head )
+{
+   if( _max_bytes == 0 || _total_bytes <= _max_bytes || !_head )
+      return;
+
+   std::unordered_set<block_id_type, std::hash<fc::ripemd160>> protected_blocks;
+   for( item_ptr head_item = _head; head_item; head_item = head_item->prev.lock() )
+      protected_blocks.insert( head_item->id );
+   // the previous head branch joins the current one at their common ancestor
+   item_ptr item = previous_head;
+   while( item && protected_blocks.insert( item->id ).second )
+      item = item->prev.lock();
+
+   auto& num_idx = _index.get<block_num>();
+   auto itr = num_idx.begin();
+   while( itr != num_idx.end() && _total_bytes > _max_bytes )
+   {
+      if( protected_blocks.find( (*itr)->id ) != protected_blocks.end() )
+      {
+         ++itr;
+         continue;
+      }
+      // descendants have higher numbers, so blocks below num are unaffected
+      const uint32_t num = (*itr)->num;
+      _remove_with_descendants( (*itr)->id );
+      itr = num_idx.lower_bound( num );
+   }
+}
+
+void fork_database::_remove_with_descendants( const block_id_type& id )
+{
+   vector<block_id_type> removed( 1, id );
+   auto& prev_idx = _index.get<by_previous>();
+   for( size_t i = 0; i < removed.size(); ++i )
+   {
+      auto range = prev_idx.equal_range( removed[i] );
+      for( auto itr = range.first; itr != range.second; ++itr )
+         removed.push_back( (*itr)->id );
+   }
+   for( const block_id_type& removed_id : removed )
+      remove( removed_id );
+}
+
 /**
  *  Iterate through the unlinked cache and insert anything that
  *  links to the newly inserted item.  This will start a recursive
@@ -136,7 +197,10 @@ void fork_database::set_max_size( uint32_t s )
       while( itr != by_num_idx.end() )
       {
          if( (*itr)->num < std::max(int64_t(0),int64_t(_head->num) - _max_size) )
+         {
+            _total_bytes -= (*itr)->size;
             by_num_idx.erase(itr);
+         }
          else
             break;
          itr = by_num_idx.begin();
@@ -156,6 +220,12 @@ void fork_database::set_max_size( uint32_t s )
    }
 }
 
+void fork_database::set_max_bytes( uint64_t bytes )
+{
+   _max_bytes = bytes;
+   _evict_forks( _head );
+}
+
 bool fork_database::is_known_block(const block_id_type& id)const
 {
    auto& index = _index.get<block_id>();
@@ -246,7 +316,12 @@ void fork_database::set_head(shared_ptr<fork_item> h)
 
 void fork_database::remove(block_id_type id)
 {
-   _index.get<block_id>().erase(id);
+   auto& index = _index.get<block_id>();
+   auto itr = index.find(id);
+   if( itr == index.end() )
+      return;
+   _total_bytes -= (*itr)->size;
+   index.erase(itr);
 }
 
 } } // graphene::chain
@@ -25,9 +25,14 @@
 #include <graphene/chain/protocol/operations.hpp>
 #include <graphene/db/generic_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/ranked_index.hpp>
 #include <../omnibazaar/account_object_components.hpp>
 #include <string>
 #include <functional>
+#include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
 
 namespace graphene { namespace chain {
    class database;
@@ -87,11 +92,12 @@ namespace graphene { namespace chain {
           */
          share_type pending_vested_fees;
 
-         /// map<account, pair<vote value, asset>> used to store transaction votes and calculate Reputation Score for Proof of Participation.
-         map<account_id_type, std::pair<uint16_t, asset>> reputation_votes;
-
-         /// Set of accounts which received positive reputation vote from this account.
-         set<account_id_type> my_reputation_votes;
+         /// Running sums over reputation votes received by this account, so that Reputation Score can be calculated without iterating all votes.
+         /// Votes themselves are stored in @ref omnibazaar::reputation_vote_object.
+         /// Sum of vote values weighted by transfer amount.
+         fc::uint128_t reputation_weighted_votes_sum;
+         /// Sum of transfer amounts of all votes.
+         fc::uint128_t reputation_weight_sum;
 
          /// @brief Split up and pay out @ref pending_fees and @ref pending_vested_fees
          void process_fees(const account_object& a, database& d) const;
@@ -266,12 +272,6 @@ namespace graphene { namespace chain {
          // Fee % collected by this account as an escrow agent.
          uint16_t escrow_fee = GRAPHENE_1_PERCENT / 2;
 
-         // Users that bought something from this account. Used in Sale Bonus processing.
-         std::set<account_id_type> buyers;
-
-         // Users that this account added to acceptable Escrow agents.
-         std::set<account_id_type> escrows;
-
          // Options for implicitly approving certain types of escrow accounts.
          escrow_options implicit_escrow_options;
 
@@ -359,6 +359,176 @@ namespace graphene { namespace chain {
 
          /** maps the referrer to the set of accounts that they have referred */
          map< account_id_type, set<account_id_type> > referred_by;
+
+         /** largest number of accounts referred by any single referrer */
+         size_t max_referred()const;
+
+      private:
+         void add_referral( account_id_type referrer, account_id_type referred );
+         void remove_referral( account_id_type referrer, account_id_type referred );
+         void update_referred_count( size_t old_count, size_t new_count );
+
+         /** sizes of all sets in @ref referred_by, used to find the maximum without iterating all referrers */
+         std::multiset<size_t> referred_counts;
+
+         account_id_type before_referrer;
+   };
+
+   /**
+    *  @brief Values shared by all accounts when calculating Proof of Participation scores.
+    *
+    *  As long as these do not change between maintenance intervals,
+    *  only accounts whose own score inputs changed need to be recalculated.
+    */
+   struct pop_score_globals
+   {
+      size_t                  max_referred = 0;
+      uint64_t                max_listings = 0;
+      uint64_t                max_reputation_votes = 0;
+      fc::uint128_t           max_weight_sum = 0;
+      bool                    use_max_weight_sum = false;
+      omnibazaar::pop_weights weights;
+
+      bool operator==( const pop_score_globals& other )const
+      {
+         return max_referred == other.max_referred
+             && max_listings == other.max_listings
+             && max_reputation_votes == other.max_reputation_votes
+             && max_weight_sum == other.max_weight_sum
+             && use_max_weight_sum == other.use_max_weight_sum
+             && weights == other.weights;
+      }
+      bool operator!=( const pop_score_globals& other )const { return !(*this == other); }
+   };
+
+   /**
+    *  @brief This secondary index tracks accounts whose Proof of Participation score inputs changed
+    *  since the last maintenance interval.
+    *
+    *  Any modification of an account marks it as changed, and creating an account marks its referrer as changed.
+    *  All accounts are marked when the index is loaded, so the first maintenance after startup recalculates everything.
+    */
+   class account_score_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /** accounts that have to be recalculated during next maintenance */
+         set<account_id_type>           changed_accounts;
+
+         /** globals used by last maintenance, if it was performed since startup */
+         optional<pop_score_globals>    last_globals;
+
+      private:
+         account_id_type before_referrer;
+   };
+
+   /**
+    *  @brief This secondary index of account_statistics_object keeps track of reputation weight sums of all accounts
+    *  and of accounts whose reputation votes changed since the last maintenance interval.
+    */
+   class account_reputation_weight_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /** largest @ref account_statistics_object::reputation_weight_sum of all accounts */
+         fc::uint128_t max_weight_sum()const;
+
+         /** owners of statistics with changed reputation sums, to be recalculated during next maintenance */
+         set<account_id_type> changed_accounts;
+
+      private:
+         /** non-zero reputation weight sums of all accounts */
+         std::multiset<fc::uint128_t> weight_sums;
+
+         fc::uint128_t before_weighted_votes_sum;
+         fc::uint128_t before_weight_sum;
+   };
+
+   /**
+    *  @brief This secondary index of account_object maintains total voting stake of every vote id, so that maintenance
+    *  does not have to tally stake of all accounts.
+    *
+    *  Stake of an account is its core balance plus core in orders, and goes to votes of its voting account.
+    *  Cashback vesting balances are not included, they change while fees are processed during maintenance
+    *  and are tallied there. Balances and orders are fed by @ref account_balance_vote_weight_index and
+    *  @ref account_statistics_vote_weight_index. Totals wrap around like the tally buffer of maintenance does.
+    */
+   class account_vote_weight_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         /** add delta to stake of account */
+         void adjust_stake( account_id_type account, int64_t delta );
+
+         /** copy totals of vote ids below votes.size() into votes, and return total voting stake */
+         uint64_t get_votes( vector<uint64_t>& votes )const;
+
+      private:
+         struct stake_entry
+         {
+            account_id_type        voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+            flat_set<vote_id_type> votes;
+            /** stake of this account */
+            uint64_t               stake = 0;
+            /** stake of all accounts whose votes are given by this account, including itself */
+            uint64_t               voting_stake = 0;
+         };
+
+         stake_entry& get_entry( account_id_type account );
+         account_id_type get_opinion_account( account_id_type account, const stake_entry& entry )const;
+         void add_votes( const flat_set<vote_id_type>& votes, uint64_t stake );
+         void set_options( account_id_type account, account_id_type voting_account, const flat_set<vote_id_type>& votes );
+
+         /** indexed by account instance */
+         vector<stake_entry> entries;
+         /** indexed by vote id instance */
+         vector<uint64_t>    vote_totals;
+         uint64_t            total_stake = 0;
+   };
+
+   /**
+    *  @brief This secondary index of account_balance_object feeds core balances into @ref account_vote_weight_index.
+    */
+   class account_balance_vote_weight_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         account_vote_weight_index* vote_weights = nullptr;
+
+      private:
+         share_type before_balance;
+   };
+
+   /**
+    *  @brief This secondary index of account_statistics_object feeds core in orders into @ref account_vote_weight_index.
+    */
+   class account_statistics_vote_weight_index : public secondary_index
+   {
+      public:
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         account_vote_weight_index* vote_weights = nullptr;
+
+      private:
+         share_type before_core_in_orders;
    };
 
    /* structure that contains just account name and id */
@@ -376,41 +546,55 @@ namespace graphene { namespace chain {
 	   }
    };
 
-   /* class comparer for account_object_name */
-   class account_object_name_comparer
-   {
-   public:
-	   bool operator()(const account_object_name& a, const std::string& bName) const
-	   {
-		   return a.name.compare(bName) < 0;
-	   }
-
-	   bool operator()(const std::string& aName, const account_object& b) const
-	   {
-		   return aName.compare(b.name) < 0;
-	   }
-   };
-
-
    /**
     *  @brief This secondary index will allow lookup of Escrow agents.
+    *
+    *  Escrows are indexed by name for prefix search, by three-character substrings of names for substring search,
+    *  and by PoP and reputation scores for ranking. Updates and prefix or score lookups take logarithmic time
+    *  plus the size of the returned page (filter_by_name also walks the skipped matches). Substring search is not
+    *  logarithmic: it checks and sorts every escrow sharing the search term's least common trigram, and terms
+    *  shorter than three characters scan all escrows by name until the page is filled.
     */
    class account_escrow_index : public secondary_index
    {
       public:
          virtual void object_inserted( const object& obj ) override;
          virtual void object_removed( const object& obj ) override;
-         virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
 
-		 // get escrow names that start with search_term, paginated by start and limit
+         // get escrow names that start with search_term, paginated by start and limit
          std::vector<account_object_name> filter_by_name(uint32_t start, uint32_t limit, const std::string& search_term) const;
 
-		 // list of objects that contain username and id of the account
-         std::vector<account_object_name> current_escrows;
+         // get escrows which names start with (or contain, if substring is true) search_term,
+         // sorted by name starting with start_name
+         std::vector<account_object_name> search_by_name(const std::string& search_term, bool substring,
+                                                         const std::string& start_name, uint32_t limit) const;
 
-		private:
-			void insert_keeping_sorted(const account_object_name& account_object);
+         // get escrows sorted by PoP score and then reputation score in descending order,
+         // starting with start escrow if specified
+         std::vector<account_object_name> list_by_score(const optional<account_id_type>& start, uint32_t limit) const;
+
+         // number of current escrows
+         size_t size() const { return escrows.size(); }
+
+      private:
+         struct escrow_info
+         {
+            std::string name;
+            uint16_t pop_score;
+            uint16_t reputation_score;
+         };
+         typedef std::tuple<uint16_t, uint16_t, account_id_type> score_key;
+         static score_key get_score_key( account_id_type id, const escrow_info& info );
+         static std::set<std::string> get_trigrams( const std::string& name );
+
+         void add( const account_object& a );
+         void remove( account_id_type id );
+
+         std::map<account_id_type, escrow_info> escrows;
+         std::map<std::string, account_id_type> escrows_by_name;
+         std::set<score_key, std::greater<score_key>> escrows_by_score;
+         std::unordered_map<std::string, std::set<account_id_type>> escrows_by_trigram;
    };
 
    struct by_account_asset;
@@ -454,6 +638,7 @@ namespace graphene { namespace chain {
    struct by_reputation_votes;
    struct by_publishers;
    struct by_listings_count;
+   struct by_pop_score;
    struct by_publisher_ip;
    struct by_hardware_info;
 
@@ -472,9 +657,14 @@ namespace graphene { namespace chain {
             member<account_object, string, &account_object::name>
          >,
          // Add index that will sort accounts by the number of reputation votes that they have.
-         ordered_non_unique<
+         // Ranked indices allow to find account at specified position, or position of an account, in logarithmic time.
+         ranked_unique<
             tag<by_reputation_votes>,
-            member<account_object, uint64_t, &account_object::reputation_votes_count >
+            composite_key<
+               account_object,
+               member<account_object, uint64_t, &account_object::reputation_votes_count>,
+               member<object, object_id_type, &object::id>
+            >
          >,
          // Add index that will separate publishers from users.
          ordered_non_unique<
@@ -482,9 +672,22 @@ namespace graphene { namespace chain {
             member<account_object, bool, &account_object::is_a_publisher>
          >,
          // Index that will sort users by the number of listings they host as publishers.
-         ordered_non_unique<
+         ranked_unique<
             tag<by_listings_count>,
-            member<account_object, uint64_t, &account_object::listings_count>
+            composite_key<
+               account_object,
+               member<account_object, uint64_t, &account_object::listings_count>,
+               member<object, object_id_type, &object::id>
+            >
+         >,
+         // Index that will sort users by their Proof of Participation score.
+         ranked_unique<
+            tag<by_pop_score>,
+            composite_key<
+               account_object,
+               member<account_object, uint16_t, &account_object::pop_score>,
+               member<object, object_id_type, &object::id>
+            >
          >,
          // Index that will sort publishers by their IP/domain address and allow quick search by address.
          // Publishers should not be allowed to have same IP/domain,
@@ -538,8 +741,6 @@ FC_REFLECT_DERIVED( graphene::chain::account_object,
                     (publisher_ip)
                     (is_an_escrow)
                     (escrow_fee)
-                    (buyers)
-                    (escrows)
                     (implicit_escrow_options)
                     (referral_score)
                     (listings_score)
@@ -570,8 +771,8 @@ FC_REFLECT_DERIVED( graphene::chain::account_statistics_object,
                     (total_core_in_orders)
                     (lifetime_fees_paid)
                     (pending_fees)(pending_vested_fees)
-                    (reputation_votes)
-                    (my_reputation_votes)
+                    (reputation_weighted_votes_sum)
+                    (reputation_weight_sum)
                   )
 
 
@@ -22,12 +22,26 @@
  * THE SOFTWARE.
  */
 #pragma once
-#include <fstream>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <graphene/chain/protocol/block.hpp>
 
 namespace graphene { namespace chain {
    class index_entry;
 
+   /**
+    *  @brief Append-only block log with O(1) access by block number.
+    *
+    *  Blocks are appended to the "blocks" file and their positions are stored in the "index" file,
+    *  one fixed size entry per block number. Both files are memory mapped and grown in chunks,
+    *  slack space is truncated on close so that files on disk keep their original format.
+    *
+    *  Writes are serialized by a mutex, while any number of threads may read concurrently without locks.
+    *  Readers work on a snapshot of current mappings which stays valid after files are remapped, index entries
+    *  overwritten in place are read under a sequence lock, and every fetched block is checked against its ID
+    *  stored in the index.
+    */
    class block_database 
    {
       public:
@@ -36,6 +50,12 @@ namespace graphene { namespace chain {
          void flush();
          void close();
 
+         /**
+          * Set number of stored blocks after which files are synced to disk.
+          * 0 means that files are only synced on @ref flush and @ref close.
+          */
+         void set_sync_interval( uint32_t blocks );
+
          void store( const block_id_type& id, const signed_block& b );
          void remove( const block_id_type& id );
 
@@ -46,9 +66,24 @@ namespace graphene { namespace chain {
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
       private:
+         class mapped_file;
+         struct mapped_state;
+
          optional<index_entry> last_index_entry()const;
+         optional<index_entry> read_index_entry( const mapped_state& state, uint32_t block_num )const;
+         optional<signed_block> read_block( const mapped_state& state, const index_entry& e )const;
+         index_entry read_index_entry_at( const mapped_state& state, uint64_t index_pos )const;
+         void write_index_entry( const mapped_state& state, uint64_t index_pos, const index_entry& e );
+         std::shared_ptr<const mapped_state> get_state()const;
+         void set_state( const std::shared_ptr<const mapped_state>& state );
+
          fc::path _index_filename;
-         mutable std::fstream _blocks;
-         mutable std::fstream _block_num_to_pos;
+         fc::path _blocks_filename;
+         std::shared_ptr<const mapped_state> _state;
+         std::mutex _write_mutex;
+         /// Odd while an index entry is being written
+         std::atomic<uint64_t> _index_sequence{ 0 };
+         uint32_t _sync_interval = 0;
+         uint32_t _unsynced_blocks = 0;
    };
 } }
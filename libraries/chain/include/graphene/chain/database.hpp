@@ -36,6 +36,7 @@
 #include <graphene/db/object.hpp>
 #include <graphene/db/simple_index.hpp>
 #include <fc/signals.hpp>
+#include <fc/thread/thread.hpp>
 
 #include <graphene/chain/protocol/protocol.hpp>
 
@@ -114,6 +115,51 @@ namespace graphene { namespace chain {
          void wipe(const fc::path& data_dir, bool include_blocks);
          void close(bool rewind = true);
 
+         /**
+          * @brief Set number of stored blocks after which block log is synced to disk.
+          * @param blocks number of blocks, 0 to sync only when database is closed.
+          */
+         void set_block_log_sync_interval(uint32_t blocks);
+
+         /**
+          * @brief Set whether undo history keeps old object values packed instead of full copies.
+          * @param packed true to save memory at the cost of packing and unpacking objects.
+          */
+         void set_packed_undo_values(bool packed);
+
+         /**
+          * @brief Set number of worker threads which recover transaction signature keys before transactions are applied
+          *        and tally votes during maintenance.
+          * @param threads number of worker threads, 0 to do this work serially on the calling thread.
+          */
+         void set_worker_threads(uint32_t threads);
+
+         /**
+          * @brief Set limit on total size of blocks kept in fork database.
+          * @param bytes max packed size of blocks, 0 for no limit. Blocks of the current head branch are not counted against the limit.
+          */
+         void set_fork_db_max_bytes(uint64_t bytes);
+
+         /**
+          * @brief Set whether maintenance compares maintained vote weights with a full tally of all accounts.
+          * @param check true to re-tally all accounts every maintenance and log an error if results differ.
+          *        Maintenance always uses the maintained vote weights, so the check can't change election results.
+          */
+         void set_check_vote_weights(bool check);
+
+         /**
+          * @brief Tally stake of all accounts and compare it with vote weights maintained as balances, orders and votes change.
+          * @return true if maintained vote weights are the same as the full tally.
+          */
+         bool check_vote_weights()const;
+
+         /**
+          * @brief Fill votes with stake in orders and liquid balance voting for each vote id, tallied over all accounts,
+          *        in parallel if there are worker threads.
+          * @return total of that stake
+          */
+         uint64_t tally_base_voting_stake( vector<uint64_t>& votes )const;
+
          //////////////////// db_block.cpp ////////////////////
 
          /**
@@ -453,6 +499,29 @@ namespace graphene { namespace chain {
            */
          set<account_id_type> get_implicit_escrows(const account_id_type target_account_id) const;
 
+         /**
+           * @brief Check if escrow agent is implicitly approved by account, without building the whole list.
+           * @param account_id account which approves escrows.
+           * @param escrow_id escrow agent account.
+           * @return true if escrow_id would be returned by get_implicit_escrows(account_id).
+           */
+         bool is_implicit_escrow(const account_id_type account_id, const account_id_type escrow_id) const;
+
+         /**
+           * @brief Check if escrow agent is acceptable for account, either explicitly or implicitly.
+           * @param account_id account which approves escrows.
+           * @param escrow_id escrow agent account.
+           * @return true if escrow agent is acceptable, false otherwise.
+           */
+         bool is_acceptable_escrow(const account_id_type account_id, const account_id_type escrow_id) const;
+
+         /**
+           * @brief Replace list of escrow agents explicitly approved by account.
+           * @param account_id account which approves escrows.
+           * @param escrows new list of approved escrow agents.
+           */
+         void update_account_escrows(const account_id_type account_id, const set<account_id_type>& escrows);
+
    protected:
          //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
          void pop_undo() { object_database::pop_undo(); }
@@ -480,6 +549,11 @@ namespace graphene { namespace chain {
          ///Steps involved in applying a new block
          ///@{
 
+         /// Recover signature keys of transactions of a block in parallel on worker threads.
+         void precompute_signature_keys( const vector<const signed_transaction*>& trxs )const;
+         /// Run tasks on worker threads and block until all of them finish, without yielding to other tasks of this thread.
+         void run_on_worker_threads( const vector<std::function<void()>>& tasks )const;
+
          const witness_object& validate_block_header( uint32_t skip, const signed_block& next_block )const;
          const witness_object& _validate_block_header( const signed_block& next_block )const;
          void create_block_summary(const signed_block& next_block);
@@ -493,6 +567,14 @@ namespace graphene { namespace chain {
          void clear_expired_orders();
          void clear_expired_escrows();
          void clear_expired_listings();
+         /// Apply operations closing expired escrow or listing, without separate undo session.
+         processed_transaction apply_escrow_expiration( const omnibazaar::escrow_object& escrow, const bool release );
+         processed_transaction apply_listing_expiration( const omnibazaar::listing_object& listing );
+         /**
+          * Call @p apply_all in a single undo session. If any expiration fails, the whole batch is undone
+          * and false is returned, so that caller can process expirations one by one.
+          */
+         bool apply_expirations_batch( const std::function<void()>& apply_all );
          void update_expired_feeds();
          void update_maintenance_flag( bool new_maintenance_flag );
          void update_withdraw_permissions();
@@ -514,6 +596,7 @@ namespace graphene { namespace chain {
          void process_bids( const asset_bitasset_data_object& bad );
          // Update Proof of Participation scores for all accounts;
          void update_account_scores();
+         uint64_t get_base_voting_stake( vector<uint64_t>& votes )const;
 
          template<class... Types>
          void perform_account_maintenance(std::tuple<Types...> helpers);
@@ -553,6 +636,10 @@ namespace graphene { namespace chain {
          flat_map<uint32_t,block_id_type>  _checkpoints;
 
          node_property_object              _node_property_object;
+
+         vector<unique_ptr<fc::thread>>    _worker_threads;
+
+         bool                              _check_vote_weights = false;
    };
 
    namespace detail
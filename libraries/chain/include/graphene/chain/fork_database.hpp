@@ -24,6 +24,8 @@
 #pragma once
 #include <graphene/chain/protocol/block.hpp>
 
+#include <fc/io/raw.hpp>
+
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -38,13 +40,14 @@ namespace graphene { namespace chain {
    struct fork_item
    {
       fork_item( signed_block d )
-      :num(d.block_num()),id(d.id()),data( std::move(d) ){}
+      :num(d.block_num()),id(d.id()),size(fc::raw::pack_size(d)),data( std::move(d) ){}
 
       block_id_type previous_id()const { return data.previous; }
 
       weak_ptr< fork_item > prev;
       uint32_t              num;    // initialized in ctor
       block_id_type         id;
+      size_t                size;   // packed size of the block, used to bound memory held by the fork DB
       signed_block          data;
    };
    typedef shared_ptr<fork_item> item_ptr;
@@ -57,6 +60,14 @@ namespace graphene { namespace chain {
     *  have a maximum depth of 1024 blocks after which
     *  the database will start lopping off forks.
     *
+    *  Total size of the blocks held can be bounded too, in
+    *  which case forks that are not on the branch of the
+    *  current or previous head are dropped, oldest first and
+    *  together with all blocks built on them, to stay within
+    *  the limit. Blocks on those branches are only bounded
+    *  by depth since they are needed to pop blocks and to
+    *  switch forks.
+    *
     *  Every time a block is pushed into the fork DB the
     *  block with the highest block_num will be returned.
     */
@@ -105,12 +116,23 @@ namespace graphene { namespace chain {
 
          void set_max_size( uint32_t s );
 
+         /**
+          *  @brief Set limit on total packed size of blocks held, 0 for no limit.
+          */
+         void set_max_bytes( uint64_t bytes );
+         /// @return total packed size of blocks held
+         uint64_t total_bytes()const { return _total_bytes; }
+
       private:
          /** @return a pointer to the newly pushed item */
          void _push_block(const item_ptr& b );
          void _push_next(const item_ptr& newly_inserted);
+         void _evict_forks( const item_ptr& previous_head );
+         void _remove_with_descendants( const block_id_type& id );
 
          uint32_t                 _max_size = 1024;
+         uint64_t                 _max_bytes = 0;
+         uint64_t                 _total_bytes = 0;
 
          fork_multi_index_type    _unlinked_index;
          fork_multi_index_type    _index;
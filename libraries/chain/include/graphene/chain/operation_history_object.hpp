@@ -64,6 +64,14 @@ namespace graphene { namespace chain {
          uint16_t          virtual_op = 0;
    };
 
+   /** Role of account in a marketplace sale. */
+   enum marketplace_role_type
+   {
+      marketplace_role_none   = 0,
+      marketplace_role_buyer  = 1,
+      marketplace_role_seller = 2
+   };
+
    /**
     *  @brief a node in a linked list of operation_history_objects
     *  @ingroup implementation
@@ -94,6 +102,29 @@ namespace graphene { namespace chain {
          operation_history_id_type            operation_id;
          uint32_t                             sequence = 0; /// the operation position within the given account
          account_transaction_history_id_type  next;
+         int32_t                              operation_type = -1; /// operation::which() of the operation
+         uint8_t                              marketplace_role = marketplace_role_none; /// role of account if operation is a sale
+
+         /** Fill operation_type and marketplace_role from the operation this entry refers to. */
+         void set_operation( const operation& op )
+         {
+            operation_type = op.which();
+            marketplace_role = marketplace_role_none;
+            if( op.which() == operation::tag<transfer_operation>::value )
+            {
+               const auto& transfer = op.get<transfer_operation>();
+               if( transfer.listing.valid() )
+                  marketplace_role = transfer.from == account ? marketplace_role_buyer
+                                   : transfer.to == account ? marketplace_role_seller : marketplace_role_none;
+            }
+            else if( op.which() == operation::tag<omnibazaar::escrow_create_operation>::value )
+            {
+               const auto& escrow = op.get<omnibazaar::escrow_create_operation>();
+               if( escrow.listing.valid() )
+                  marketplace_role = escrow.buyer == account ? marketplace_role_buyer
+                                   : escrow.seller == account ? marketplace_role_seller : marketplace_role_none;
+            }
+         }
 
          //std::pair<account_id_type,operation_history_id_type>  account_op()const  { return std::tie( account, operation_id ); }
          //std::pair<account_id_type,uint32_t>                   account_seq()const { return std::tie( account, sequence );     }
@@ -113,6 +144,8 @@ namespace graphene { namespace chain {
    struct by_seq;
    struct by_op;
    struct by_opid;
+   struct by_type_seq;
+   struct by_role_seq;
 
    typedef multi_index_container<
       account_transaction_history_object,
@@ -132,6 +165,20 @@ namespace graphene { namespace chain {
          >,
          ordered_non_unique< tag<by_opid>,
             member< account_transaction_history_object, operation_history_id_type, &account_transaction_history_object::operation_id>
+         >,
+         ordered_unique< tag<by_type_seq>,
+            composite_key< account_transaction_history_object,
+               member< account_transaction_history_object, account_id_type, &account_transaction_history_object::account>,
+               member< account_transaction_history_object, int32_t, &account_transaction_history_object::operation_type>,
+               member< account_transaction_history_object, uint32_t, &account_transaction_history_object::sequence>
+            >
+         >,
+         ordered_unique< tag<by_role_seq>,
+            composite_key< account_transaction_history_object,
+               member< account_transaction_history_object, account_id_type, &account_transaction_history_object::account>,
+               member< account_transaction_history_object, uint8_t, &account_transaction_history_object::marketplace_role>,
+               member< account_transaction_history_object, uint32_t, &account_transaction_history_object::sequence>
+            >
          >
       >
    > account_transaction_history_multi_index_type;
@@ -145,4 +192,4 @@ FC_REFLECT_DERIVED( graphene::chain::operation_history_object, (graphene::chain:
                     (op)(result)(block_num)(trx_in_block)(op_in_trx)(virtual_op) )
 
 FC_REFLECT_DERIVED( graphene::chain::account_transaction_history_object, (graphene::chain::object),
-                    (account)(operation_id)(sequence)(next) )
+                    (account)(operation_id)(sequence)(next)(operation_type)(marketplace_role) )
@@ -167,12 +167,49 @@ namespace graphene { namespace chain {
 
       flat_set<public_key_type> get_signature_keys( const chain_id_type& chain_id )const;
 
+      /**
+       * Recover public keys from signatures and keep them with the transaction, so that following
+       * get_signature_keys() calls don't repeat the expensive recovery while the transaction, its
+       * signatures and the chain ID are unchanged. Invalid signatures are left to be reported by
+       * get_signature_keys(). Different transactions may be processed concurrently from different threads.
+       */
+      void precompute_signature_keys( const chain_id_type& chain_id )const;
+
       vector<signature_type> signatures;
 
       /// Removes all operations and signatures
-      void clear() { operations.clear(); signatures.clear(); }
+      void clear() { operations.clear(); signatures.clear(); _signature_keys.reset(); }
+
+   private:
+      /// Keys recovered by precompute_signature_keys() with the digest and signatures they were recovered from
+      struct recovered_signature_keys
+      {
+         digest_type               digest;
+         vector<signature_type>    signatures;
+         flat_set<public_key_type> keys;
+      };
+      /// Used only while digest and signatures match, as the transaction may be modified or copied after recovery
+      mutable optional<recovered_signature_keys> _signature_keys;
+   };
+
+   /**
+    *  @brief statistics of the cache of public keys recovered from transaction signatures
+    *
+    *  Keys are cached by signature digest and signature, so that a transaction validated when pushed,
+    *  when included in a generated block and when its block is pushed recovers its keys only once.
+    */
+   struct signature_cache_stats
+   {
+      uint64_t capacity = 0;
+      uint64_t size = 0;
+      uint64_t hits = 0;
+      uint64_t misses = 0;
    };
 
+   /// Set maximum number of keys kept in the signature cache, 0 to disable the cache.
+   void set_signature_cache_capacity( size_t capacity );
+   signature_cache_stats get_signature_cache_stats();
+
    void verify_authority( const vector<operation>& ops, const flat_set<public_key_type>& sigs,
                           const std::function<const authority*(account_id_type)>& get_active,
                           const std::function<const authority*(account_id_type)>& get_owner,
@@ -210,4 +247,5 @@ namespace graphene { namespace chain {
 
 FC_REFLECT( graphene::chain::transaction, (ref_block_num)(ref_block_prefix)(expiration)(operations)(extensions) )
 FC_REFLECT_DERIVED( graphene::chain::signed_transaction, (graphene::chain::transaction), (signatures) )
+FC_REFLECT( graphene::chain::signature_cache_stats, (capacity)(size)(hits)(misses) )
 FC_REFLECT_DERIVED( graphene::chain::processed_transaction, (graphene::chain::signed_transaction), (operation_results) )
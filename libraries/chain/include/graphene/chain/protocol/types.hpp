@@ -51,6 +51,9 @@ namespace omnibazaar {
     class listing_object;
     class exchange_object;
     class reserved_names_object;
+    class reputation_vote_object;
+    class seller_buyer_object;
+    class account_escrow_link_object;
 }
 
 namespace graphene { namespace chain {
@@ -167,7 +170,10 @@ namespace graphene { namespace chain {
       impl_buyback_object_type,
       impl_fba_accumulator_object_type,
       impl_collateral_bid_object_type,
-      impl_reserved_names_object_type
+      impl_reserved_names_object_type,
+      impl_reputation_vote_object_type,
+      impl_seller_buyer_object_type,
+      impl_account_escrow_link_object_type
    };
 
    //typedef fc::unsigned_int            object_id_type;
@@ -245,6 +251,9 @@ namespace graphene { namespace chain {
    typedef object_id< implementation_ids, impl_fba_accumulator_object_type, fba_accumulator_object >                    fba_accumulator_id_type;
    typedef object_id< implementation_ids, impl_collateral_bid_object_type, collateral_bid_object >                      collateral_bid_id_type;
    typedef object_id< implementation_ids, impl_reserved_names_object_type, omnibazaar::reserved_names_object>           reserved_names_id_type;
+   typedef object_id< implementation_ids, impl_reputation_vote_object_type, omnibazaar::reputation_vote_object>         reputation_vote_id_type;
+   typedef object_id< implementation_ids, impl_seller_buyer_object_type, omnibazaar::seller_buyer_object>               seller_buyer_id_type;
+   typedef object_id< implementation_ids, impl_account_escrow_link_object_type, omnibazaar::account_escrow_link_object> account_escrow_link_id_type;
 
    typedef fc::array<char, GRAPHENE_MAX_ASSET_SYMBOL_LENGTH>    symbol_type;
    typedef fc::ripemd160                                        block_id_type;
@@ -382,6 +391,9 @@ FC_REFLECT_ENUM( graphene::chain::impl_object_type,
                  (impl_fba_accumulator_object_type)
                  (impl_collateral_bid_object_type)
                  (impl_reserved_names_object_type)
+                 (impl_reputation_vote_object_type)
+                 (impl_seller_buyer_object_type)
+                 (impl_account_escrow_link_object_type)
                )
 
 FC_REFLECT_TYPENAME( graphene::chain::share_type )
@@ -417,6 +429,9 @@ FC_REFLECT_TYPENAME( graphene::chain::collateral_bid_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::escrow_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::exchange_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::reserved_names_id_type )
+FC_REFLECT_TYPENAME( graphene::chain::reputation_vote_id_type )
+FC_REFLECT_TYPENAME( graphene::chain::seller_buyer_id_type )
+FC_REFLECT_TYPENAME( graphene::chain::account_escrow_link_id_type )
 
 FC_REFLECT( graphene::chain::void_t, )
 
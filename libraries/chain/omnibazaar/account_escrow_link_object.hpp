@@ -0,0 +1,42 @@
+#pragma once
+
+#include <graphene/db/object.hpp>
+#include <graphene/chain/protocol/types.hpp>
+#include <graphene/db/generic_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+namespace omnibazaar {
+
+    // Class linking account with escrow agent that this account added to acceptable Escrow agents.
+    class account_escrow_link_object : public graphene::db::abstract_object<account_escrow_link_object>
+    {
+    public:
+        static const uint8_t space_id = graphene::chain::implementation_ids;
+        static const uint8_t type_id = graphene::chain::impl_account_escrow_link_object_type;
+
+        // Account that approved escrow agent.
+        graphene::chain::account_id_type account;
+        // Approved escrow agent account.
+        graphene::chain::account_id_type escrow;
+    };
+
+    struct by_account_escrow{};
+    typedef boost::multi_index_container<
+       account_escrow_link_object,
+       graphene::chain::indexed_by<
+          graphene::chain::ordered_unique< graphene::chain::tag< graphene::chain::by_id >, graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id > >,
+          graphene::chain::ordered_unique< graphene::chain::tag< by_account_escrow >,
+             graphene::chain::composite_key< account_escrow_link_object,
+                graphene::chain::member< account_escrow_link_object, graphene::chain::account_id_type, &account_escrow_link_object::account >,
+                graphene::chain::member< account_escrow_link_object, graphene::chain::account_id_type, &account_escrow_link_object::escrow >
+             >
+          >
+       >
+    > account_escrow_link_multi_index_container;
+    typedef graphene::chain::generic_index<account_escrow_link_object, account_escrow_link_multi_index_container> account_escrow_link_index;
+
+}
+
+FC_REFLECT_DERIVED(omnibazaar::account_escrow_link_object, (graphene::chain::object),
+                   (account)
+                   (escrow))
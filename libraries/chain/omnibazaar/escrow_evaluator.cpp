@@ -6,14 +6,6 @@
 
 namespace omnibazaar {
 
-    template<typename T>
-    std::set<T> operator +(const std::set<T>& a, const std::set<T>& b)
-    {
-        std::set<T> result;
-        std::merge(a.begin(), a.end(), b.begin(), b.end(), std::inserter(result, result.begin()));
-        return result;
-    }
-
     graphene::chain::void_result escrow_create_evaluator::do_evaluate( const escrow_create_operation& op )
     {
         try
@@ -24,11 +16,8 @@ namespace omnibazaar {
             const auto& global_parameters = d.get_global_properties().parameters;
 
             // Check mutually acceptable escrow agents.
-            const auto buyer_escrows = op.buyer(d).escrows + d.get_implicit_escrows(op.buyer);
-            const auto seller_escrows = op.seller(d).escrows + d.get_implicit_escrows(op.seller);
-            escrow_ddump((buyer_escrows)(seller_escrows));
-            FC_ASSERT( buyer_escrows.find(op.escrow) != buyer_escrows.end(), "Escrow agent is not buyer's acceptable list of agents." );
-            FC_ASSERT( seller_escrows.find(op.escrow) != seller_escrows.end(), "Escrow agent is not seller's acceptable list of agents." );
+            FC_ASSERT( d.is_acceptable_escrow(op.buyer, op.escrow), "Escrow agent is not buyer's acceptable list of agents." );
+            FC_ASSERT( d.is_acceptable_escrow(op.seller, op.escrow), "Escrow agent is not seller's acceptable list of agents." );
 
             // Check funds.
             FC_ASSERT( d.get_balance(op.buyer, op.amount.asset_id).amount >= op.amount.amount,
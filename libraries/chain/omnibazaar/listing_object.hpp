@@ -5,6 +5,8 @@
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/db/generic_index.hpp>
 
+#include <boost/multi_index/composite_key.hpp>
+
 namespace omnibazaar {
 
     // Class to track existing marketplace listings.
@@ -40,11 +42,28 @@ namespace omnibazaar {
         fc::time_point_sec updated_at;
     };
 
+    // Key extractors for listing price, to allow ordering by amount within each asset.
+    struct listing_price_asset
+    {
+        typedef graphene::chain::asset_id_type result_type;
+        result_type operator()(const listing_object& o)const { return o.price.asset_id; }
+    };
+    struct listing_price_amount
+    {
+        typedef graphene::chain::share_type result_type;
+        result_type operator()(const listing_object& o)const { return o.price.amount; }
+    };
+
+    // All non-unique keys are followed by listing ID, so that results can be paged through by (key, ID) cursor.
     struct by_hash;
     struct by_seller;
     struct by_publisher;
     struct by_expiration;
     struct by_update_time;
+    struct by_seller_update_time;
+    struct by_publisher_update_time;
+    struct by_price;
+    struct by_priority_fee;
     typedef boost::multi_index_container<
         listing_object,
         graphene::chain::indexed_by<
@@ -56,21 +75,64 @@ namespace omnibazaar {
                 graphene::chain::tag< by_hash >,
                 graphene::chain::member< listing_object, fc::sha256, &listing_object::listing_hash >
             >,
-            graphene::chain::ordered_non_unique<
+            graphene::chain::ordered_unique<
                 graphene::chain::tag< by_seller >,
-                graphene::chain::member< listing_object, graphene::chain::account_id_type, &listing_object::seller >
+                graphene::chain::composite_key< listing_object,
+                    graphene::chain::member< listing_object, graphene::chain::account_id_type, &listing_object::seller >,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
             >,
-            graphene::chain::ordered_non_unique<
+            graphene::chain::ordered_unique<
                 graphene::chain::tag< by_publisher >,
-                graphene::chain::member< listing_object, graphene::chain::account_id_type, &listing_object::publisher >
+                graphene::chain::composite_key< listing_object,
+                    graphene::chain::member< listing_object, graphene::chain::account_id_type, &listing_object::publisher >,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
             >,
-            graphene::chain::ordered_non_unique<
+            graphene::chain::ordered_unique<
                 graphene::chain::tag< by_expiration >,
-                graphene::chain::member< listing_object, fc::time_point_sec, &listing_object::expiration_time >
+                graphene::chain::composite_key< listing_object,
+                    graphene::chain::member< listing_object, fc::time_point_sec, &listing_object::expiration_time >,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
             >,
-            graphene::chain::ordered_non_unique<
+            graphene::chain::ordered_unique<
                 graphene::chain::tag< by_update_time >,
-                graphene::chain::member< listing_object, fc::time_point_sec, &listing_object::updated_at >
+                graphene::chain::composite_key< listing_object,
+                    graphene::chain::member< listing_object, fc::time_point_sec, &listing_object::updated_at >,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
+            >,
+            graphene::chain::ordered_unique<
+                graphene::chain::tag< by_seller_update_time >,
+                graphene::chain::composite_key< listing_object,
+                    graphene::chain::member< listing_object, graphene::chain::account_id_type, &listing_object::seller >,
+                    graphene::chain::member< listing_object, fc::time_point_sec, &listing_object::updated_at >,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
+            >,
+            graphene::chain::ordered_unique<
+                graphene::chain::tag< by_publisher_update_time >,
+                graphene::chain::composite_key< listing_object,
+                    graphene::chain::member< listing_object, graphene::chain::account_id_type, &listing_object::publisher >,
+                    graphene::chain::member< listing_object, fc::time_point_sec, &listing_object::updated_at >,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
+            >,
+            graphene::chain::ordered_unique<
+                graphene::chain::tag< by_price >,
+                graphene::chain::composite_key< listing_object,
+                    listing_price_asset,
+                    listing_price_amount,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
+            >,
+            graphene::chain::ordered_unique<
+                graphene::chain::tag< by_priority_fee >,
+                graphene::chain::composite_key< listing_object,
+                    graphene::chain::member< listing_object, uint16_t, &listing_object::priority_fee >,
+                    graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id >
+                >
             >
         >
     > listing_multi_index_container;
@@ -29,4 +29,14 @@ namespace omnibazaar
                 ) / GRAPHENE_100_PERCENT;
 
     }
+
+    bool pop_weights::operator==(const pop_weights& other)const
+    {
+        return referral == other.referral
+                && listings == other.listings
+                && reputation == other.reputation
+                && trust == other.trust
+                && reliability == other.reliability
+                && verification == other.verification;
+    }
 }
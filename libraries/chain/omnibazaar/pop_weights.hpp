@@ -29,6 +29,10 @@ namespace omnibazaar
                                 const uint32_t reliability_score,
                                 const bool verified
                                 )const;
+
+        // Compare component weights, ignoring extensions.
+        bool operator==(const pop_weights& other)const;
+        bool operator!=(const pop_weights& other)const { return !(*this == other); }
     };
 }
 
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <graphene/db/object.hpp>
+#include <graphene/chain/protocol/types.hpp>
+#include <graphene/chain/protocol/asset.hpp>
+#include <graphene/db/generic_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+namespace omnibazaar {
+
+    // Class storing single reputation vote that one account gave to another.
+    // Votes are kept separately from account statistics so that changing one vote
+    // produces one small undo entry instead of copying all votes of an account.
+    class reputation_vote_object : public graphene::db::abstract_object<reputation_vote_object>
+    {
+    public:
+        static const uint8_t space_id = graphene::chain::implementation_ids;
+        static const uint8_t type_id = graphene::chain::impl_reputation_vote_object_type;
+
+        // Account receiving the vote.
+        graphene::chain::account_id_type target;
+        // Account that gave the vote.
+        graphene::chain::account_id_type voter;
+        // Vote value, between OMNIBAZAAR_REPUTATION_MIN and OMNIBAZAAR_REPUTATION_MAX.
+        uint16_t reputation = 0;
+        // Transfer amount used as vote weight.
+        graphene::chain::asset amount;
+    };
+
+    struct by_target_voter{};
+    struct by_voter_target{};
+    typedef boost::multi_index_container<
+       reputation_vote_object,
+       graphene::chain::indexed_by<
+          graphene::chain::ordered_unique< graphene::chain::tag< graphene::chain::by_id >, graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id > >,
+          graphene::chain::ordered_unique< graphene::chain::tag< by_target_voter >,
+             graphene::chain::composite_key< reputation_vote_object,
+                graphene::chain::member< reputation_vote_object, graphene::chain::account_id_type, &reputation_vote_object::target >,
+                graphene::chain::member< reputation_vote_object, graphene::chain::account_id_type, &reputation_vote_object::voter >
+             >
+          >,
+          graphene::chain::ordered_unique< graphene::chain::tag< by_voter_target >,
+             graphene::chain::composite_key< reputation_vote_object,
+                graphene::chain::member< reputation_vote_object, graphene::chain::account_id_type, &reputation_vote_object::voter >,
+                graphene::chain::member< reputation_vote_object, graphene::chain::account_id_type, &reputation_vote_object::target >
+             >
+          >
+       >
+    > reputation_vote_multi_index_container;
+    typedef graphene::chain::generic_index<reputation_vote_object, reputation_vote_multi_index_container> reputation_vote_index;
+
+}
+
+FC_REFLECT_DERIVED(omnibazaar::reputation_vote_object, (graphene::chain::object),
+                   (target)
+                   (voter)
+                   (reputation)
+                   (amount))
@@ -1,4 +1,5 @@
 #include <sale_bonus_evaluator.hpp>
+#include <seller_buyer_object.hpp>
 #include <omnibazaar_util.hpp>
 #include <graphene/app/database_api.hpp>
 
@@ -19,12 +20,11 @@ namespace omnibazaar {
                 FC_THROW("Sale Bonus is depleted");
             }
 
-            const graphene::chain::account_object& seller = op.seller(d);
-            bonus_ddump((seller.buyers));
-            if(seller.buyers.find(op.buyer) != seller.buyers.end())
+            const auto& buyers_idx = d.get_index_type<seller_buyer_index>().indices().get<by_seller_buyer>();
+            if(buyers_idx.find(boost::make_tuple(op.seller, op.buyer)) != buyers_idx.end())
             {
                 FC_THROW("Sale bonus already received for seller '${seller}' and buyer '${buyer}'",
-                         ("seller", seller.name)
+                         ("seller", op.seller(d).name)
                          ("buyer", op.buyer(d).name));
             }
 
@@ -49,10 +49,11 @@ namespace omnibazaar {
             bonus_dlog("Adjusting balance.");
             d.adjust_balance(op.seller, bonus_sum);
 
-            // Add buyer to the list to prevent multiple bonuses per account.
+            // Link buyer with seller to prevent multiple bonuses per account.
             bonus_dlog("Adding buyer to seller's list.");
-            d.modify(op.seller(d), [&op](graphene::chain::account_object& a) {
-                a.buyers.insert(op.buyer);
+            d.create<seller_buyer_object>([&op](seller_buyer_object& obj) {
+                obj.seller = op.seller;
+                obj.buyer = op.buyer;
             });
 
             // Adjust asset supply value.
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <graphene/db/object.hpp>
+#include <graphene/chain/protocol/types.hpp>
+#include <graphene/db/generic_index.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+namespace omnibazaar {
+
+    // Class linking seller with user that bought something from this seller. Used in Sale Bonus processing.
+    class seller_buyer_object : public graphene::db::abstract_object<seller_buyer_object>
+    {
+    public:
+        static const uint8_t space_id = graphene::chain::implementation_ids;
+        static const uint8_t type_id = graphene::chain::impl_seller_buyer_object_type;
+
+        // Seller account.
+        graphene::chain::account_id_type seller;
+        // Buyer account.
+        graphene::chain::account_id_type buyer;
+    };
+
+    struct by_seller_buyer{};
+    typedef boost::multi_index_container<
+       seller_buyer_object,
+       graphene::chain::indexed_by<
+          graphene::chain::ordered_unique< graphene::chain::tag< graphene::chain::by_id >, graphene::chain::member< graphene::chain::object, graphene::chain::object_id_type, &graphene::chain::object::id > >,
+          graphene::chain::ordered_unique< graphene::chain::tag< by_seller_buyer >,
+             graphene::chain::composite_key< seller_buyer_object,
+                graphene::chain::member< seller_buyer_object, graphene::chain::account_id_type, &seller_buyer_object::seller >,
+                graphene::chain::member< seller_buyer_object, graphene::chain::account_id_type, &seller_buyer_object::buyer >
+             >
+          >
+       >
+    > seller_buyer_multi_index_container;
+    typedef graphene::chain::generic_index<seller_buyer_object, seller_buyer_multi_index_container> seller_buyer_index;
+
+}
+
+FC_REFLECT_DERIVED(omnibazaar::seller_buyer_object, (graphene::chain::object),
+                   (seller)
+                   (buyer))
@@ -27,6 +27,12 @@
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <algorithm>
+#include <mutex>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
 
 namespace graphene { namespace chain {
 
@@ -71,6 +77,7 @@ const signature_type& graphene::chain::signed_transaction::sign(const private_ke
 {
    digest_type h = sig_digest( chain_id );
    signatures.push_back(key.sign_compact(h));
+   _signature_keys.reset();
    return signatures.back();
 }
 
@@ -297,20 +304,148 @@ void verify_authority( const vector<operation>& ops, const flat_set<public_key_t
 } FC_CAPTURE_AND_RETHROW( (ops)(sigs) ) }
 
 
+namespace {
+
+   using namespace boost::multi_index;
+
+   struct signature_cache_entry
+   {
+      std::pair<digest_type, signature_type> signature;
+      public_key_type                        key;
+   };
+
+   /**
+    * Least recently used cache of keys recovered from signatures, shared by all transactions.
+    * It is used concurrently by signature recovery threads, so all access is locked.
+    */
+   class signature_cache
+   {
+      public:
+         optional<public_key_type> find( const digest_type& digest, const signature_type& sig )
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            if( _capacity == 0 )
+               return optional<public_key_type>();
+
+            auto& idx = _entries.get<1>();
+            const auto itr = idx.find( std::make_pair( digest, sig ) );
+            if( itr == idx.end() )
+            {
+               ++_misses;
+               return optional<public_key_type>();
+            }
+
+            ++_hits;
+            _entries.relocate( _entries.begin(), _entries.project<0>( itr ) );
+            return itr->key;
+         }
+
+         void insert( const digest_type& digest, const signature_type& sig, const public_key_type& key )
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            if( _capacity == 0 )
+               return;
+
+            _entries.push_front( signature_cache_entry{ std::make_pair( digest, sig ), key } );
+            while( _entries.size() > _capacity )
+               _entries.pop_back();
+         }
+
+         void set_capacity( size_t capacity )
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _capacity = capacity;
+            while( _entries.size() > _capacity )
+               _entries.pop_back();
+         }
+
+         signature_cache_stats get_stats()
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            signature_cache_stats result;
+            result.capacity = _capacity;
+            result.size = _entries.size();
+            result.hits = _hits;
+            result.misses = _misses;
+            return result;
+         }
+
+      private:
+         typedef multi_index_container<
+            signature_cache_entry,
+            indexed_by<
+               sequenced<>,
+               ordered_unique< member< signature_cache_entry, std::pair<digest_type, signature_type>, &signature_cache_entry::signature > >
+            >
+         > entry_index;
+
+         std::mutex  _mutex;
+         entry_index _entries;
+         size_t      _capacity = 10000;
+         uint64_t    _hits = 0;
+         uint64_t    _misses = 0;
+   };
+
+   signature_cache& get_signature_cache()
+   {
+      static signature_cache cache;
+      return cache;
+   }
+
+} // anonymous namespace
+
+void set_signature_cache_capacity( size_t capacity )
+{
+   get_signature_cache().set_capacity( capacity );
+}
+
+signature_cache_stats get_signature_cache_stats()
+{
+   return get_signature_cache().get_stats();
+}
+
 flat_set<public_key_type> signed_transaction::get_signature_keys( const chain_id_type& chain_id )const
 { try {
    auto d = sig_digest( chain_id );
+   if( _signature_keys.valid() && _signature_keys->digest == d && _signature_keys->signatures == signatures )
+      return _signature_keys->keys;
+
+   signature_cache& cache = get_signature_cache();
    flat_set<public_key_type> result;
    for( const auto&  sig : signatures )
    {
+      optional<public_key_type> key = cache.find( d, sig );
+      if( !key.valid() )
+      {
+         key = public_key_type( fc::ecc::public_key(sig,d) );
+         cache.insert( d, sig, *key );
+      }
       GRAPHENE_ASSERT(
-         result.insert( fc::ecc::public_key(sig,d) ).second,
+         result.insert( *key ).second,
          tx_duplicate_sig,
          "Duplicate Signature detected" );
    }
    return result;
 } FC_CAPTURE_AND_RETHROW() }
 
+void signed_transaction::precompute_signature_keys( const chain_id_type& chain_id )const
+{
+   try
+   {
+      recovered_signature_keys recovered;
+      recovered.digest = sig_digest( chain_id );
+      if( _signature_keys.valid() && _signature_keys->digest == recovered.digest
+          && _signature_keys->signatures == signatures )
+         return;
+      recovered.keys = get_signature_keys( chain_id );
+      recovered.signatures = signatures;
+      _signature_keys = std::move( recovered );
+   }
+   catch( const fc::exception& )
+   {
+      // Leave the error to be thrown when transaction is applied.
+   }
+}
 
 
 set<public_key_type> signed_transaction::get_required_signatures(
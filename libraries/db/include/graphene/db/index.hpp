@@ -27,12 +27,170 @@
 #include <fc/io/raw.hpp>
 #include <fc/io/json.hpp>
 #include <fc/crypto/sha256.hpp>
+#include <fc/crypto/city.hpp>
+#include <fc/container/flat_fwd.hpp>
 #include <fstream>
+#include <map>
+#include <set>
+#include <type_traits>
+#include <typeinfo>
 
 namespace graphene { namespace db {
    class object_database;
    using fc::path;
 
+   /**
+    *  Snapshot file of one index starts with a header containing magic number, format version, next object ID
+    *  and hash of object type description. It is followed by chunks of packed objects, each preceded by
+    *  @ref snapshot_chunk_header, and terminated by an empty chunk header. Footer contains number of objects,
+    *  number of chunks and the magic number again.
+    */
+   const uint64_t snapshot_magic          = 0x3250414e53424447ull; // "GDBSNAP2"
+   const uint32_t snapshot_format_version = 1;
+   const size_t   snapshot_chunk_size     = 1024 * 1024;
+
+   struct snapshot_chunk_header
+   {
+      uint32_t object_count = 0;
+      uint32_t size = 0;
+      uint64_t checksum = 0;
+   };
+
+   template<typename T, typename Enable = void>
+   struct type_description;
+
+   /**
+    *  Visits reflected members of a type and appends their names and descriptions of their types to description.
+    */
+   struct type_description_visitor
+   {
+      type_description_visitor( std::string& d ):description(d){}
+
+      template<typename Member, class Class, Member (Class::*member)>
+      void operator()( const char* name )const
+      {
+         description += name;
+         description += ':';
+         type_description<Member>::append( description );
+         description += ';';
+      }
+
+      std::string& description;
+   };
+
+   template<typename T, typename Enable = void>
+   struct has_typename : std::false_type {};
+   template<typename T>
+   struct has_typename<T, decltype( void( fc::get_typename<T>::name() ) )> : std::true_type {};
+
+   /** Types without reflected members are described by their name, types unknown to fc by their RTTI name. */
+   template<typename T>
+   typename std::enable_if<has_typename<T>::value, std::string>::type get_type_name()
+   {
+      return fc::get_typename<T>::name();
+   }
+   template<typename T>
+   typename std::enable_if<!has_typename<T>::value, std::string>::type get_type_name()
+   {
+      return typeid(T).name();
+   }
+
+   template<typename T, typename Enable>
+   struct type_description
+   {
+      static void append( std::string& description ) { description += get_type_name<T>(); }
+   };
+
+   /** Reflected structures are described by their members, recursively. */
+   template<typename T>
+   struct type_description<T, typename std::enable_if<fc::reflector<T>::is_defined::value
+                                                      && !fc::reflector<T>::is_enum::value>::type>
+   {
+      static void append( std::string& description )
+      {
+         description += get_type_name<T>();
+         description += '{';
+         fc::reflector<T>::visit( type_description_visitor( description ) );
+         description += '}';
+      }
+   };
+
+   /** Containers are described by their kind and descriptions of their elements. */
+   template<typename... T>
+   struct type_description_list;
+   template<>
+   struct type_description_list<>
+   {
+      static void append( std::string& description ) {}
+   };
+   template<typename T, typename... Rest>
+   struct type_description_list<T, Rest...>
+   {
+      static void append( std::string& description )
+      {
+         type_description<T>::append( description );
+         description += sizeof...(Rest) ? "," : "";
+         type_description_list<Rest...>::append( description );
+      }
+   };
+
+   template<typename... T>
+   void append_container_description( std::string& description, const char* kind )
+   {
+      description += kind;
+      description += '<';
+      type_description_list<T...>::append( description );
+      description += '>';
+   }
+
+   template<typename T>
+   struct type_description<fc::optional<T>>
+   {
+      static void append( std::string& description ) { append_container_description<T>( description, "optional" ); }
+   };
+   template<typename T, typename A>
+   struct type_description<std::vector<T, A>>
+   {
+      static void append( std::string& description ) { append_container_description<T>( description, "vector" ); }
+   };
+   template<typename T, typename C, typename A>
+   struct type_description<std::set<T, C, A>>
+   {
+      static void append( std::string& description ) { append_container_description<T>( description, "set" ); }
+   };
+   template<typename T, typename... A>
+   struct type_description<boost::container::flat_set<T, A...>>
+   {
+      static void append( std::string& description ) { append_container_description<T>( description, "set" ); }
+   };
+   template<typename K, typename V, typename C, typename A>
+   struct type_description<std::map<K, V, C, A>>
+   {
+      static void append( std::string& description ) { append_container_description<K, V>( description, "map" ); }
+   };
+   template<typename K, typename V, typename... A>
+   struct type_description<boost::container::flat_map<K, V, A...>>
+   {
+      static void append( std::string& description ) { append_container_description<K, V>( description, "map" ); }
+   };
+   template<typename A, typename B>
+   struct type_description<std::pair<A, B>>
+   {
+      static void append( std::string& description ) { append_container_description<A, B>( description, "pair" ); }
+   };
+
+   /**
+    *  @return description of object layout built from names and types of its reflected members and of members
+    *  of their types, so that snapshots written with a different layout are rejected.
+    */
+   template<typename T>
+   std::string get_type_description()
+   {
+      std::string description;
+      type_description<T>::append( description );
+      return description;
+   }
+
    /**
     * @class index_observer
     * @brief used to get callbacks when objects change
@@ -132,6 +290,8 @@ namespace graphene { namespace db {
 
          virtual void               object_from_variant( const fc::variant& var, object& obj )const = 0;
          virtual void               object_default( object& obj )const = 0;
+         /** Creates an object of this index type from its packed form, without inserting it. */
+         virtual unique_ptr<object> unpack_object( const std::vector<char>& data )const = 0;
    };
 
    class secondary_index
@@ -182,6 +342,17 @@ namespace graphene { namespace db {
             FC_THROW_EXCEPTION( fc::assert_exception, "invalid index type" );
          }
 
+         template<typename T>
+         T& get_secondary_index()
+         {
+            for( const auto& item : _sindex )
+            {
+               T* result = dynamic_cast<T*>(item.get());
+               if( result != nullptr ) return *result;
+            }
+            FC_THROW_EXCEPTION( fc::assert_exception, "invalid index type" );
+         }
+
       protected:
          vector< shared_ptr<index_observer> >   _observers;
          vector< unique_ptr<secondary_index> >  _sindex;
@@ -219,29 +390,64 @@ namespace graphene { namespace db {
 
          fc::sha256 get_object_version()const
          {
-            std::string desc = "1.0";//get_type_description<object_type>();
-            return fc::sha256::hash(desc);
+            return fc::sha256::hash( get_type_description<object_type>() );
          }
 
          virtual void open( const path& db )override
          { 
-            if( !fc::exists( db ) ) return;
+            if( !fc::exists( db ) || fc::file_size( db ) == 0 ) return;
             fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
             fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
             fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
-            fc::sha256 open_ver;
 
-            fc::raw::unpack(ds, _next_id);
-            fc::raw::unpack(ds, open_ver);
+            uint64_t magic = 0;
+            if( ds.remaining() >= sizeof(magic) )
+               fc::raw::unpack( ds, magic );
+            if( magic != snapshot_magic )
+            {
+               fc::datastream<const char*> legacy_ds( (const char*)mr.get_address(), mr.get_size() );
+               open_legacy( legacy_ds );
+               return;
+            }
+
+            uint32_t format_version = 0;
+            fc::raw::unpack( ds, format_version );
+            FC_ASSERT( format_version == snapshot_format_version, "Unsupported snapshot format version ${v}", ("v",format_version) );
+            fc::raw::unpack( ds, _next_id );
+            fc::sha256 open_ver;
+            fc::raw::unpack( ds, open_ver );
             FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            try {
-               vector<char> tmp;
-               while( true ) 
+
+            uint64_t object_count = 0;
+            uint32_t chunk_count = 0;
+            while( true )
+            {
+               snapshot_chunk_header header;
+               fc::raw::unpack( ds, header );
+               if( header.object_count == 0 )
+                  break;
+
+               FC_ASSERT( ds.remaining() >= header.size, "Truncated snapshot ${f}", ("f",db) );
+               FC_ASSERT( fc::city_hash64( ds.pos(), header.size ) == header.checksum, "Checksum mismatch in snapshot ${f}", ("f",db) );
+               fc::datastream<const char*> chunk_ds( ds.pos(), header.size );
+               for( uint32_t i = 0; i < header.object_count; ++i )
                {
-                  fc::raw::unpack( ds, tmp );
-                  load( tmp );
+                  object_type obj;
+                  fc::raw::unpack( chunk_ds, obj );
+                  load_object( std::move(obj) );
                }
-            } catch ( const fc::exception&  ){}
+               ds.skip( header.size );
+               object_count += header.object_count;
+               ++chunk_count;
+            }
+
+            uint64_t expected_object_count = 0;
+            uint32_t expected_chunk_count = 0;
+            fc::raw::unpack( ds, expected_object_count );
+            fc::raw::unpack( ds, expected_chunk_count );
+            fc::raw::unpack( ds, magic );
+            FC_ASSERT( object_count == expected_object_count && chunk_count == expected_chunk_count && magic == snapshot_magic,
+                       "Corrupted snapshot ${f}", ("f",db) );
          }
 
          virtual void save( const path& db ) override 
@@ -249,22 +455,52 @@ namespace graphene { namespace db {
             std::ofstream out( db.generic_string(), 
                                std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
             FC_ASSERT( out );
-            auto ver  = get_object_version();
+            fc::raw::pack( out, snapshot_magic );
+            fc::raw::pack( out, snapshot_format_version );
             fc::raw::pack( out, _next_id );
-            fc::raw::pack( out, ver );
+            fc::raw::pack( out, get_object_version() );
+
+            // Objects are packed back to back into chunks, each chunk is checksummed as a whole.
+            uint64_t object_count = 0;
+            uint32_t chunk_count = 0;
+            vector<char> chunk;
+            chunk.reserve( snapshot_chunk_size );
+            snapshot_chunk_header header;
+            const auto write_chunk = [&]() {
+               header.size = chunk.size();
+               header.checksum = fc::city_hash64( chunk.data(), chunk.size() );
+               fc::raw::pack( out, header );
+               out.write( chunk.data(), chunk.size() );
+               object_count += header.object_count;
+               ++chunk_count;
+               header = snapshot_chunk_header();
+               chunk.clear();
+            };
             this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
+               const object_type& obj = static_cast<const object_type&>(o);
+               const size_t offset = chunk.size();
+               const size_t size = fc::raw::pack_size( obj );
+               chunk.resize( offset + size );
+               fc::datastream<char*> ds( chunk.data() + offset, size );
+               fc::raw::pack( ds, obj );
+               ++header.object_count;
+               if( chunk.size() >= snapshot_chunk_size )
+                  write_chunk();
             });
+            if( header.object_count > 0 )
+               write_chunk();
+
+            fc::raw::pack( out, snapshot_chunk_header() );
+            fc::raw::pack( out, object_count );
+            fc::raw::pack( out, chunk_count );
+            fc::raw::pack( out, snapshot_magic );
+            out.flush();
+            FC_ASSERT( out.good(), "Failed to write snapshot ${f}", ("f",db) );
          }
 
          virtual const object&  load( const std::vector<char>& data )override
          {
-            const auto& result = DerivedIndex::insert( fc::raw::unpack<object_type>( data ) );
-            for( const auto& item : _sindex )
-               item->object_inserted( result );
-            return result;
+            return load_object( fc::raw::unpack<object_type>( data ) );
          }
 
 
@@ -277,6 +513,15 @@ namespace graphene { namespace db {
             return result;
          }
 
+         virtual const object& insert( object&& obj ) override
+         {
+            // Used by undo to restore removed objects, secondary indexes have to see them again.
+            const auto& result = DerivedIndex::insert( std::move(obj) );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            return result;
+         }
+
          virtual void  remove( const object& obj ) override
          {
             for( const auto& item : _sindex )
@@ -319,8 +564,43 @@ namespace graphene { namespace db {
             obj.id = id;
          }
 
+         virtual unique_ptr<object> unpack_object( const std::vector<char>& data )const override
+         {
+            unique_ptr<object_type> result( new object_type() );
+            fc::raw::unpack( data, *result );
+            return std::move(result);
+         }
+
       private:
+         const object& load_object( object_type&& obj )
+         {
+            const auto& result = DerivedIndex::insert( std::move(obj) );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            return result;
+         }
+
+         /** Reads snapshot written before versioned format, as a stream of packed vectors of packed objects. */
+         void open_legacy( fc::datastream<const char*>& ds )
+         {
+            fc::sha256 open_ver;
+
+            fc::raw::unpack(ds, _next_id);
+            fc::raw::unpack(ds, open_ver);
+            FC_ASSERT( open_ver == fc::sha256::hash( std::string("1.0") ), "Incompatible Version, the serialization of objects in this index has changed" );
+            try {
+               vector<char> tmp;
+               while( true ) 
+               {
+                  fc::raw::unpack( ds, tmp );
+                  load( tmp );
+               }
+            } catch ( const fc::exception&  ){}
+         }
+
          object_id_type _next_id;
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::snapshot_chunk_header, (object_count)(size)(checksum) )
@@ -29,6 +29,7 @@
 #include <fc/log/logger.hpp>
 
 #include <map>
+#include <set>
 
 namespace graphene { namespace db {
 
@@ -42,10 +43,16 @@ namespace graphene { namespace db {
          object_database();
          ~object_database();
 
-         void reset_indexes() { _index.clear(); _index.resize(255); }
+         void reset_indexes() { _index.clear(); _index.resize(255); _load_dependencies.clear(); }
 
          void open(const fc::path& data_dir );
 
+         /**
+          * Makes open() load dependent after dependency, on the same thread. Needed when secondary indexes
+          * of both update shared state while objects are loaded. Other indexes are loaded in parallel.
+          */
+         void add_load_dependency( index& dependent, index& dependency );
+
          /**
           * Saves the complete state of the object_database to disk, this could take a while
           */
@@ -164,8 +171,11 @@ namespace graphene { namespace db {
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
 
+         void open_index( index* idx, std::set<index*>& opened );
+
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+         std::map< index*, vector<index*> >                        _load_dependencies;
    };
 
 } } // graphene::db
@@ -24,7 +24,9 @@
 #pragma once
 #include <graphene/db/object.hpp>
 #include <deque>
+#include <map>
 #include <fc/exception/exception.hpp>
+#include <fc/reflect/reflect.hpp>
 
 namespace graphene { namespace db {
 
@@ -32,12 +34,53 @@ namespace graphene { namespace db {
    using fc::flat_set;
    class object_database;
 
+   /**
+    *  Value of an object saved in undo state. It is kept either as a full copy, which is fast to restore,
+    *  or packed with object reflection, which takes several times less memory for large objects.
+    */
+   class undo_value
+   {
+      public:
+         undo_value(){}
+         undo_value( const object& obj, bool packed );
+
+         bool                 is_packed()const { return _object == nullptr; }
+         /** @return full copy of saved object, or nullptr if object is packed */
+         const object*        get()const { return _object.get(); }
+         /** @return copy of saved object, unpacked by index of its type if needed */
+         unique_ptr<object>   unpack( const object_database& db, object_id_type id )const;
+         /** Same as unpack(), but moves full copy out instead of copying it. */
+         unique_ptr<object>   take( const object_database& db, object_id_type id );
+         /** Estimated memory held by this value, in bytes. */
+         size_t               memory_size()const;
+
+      private:
+         unique_ptr<object>   _object;
+         vector<char>         _packed;
+   };
+
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
+      unordered_map<object_id_type, undo_value >         old_values;
       unordered_map<object_id_type, object_id_type>      old_index_next_ids;
       std::unordered_set<object_id_type>                 new_ids;
-      unordered_map<object_id_type, unique_ptr<object> > removed;
+      unordered_map<object_id_type, undo_value >         removed;
+   };
+
+   /** Memory held by saved object values of one type in undo state. */
+   struct undo_type_usage
+   {
+      uint64_t objects = 0;
+      uint64_t bytes = 0;
+   };
+
+   /** Memory held by saved object values in one undo state. */
+   struct undo_level_usage
+   {
+      uint64_t objects = 0;
+      uint64_t bytes = 0;
+      /// usage per object type, keyed by ID of the index (instance is always 0)
+      std::map<object_id_type, undo_type_usage> types;
    };
 
 
@@ -132,6 +175,21 @@ namespace graphene { namespace db {
 
          const undo_state& head()const;
 
+         /**
+          *  Set whether values of modified and removed objects are stored packed instead of full copies.
+          *  Packed values take less memory, but have to be unpacked when state is undone.
+          *  Affects only values saved after the call.
+          */
+         void set_packed_values( bool packed ) { _packed_values = packed; }
+         bool packed_values()const { return _packed_values; }
+
+         /**
+          *  @return memory held by saved object values in each undo state, from oldest to newest.
+          *  Sizes of full copies are estimated by their packed size, so this is rather slow and should not be
+          *  called while applying blocks.
+          */
+         vector<undo_level_usage> get_memory_usage()const;
+
       private:
          void undo();
          void merge();
@@ -142,6 +200,10 @@ namespace graphene { namespace db {
          std::deque<undo_state>  _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
+         bool                    _packed_values = false;
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::undo_type_usage, (objects)(bytes) )
+FC_REFLECT( graphene::db::undo_level_usage, (objects)(bytes)(types) )
@@ -27,6 +27,11 @@
 #include <fc/container/flat.hpp>
 #include <fc/uint128.hpp>
 
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 namespace graphene { namespace db {
 
 object_database::object_database()
@@ -68,18 +73,68 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
    return *idx;
 }
 
+namespace {
+
+/**
+ * Runs tasks on all available cores and rethrows the first exception thrown by any of them.
+ */
+void run_in_parallel( const vector<std::function<void()>>& tasks )
+{
+   const uint32_t cores = std::thread::hardware_concurrency();
+   const size_t thread_count = std::min<size_t>( tasks.size(), cores > 0 ? cores : 1 );
+
+   std::atomic<size_t> next_task( 0 );
+   std::mutex error_mutex;
+   std::exception_ptr error;
+   const auto worker = [&]() {
+      for( size_t i = next_task++; i < tasks.size(); i = next_task++ )
+      {
+         try
+         {
+            tasks[i]();
+         }
+         catch( ... )
+         {
+            std::lock_guard<std::mutex> lock( error_mutex );
+            if( !error )
+               error = std::current_exception();
+         }
+      }
+   };
+
+   vector<std::thread> threads;
+   for( size_t i = 1; i < thread_count; ++i )
+      threads.emplace_back( worker );
+   worker();
+   for( auto& t : threads )
+      t.join();
+
+   if( error )
+      std::rethrow_exception( error );
+}
+
+}
+
 void object_database::flush()
 {
 //   ilog("Save object_database in ${d}", ("d", _data_dir));
    fc::create_directories( _data_dir / "object_database.tmp" / "lock" );
+
+   // Every index is written to its own file, so they are saved in parallel.
+   vector<std::function<void()>> tasks;
    for( uint32_t space = 0; space < _index.size(); ++space )
    {
       fc::create_directories( _data_dir / "object_database.tmp" / fc::to_string(space) );
       const auto types = _index[space].size();
       for( uint32_t type = 0; type  <  types; ++type )
          if( _index[space][type] )
-            _index[space][type]->save( _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type) );
+         {
+            index* idx = _index[space][type].get();
+            const fc::path path = _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type);
+            tasks.emplace_back( [idx, path](){ idx->save( path ); } );
+         }
    }
+   run_in_parallel( tasks );
    fc::remove_all( _data_dir / "object_database.tmp" / "lock" );
    if( fc::exists( _data_dir / "object_database" ) )
       fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
@@ -104,14 +159,60 @@ void object_database::open(const fc::path& data_dir)
        return;
    }
    ilog("Opening object database from ${d} ...", ("d", data_dir));
+   const fc::time_point start = fc::time_point::now();
+
+   // Indexes are loaded in parallel, except for indexes connected by load dependencies. Every set of connected
+   // indexes is loaded by one task, each index after its dependencies.
+   std::map<index*, std::set<index*>> connected;
+   for( const auto& item : _load_dependencies )
+      for( index* dependency : item.second )
+      {
+         connected[item.first].insert( dependency );
+         connected[dependency].insert( item.first );
+      }
+
+   std::set<index*> grouped;
+   vector<std::function<void()>> tasks;
    for( uint32_t space = 0; space < _index.size(); ++space )
       for( uint32_t type = 0; type  < _index[space].size(); ++type )
-         if( _index[space][type] )
-            _index[space][type]->open( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
-   ilog( "Done opening object database." );
+         if( _index[space][type] && grouped.insert( _index[space][type].get() ).second )
+         {
+            vector<index*> group( 1, _index[space][type].get() );
+            for( size_t i = 0; i < group.size(); ++i )
+            {
+               const auto itr = connected.find( group[i] );
+               if( itr != connected.end() )
+                  for( index* idx : itr->second )
+                     if( grouped.insert( idx ).second )
+                        group.push_back( idx );
+            }
+            tasks.emplace_back( [this, group](){
+               std::set<index*> opened;
+               for( index* idx : group )
+                  open_index( idx, opened );
+            });
+         }
+   run_in_parallel( tasks );
+   ilog( "Done opening object database in ${t} ms.", ("t", (fc::time_point::now() - start).count() / 1000) );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
+void object_database::add_load_dependency( index& dependent, index& dependency )
+{
+   _load_dependencies[&dependent].push_back( &dependency );
+}
+
+void object_database::open_index( index* idx, std::set<index*>& opened )
+{
+   if( !opened.insert( idx ).second )
+      return;
+   const auto itr = _load_dependencies.find( idx );
+   if( itr != _load_dependencies.end() )
+      for( index* dependency : itr->second )
+         open_index( dependency, opened );
+   idx->open( _data_dir / "object_database" / fc::to_string(idx->object_space_id()) / fc::to_string(idx->object_type_id()) );
+}
+
 
 void object_database::pop_undo()
 { try {
@@ -27,6 +27,35 @@
 
 namespace graphene { namespace db {
 
+undo_value::undo_value( const object& obj, bool packed )
+{
+   if( packed )
+      _packed = obj.pack();
+   else
+      _object = obj.clone();
+}
+
+unique_ptr<object> undo_value::unpack( const object_database& db, object_id_type id )const
+{
+   if( _object )
+      return _object->clone();
+   return db.get_index( id ).unpack_object( _packed );
+}
+
+unique_ptr<object> undo_value::take( const object_database& db, object_id_type id )
+{
+   if( _object )
+      return std::move( _object );
+   return db.get_index( id ).unpack_object( _packed );
+}
+
+size_t undo_value::memory_size()const
+{
+   if( _object )
+      return _object->pack().size();
+   return _packed.capacity();
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -68,7 +97,7 @@ void undo_database::on_modify( const object& obj )
       return;
    auto itr =  state.old_values.find(obj.id);
    if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   state.old_values[obj.id] = undo_value( obj, _packed_values );
 }
 void undo_database::on_remove( const object& obj )
 {
@@ -89,7 +118,7 @@ void undo_database::on_remove( const object& obj )
       return;
    }
    if( state.removed.count(obj.id) ) return;
-   state.removed[obj.id] = obj.clone();
+   state.removed[obj.id] = undo_value( obj, _packed_values );
 }
 
 void undo_database::undo()
@@ -101,7 +130,8 @@ void undo_database::undo()
    auto& state = _stack.back();
    for( auto& item : state.old_values )
    {
-      _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
+      unique_ptr<object> old_value = item.second.take( _db, item.first );
+      _db.modify( _db.get_object( item.first ), [&]( object& obj ){ obj.move_from( *old_value ); } );
    }
 
    for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
@@ -115,7 +145,7 @@ void undo_database::undo()
    }
 
    for( auto& item : state.removed )
-      _db.insert( std::move(*item.second) );
+      _db.insert( std::move(*item.second.take( _db, item.first )) );
 
    _stack.pop_back();
    enable();
@@ -180,20 +210,20 @@ void undo_database::merge()
    // *+upd
    for( auto& obj : state.old_values )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+      if( prev_state.new_ids.find(obj.first) != prev_state.new_ids.end() )
       {
          // new+upd -> new, type A
          continue;
       }
-      if( prev_state.old_values.find(obj.second->id) != prev_state.old_values.end() )
+      if( prev_state.old_values.find(obj.first) != prev_state.old_values.end() )
       {
          // upd(was=X) + upd(was=Y) -> upd(was=X), type A
          continue;
       }
       // del+upd -> N/A
-      assert( prev_state.removed.find(obj.second->id) == prev_state.removed.end() );
+      assert( prev_state.removed.find(obj.first) == prev_state.removed.end() );
       // nop+upd(was=Y) -> upd(was=Y), type B
-      prev_state.old_values[obj.second->id] = std::move(obj.second);
+      prev_state.old_values[obj.first] = std::move(obj.second);
    }
 
    // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
@@ -220,24 +250,24 @@ void undo_database::merge()
    // *+del
    for( auto& obj : state.removed )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+      if( prev_state.new_ids.find(obj.first) != prev_state.new_ids.end() )
       {
          // new + del -> nop (type C)
-         prev_state.new_ids.erase(obj.second->id);
+         prev_state.new_ids.erase(obj.first);
          continue;
       }
-      auto it = prev_state.old_values.find(obj.second->id);
+      auto it = prev_state.old_values.find(obj.first);
       if( it != prev_state.old_values.end() )
       {
          // upd(was=X) + del(was=Y) -> del(was=X)
-         prev_state.removed[obj.second->id] = std::move(it->second);
-         prev_state.old_values.erase(obj.second->id);
+         prev_state.removed[obj.first] = std::move(it->second);
+         prev_state.old_values.erase(obj.first);
          continue;
       }
       // del + del -> N/A
-      assert( prev_state.removed.find( obj.second->id ) == prev_state.removed.end() );
+      assert( prev_state.removed.find( obj.first ) == prev_state.removed.end() );
       // nop + del(was=Y) -> del(was=Y)
-      prev_state.removed[obj.second->id] = std::move(obj.second);
+      prev_state.removed[obj.first] = std::move(obj.second);
    }
    _stack.pop_back();
    --_active_sessions;
@@ -259,7 +289,8 @@ void undo_database::pop_commit()
 
       for( auto& item : state.old_values )
       {
-         _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
+         unique_ptr<object> old_value = item.second.take( _db, item.first );
+         _db.modify( _db.get_object( item.first ), [&]( object& obj ){ obj.move_from( *old_value ); } );
       }
 
       for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
@@ -273,7 +304,7 @@ void undo_database::pop_commit()
       }
 
       for( auto& item : state.removed )
-         _db.insert( std::move(*item.second) );
+         _db.insert( std::move(*item.second.take( _db, item.first )) );
 
       _stack.pop_back();
    }
@@ -291,4 +322,30 @@ const undo_state& undo_database::head()const
    return _stack.back();
 }
 
+vector<undo_level_usage> undo_database::get_memory_usage()const
+{
+   vector<undo_level_usage> result;
+   result.reserve( _stack.size() );
+   for( const auto& state : _stack )
+   {
+      undo_level_usage level;
+      const auto add_values = [&level]( const unordered_map<object_id_type, undo_value>& values )
+      {
+         for( const auto& item : values )
+         {
+            const size_t bytes = item.second.memory_size();
+            undo_type_usage& type = level.types[ object_id_type( item.first.space(), item.first.type(), 0 ) ];
+            ++type.objects;
+            type.bytes += bytes;
+            ++level.objects;
+            level.bytes += bytes;
+         }
+      };
+      add_values( state.old_values );
+      add_values( state.removed );
+      result.push_back( std::move(level) );
+   }
+   return result;
+}
+
 } } // graphene::db
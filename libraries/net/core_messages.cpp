@@ -23,6 +23,8 @@
  */
 #include <graphene/net/core_messages.hpp>
 
+#include <zlib.h>
+
 
 namespace graphene { namespace net {
 
@@ -48,7 +50,67 @@ namespace graphene { namespace net {
   const core_message_type_enum mail_message::type                            = core_message_type_enum::mail_message_type;
   const core_message_type_enum mail_received_message::type                   = core_message_type_enum::mail_received_message_type;
   const core_message_type_enum mail_confirm_received_message::type           = core_message_type_enum::mail_confirm_received_message_type;
+  const core_message_type_enum mail_inventory_message::type                  = core_message_type_enum::mail_inventory_message_type;
+  const core_message_type_enum mail_fetch_message::type                      = core_message_type_enum::mail_fetch_message_type;
+  const core_message_type_enum mail_subscription_message::type               = core_message_type_enum::mail_subscription_message_type;
+  const core_message_type_enum compressed_message::type                      = core_message_type_enum::compressed_message_type;
+
+  message_ptr compress_message(const message_ptr& message_to_compress)
+  {
+    switch (message_to_compress->msg_type)
+    {
+    case core_message_type_enum::trx_message_type:
+    case core_message_type_enum::block_message_type:
+    case core_message_type_enum::blockchain_item_ids_inventory_message_type:
+    case core_message_type_enum::mail_message_type:
+      break;
+    default:
+      return message_to_compress;
+    }
+    if (message_to_compress->size < GRAPHENE_NET_COMPRESSION_THRESHOLD_BYTES)
+      return message_to_compress;
+
+    compressed_message compressed;
+    compressed.msg_type = message_to_compress->msg_type;
+    compressed.uncompressed_size = message_to_compress->size;
+    uLongf compressed_size = compressBound(message_to_compress->size);
+    compressed.data.resize(compressed_size);
+    if (compress2((Bytef*)compressed.data.data(), &compressed_size,
+                  (const Bytef*)message_to_compress->data.data(), message_to_compress->size,
+                  Z_DEFAULT_COMPRESSION) != Z_OK)
+      return message_to_compress;
+    compressed.data.resize(compressed_size);
+
+    std::shared_ptr<message> result = std::make_shared<message>(compressed);
+    if (result->size >= message_to_compress->size)
+      return message_to_compress;
+    return result;
+  }
+
+  message decompress_message(const compressed_message& message_to_decompress)
+  {
+    FC_ASSERT(message_to_decompress.msg_type != core_message_type_enum::compressed_message_type,
+              "compressed message can not contain another compressed message");
+    FC_ASSERT(message_to_decompress.uncompressed_size > 0 && message_to_decompress.uncompressed_size <= MAX_MESSAGE_SIZE,
+              "compressed message declares invalid uncompressed size ${uncompressed_size}",
+              ("uncompressed_size", message_to_decompress.uncompressed_size)("MAX_MESSAGE_SIZE", MAX_MESSAGE_SIZE));
+
+    message result;
+    result.msg_type = message_to_decompress.msg_type;
+    result.data.resize(message_to_decompress.uncompressed_size);
+    uLongf uncompressed_size = message_to_decompress.uncompressed_size;
+    FC_ASSERT(uncompress((Bytef*)result.data.data(), &uncompressed_size,
+                         (const Bytef*)message_to_decompress.data.data(), message_to_decompress.data.size()) == Z_OK &&
+              uncompressed_size == message_to_decompress.uncompressed_size,
+              "invalid compressed message of type ${type}", ("type", message_to_decompress.msg_type));
+    result.size = (uint32_t)uncompressed_size;
+    return result;
+  }
 
+  bool peer_supports_compression(const fc::variant_object& hello_user_data)
+  {
+    return hello_user_data.contains("compression") && hello_user_data["compression"].as_string() == "zlib";
+  }
 
 } } // graphene::net
 
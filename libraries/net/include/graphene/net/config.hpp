@@ -60,6 +60,19 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
+/**
+ * Messages padded to at most this many bytes are gathered and written to
+ * the socket together while more messages are queued for the same peer.
+ * Larger messages are written straight from their own data.
+ */
+#define GRAPHENE_NET_SEND_COALESCE_BYTES                     4096
+
+/**
+ * Block, transaction, item ids inventory and mail messages of at least this
+ * many bytes are compressed for peers which support it.
+ */
+#define GRAPHENE_NET_COMPRESSION_THRESHOLD_BYTES             1024
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
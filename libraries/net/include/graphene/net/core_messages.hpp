@@ -24,6 +24,7 @@
 #pragma once
 
 #include <graphene/net/config.hpp>
+#include <graphene/net/message.hpp>
 #include <graphene/chain/protocol/block.hpp>
 
 #include <fc/crypto/ripemd160.hpp>
@@ -89,6 +90,10 @@ namespace graphene { namespace net {
     mail_message_type                            = 5018,
     mail_received_message_type                   = 5019,
     mail_confirm_received_message_type           = 5020,
+    mail_inventory_message_type                  = 5021,
+    mail_fetch_message_type                      = 5022,
+    mail_subscription_message_type               = 5023,
+    compressed_message_type                      = 5024,
     core_message_type_last                       = 5099
   };
 
@@ -430,6 +435,57 @@ namespace graphene { namespace net {
       mail_confirm_received_message(std::string u) : mail_uuid(u) {}
   };
 
+  // Announcement that sending node has specified mail, which can be requested with mail_fetch_message.
+  struct mail_inventory_message
+  {
+      static const core_message_type_enum type;
+      std::string mail_uuid;
+      std::string recipient;
+
+      mail_inventory_message() {}
+      mail_inventory_message(std::string u, std::string r) : mail_uuid(u), recipient(r) {}
+  };
+
+  // Request for mail announced with mail_inventory_message, answered with mail_message.
+  struct mail_fetch_message
+  {
+      static const core_message_type_enum type;
+      std::string mail_uuid;
+
+      mail_fetch_message() {}
+      mail_fetch_message(std::string u) : mail_uuid(u) {}
+  };
+
+  // Changes in the set of users subscribed to their mail on sending node.
+  struct mail_subscription_message
+  {
+      static const core_message_type_enum type;
+      std::vector<std::string> subscribed;
+      std::vector<std::string> unsubscribed;
+
+      mail_subscription_message() {}
+      mail_subscription_message(std::vector<std::string> s, std::vector<std::string> u) : subscribed(s), unsubscribed(u) {}
+  };
+
+  // Message of type msg_type compressed with zlib, only sent to peers which advertise compression in hello user data.
+  struct compressed_message
+  {
+      static const core_message_type_enum type;
+      uint32_t          msg_type;
+      uint32_t          uncompressed_size;
+      std::vector<char> data;
+  };
+
+  /**
+   * Compresses large block, transaction, item ids inventory and mail messages.
+   * @return compressed_message, or message_to_compress itself if it is not worth compressing
+   */
+  message_ptr compress_message(const message_ptr& message_to_compress);
+  /** Restores the message wrapped in compressed_message, throws if it is malformed */
+  message decompress_message(const compressed_message& message_to_decompress);
+  /** Checks hello user data of a peer, peers which don't advertise compression get uncompressed messages */
+  bool peer_supports_compression(const fc::variant_object& hello_user_data);
+
 } } // graphene::net
 
 FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
@@ -456,6 +512,10 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (mail_message_type)
                  (mail_received_message_type)
                  (mail_confirm_received_message_type)
+                 (mail_inventory_message_type)
+                 (mail_fetch_message_type)
+                 (mail_subscription_message_type)
+                 (compressed_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
@@ -547,6 +607,14 @@ FC_REFLECT(graphene::net::mail_received_message, (mail_uuid))
 
 FC_REFLECT(graphene::net::mail_confirm_received_message, (mail_uuid))
 
+FC_REFLECT(graphene::net::mail_inventory_message, (mail_uuid)(recipient))
+
+FC_REFLECT(graphene::net::mail_fetch_message, (mail_uuid))
+
+FC_REFLECT(graphene::net::mail_subscription_message, (subscribed)(unsubscribed))
+
+FC_REFLECT(graphene::net::compressed_message, (msg_type)(uncompressed_size)(data))
+
 #include <unordered_map>
 #include <fc/crypto/city.hpp>
 #include <fc/crypto/sha224.hpp>
@@ -29,6 +29,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+
 namespace graphene { namespace net {
 
   /**
@@ -108,8 +110,8 @@ namespace graphene { namespace net {
      }
   };
 
-
-
+  /** Messages sent to several peers are shared instead of copied for every peer */
+  typedef std::shared_ptr<const message> message_ptr;
 
 } } // graphene::net
 
@@ -51,7 +51,11 @@ namespace graphene { namespace net {
        void bind(const fc::ip::endpoint& local_endpoint);
        void connect_to(const fc::ip::endpoint& remote_endpoint);
 
-       void send_message(const message& message_to_send);
+       /**
+        * @param more_to_follow true if the caller is about to send more messages, small messages are
+        *                       then held back to be written together with the following ones
+        */
+       void send_message(const message& message_to_send, bool more_to_follow = false);
        void close_connection();
        void destroy_connection();
 
@@ -312,6 +312,12 @@ namespace graphene { namespace net {
         // Send notification that mail reception was confirmed by sending user.
         void mail_send_confirm_received(const std::string mail_uuid);
 
+        // Advertise to other nodes that specified user is (or is no longer) subscribed to mail on this node.
+        void mail_set_subscribed(const std::string receiver, const bool subscribed);
+
+        // Announce mails only to nodes that advertised subscription of mail recipient, if there are any.
+        void mail_set_targeted_routing(const bool enabled);
+
         // Signal that is emitted when new mail objects are received from other nodes.
         fc::signal<void(const omnibazaar::mail_object&)> mail_new;
 
@@ -41,6 +41,7 @@
 #include <boost/multi_index/hashed_index.hpp>
 
 #include <queue>
+#include <unordered_set>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
 
@@ -68,7 +69,7 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual message_ptr get_message_for_item(const item_id& item, bool compressed) = 0;
     };
 
     class peer_connection;
@@ -123,7 +124,7 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual message_ptr get_message(peer_connection_delegate* node, bool compressed) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -131,21 +132,26 @@ namespace graphene { namespace net
         virtual ~queued_message() {}
       };
 
-      /* when you queue up a 'real_queued_message', a full copy of the message is
-       * stored on the heap until it is sent
+      /* when you queue up a 'real_queued_message', the message is stored on the heap
+       * until it is sent.  The message may be shared with the queues of other peers,
+       * it is only copied if the send time has to be patched into it
        */
       struct real_queued_message : queued_message
       {
-        message        message_to_send;
+        message_ptr    message_to_send;
         size_t         message_send_time_field_offset;
 
         real_queued_message(message message_to_send,
                             size_t message_send_time_field_offset = (size_t)-1) :
-          message_to_send(std::move(message_to_send)),
+          message_to_send(std::make_shared<message>(std::move(message_to_send))),
           message_send_time_field_offset(message_send_time_field_offset)
         {}
+        real_queued_message(message_ptr message_to_send) :
+          message_to_send(std::move(message_to_send)),
+          message_send_time_field_offset((size_t)-1)
+        {}
 
-        message get_message(peer_connection_delegate* node) override;
+        message_ptr get_message(peer_connection_delegate* node, bool compressed) override;
         size_t get_size_in_queue() override;
       };
 
@@ -161,7 +167,7 @@ namespace graphene { namespace net
           item_to_send(std::move(item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        message_ptr get_message(peer_connection_delegate* node, bool compressed) override;
         size_t get_size_in_queue() override;
       };
 
@@ -262,6 +268,13 @@ namespace graphene { namespace net
 
       uint32_t last_known_fork_block_number;
 
+      /// true if peer announces mails with mail_inventory_message instead of sending their bodies right away
+      bool supports_mail_inventory;
+      /// true if peer accepts compressed_message
+      bool supports_compression;
+      /// users subscribed to their mail on this peer, as advertised with mail_subscription_message
+      std::unordered_set<std::string> mail_subscribers;
+
       fc::future<void> accept_or_connect_task_done;
 
       firewall_check_state_data *firewall_check_state;
@@ -288,6 +301,7 @@ namespace graphene { namespace net
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      void send_message(const message_ptr& message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
@@ -56,6 +56,9 @@ namespace graphene { namespace net {
       uint64_t _bytes_received;
       uint64_t _bytes_sent;
 
+      /// padded small messages held back to be written together, reused for the life of the connection
+      std::vector<char> _send_buffer;
+
       fc::time_point _connected_time;
       fc::time_point _last_message_received_time;
       fc::time_point _last_message_sent_time;
@@ -68,6 +71,7 @@ namespace graphene { namespace net {
 
       void read_loop();
       void start_read_loop();
+      void write_send_buffer();
     public:
       fc::tcp_socket& get_socket();
       void accept();
@@ -78,7 +82,7 @@ namespace graphene { namespace net {
                                        message_oriented_connection_delegate* delegate = nullptr);
       ~message_oriented_connection_impl();
 
-      void send_message(const message& message_to_send);
+      void send_message(const message& message_to_send, bool more_to_follow);
       void close_connection();
       void destroy_connection();
 
@@ -226,7 +230,7 @@ namespace graphene { namespace net {
         throw *exception_to_rethrow;
     }
 
-    void message_oriented_connection_impl::send_message(const message& message_to_send)
+    void message_oriented_connection_impl::send_message(const message& message_to_send, bool more_to_follow)
     {
       VERIFY_CORRECT_THREAD();
 #if 0 // this gets too verbose
@@ -260,16 +264,58 @@ namespace graphene { namespace net {
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
         //pad the message we send to a multiple of 16 bytes
         size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        _sock.write(padded_message.get(), size_with_padding);
+
+        if( size_with_padding <= GRAPHENE_NET_SEND_COALESCE_BYTES )
+        {
+          // small messages are gathered and written together when nothing more is waiting to be sent
+          size_t offset = _send_buffer.size();
+          _send_buffer.resize(offset + size_with_padding);
+          memcpy(_send_buffer.data() + offset, (const char*)&message_to_send, sizeof(message_header));
+          memcpy(_send_buffer.data() + offset + sizeof(message_header), message_to_send.data.data(), message_to_send.size);
+          memset(_send_buffer.data() + offset + size_of_message_and_header, 0, size_with_padding - size_of_message_and_header);
+          if( more_to_follow && _send_buffer.size() < GRAPHENE_NET_SEND_COALESCE_BYTES )
+            return;
+          write_send_buffer();
+        }
+        else
+        {
+          // the socket takes multiples of 16 bytes, so only the first block carrying the header and the padded
+          // last block are assembled here, everything in between is written straight from the message
+          write_send_buffer();
+
+          const size_t head_data_size = 16 - sizeof(message_header);
+          char head[16];
+          memcpy(head, (const char*)&message_to_send, sizeof(message_header));
+          memcpy(head + sizeof(message_header), message_to_send.data.data(), head_data_size);
+          _sock.write(head, sizeof(head));
+
+          size_t body_size = (message_to_send.size - head_data_size) & ~size_t(15);
+          if( body_size )
+            _sock.write(message_to_send.data.data() + head_data_size, body_size);
+
+          size_t tail_offset = head_data_size + body_size;
+          if( tail_offset < message_to_send.size )
+          {
+            char tail[16] = {0};
+            memcpy(tail, message_to_send.data.data() + tail_offset, message_to_send.size - tail_offset);
+            _sock.write(tail, sizeof(tail));
+          }
+          _bytes_sent += size_with_padding;
+        }
         _sock.flush();
-        _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" );
     }
 
+    void message_oriented_connection_impl::write_send_buffer()
+    {
+      if( _send_buffer.empty() )
+        return;
+      _sock.write(_send_buffer.data(), _send_buffer.size());
+      _bytes_sent += _send_buffer.size();
+      _send_buffer.clear();
+    }
+
     void message_oriented_connection_impl::close_connection()
     {
       VERIFY_CORRECT_THREAD();
@@ -366,9 +412,9 @@ namespace graphene { namespace net {
     my->bind(local_endpoint);
   }
 
-  void message_oriented_connection::send_message(const message& message_to_send)
+  void message_oriented_connection::send_message(const message& message_to_send, bool more_to_follow)
   {
-    my->send_message(message_to_send);
+    my->send_message(message_to_send, more_to_follow);
   }
 
   void message_oriented_connection::close_connection()
@@ -140,7 +140,8 @@ namespace graphene { namespace net {
       struct message_info
       {
         message_hash_type message_hash;
-        message           message_body;
+        message_ptr       message_body;
+        mutable message_ptr compressed_message_body; // made when first sent to a peer which supports compression
         uint32_t          block_clock_when_received;
 
         // for network performance stats
@@ -148,7 +149,7 @@ namespace graphene { namespace net {
         fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
 
         message_info( const message_hash_type& message_hash,
-                      const message&           message_body,
+                      const message_ptr&       message_body,
                       uint32_t                 block_clock_when_received,
                       const message_propagation_data& propagation_data,
                       fc::uint160_t            message_contents_hash ) :
@@ -180,7 +181,7 @@ namespace graphene { namespace net {
       void block_accepted();
       void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
                         const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
-      message get_message( const message_hash_type& hash_of_message_to_lookup );
+      message_ptr get_shared_message( const message_hash_type& hash_of_message_to_lookup, bool compressed = false );
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
       size_t size() const { return _message_cache.size(); }
     };
@@ -199,18 +200,24 @@ namespace graphene { namespace net {
                                                      const fc::uint160_t& message_content_hash )
     {
       _message_cache.insert( message_info(hash_of_message_to_cache,
-                                         message_to_cache,
+                                         std::make_shared<message>(message_to_cache),
                                          block_clock,
                                          propagation_data,
                                          message_content_hash ) );
     }
 
-    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
+    message_ptr blockchain_tied_message_cache::get_shared_message( const message_hash_type& hash_of_message_to_lookup, bool compressed )
     {
       message_cache_container::index<message_hash_index>::type::const_iterator iter =
          _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
       if( iter != _message_cache.get<message_hash_index>().end() )
-        return iter->message_body;
+      {
+        if( !compressed )
+          return iter->message_body;
+        if( !iter->compressed_message_body )
+          iter->compressed_message_body = compress_message( iter->message_body );
+        return iter->compressed_message_body;
+      }
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
@@ -1029,6 +1036,9 @@ namespace graphene { namespace net { namespace detail {
                            offsetof(current_time_request_message, request_sent_time));
       peers_to_send_keep_alive.clear();
 
+      if (_mail_sender)
+        _mail_sender->check_requests();
+
       if (!_node_is_shutting_down && !_terminate_inactive_connections_loop_done.canceled())
          _terminate_inactive_connections_loop_done = fc::schedule( [this](){ terminate_inactive_connections_loop(); },
                                                                    fc::time_point::now() + fc::seconds(GRAPHENE_NET_PEER_HANDSHAKE_INACTIVITY_TIMEOUT / 2),
@@ -1381,6 +1391,15 @@ namespace graphene { namespace net { namespace detail {
       case core_message_type_enum::mail_confirm_received_message_type:
           on_mail_confirm_received_message(originating_peer, received_message.as<mail_confirm_received_message>());
           break;
+      case core_message_type_enum::mail_inventory_message_type:
+          on_mail_inventory_message(originating_peer, received_message.as<mail_inventory_message>());
+          break;
+      case core_message_type_enum::mail_fetch_message_type:
+          on_mail_fetch_message(originating_peer, received_message.as<mail_fetch_message>());
+          break;
+      case core_message_type_enum::mail_subscription_message_type:
+          on_mail_subscription_message(originating_peer, received_message.as<mail_subscription_message>());
+          break;
 
       default:
         // ignore any message in between core_message_type_first and _last that we don't handle above
@@ -1415,6 +1434,8 @@ namespace graphene { namespace net { namespace detail {
       user_data["bitness"] = sizeof(void*) * 8;
 
       user_data["node_id"] = _node_id;
+      user_data["mail_inventory"] = true;
+      user_data["compression"] = "zlib";
 
       item_hash_t head_block_id = _delegate->get_head_block_id();
       user_data["last_known_block_hash"] = head_block_id;
@@ -1446,26 +1467,56 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->node_id = user_data["node_id"].as<node_id_t>();
       if (user_data.contains("last_known_fork_block_number"))
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>();
+      if (user_data.contains("mail_inventory"))
+        originating_peer->supports_mail_inventory = user_data["mail_inventory"].as_bool();
+      originating_peer->supports_compression = peer_supports_compression(user_data);
     }
 
     void node_impl::on_mail_message(peer_connection* originating_peer, const mail_message& mail_message_received)
     {
         VERIFY_CORRECT_THREAD();
+        if (_mail_sender && !_mail_sender->on_mail(mail_message_received.mail))
+            return;
         _parent.mail_new(mail_message_received.mail);
     }
 
     void node_impl::on_mail_received_message(peer_connection* originating_peer, const mail_received_message& mail_message_received)
     {
         VERIFY_CORRECT_THREAD();
+        if (_mail_sender && !_mail_sender->on_received(mail_message_received.mail_uuid))
+            return;
         _parent.mail_received(mail_message_received.mail_uuid);
     }
 
     void node_impl::on_mail_confirm_received_message(peer_connection* originating_peer, const mail_confirm_received_message& mail_message_received)
     {
         VERIFY_CORRECT_THREAD();
+        if (_mail_sender && !_mail_sender->on_confirm_received(mail_message_received.mail_uuid))
+            return;
         _parent.mail_confirm_received(mail_message_received.mail_uuid);
     }
 
+    void node_impl::on_mail_inventory_message(peer_connection* originating_peer, const mail_inventory_message& mail_message_received)
+    {
+        VERIFY_CORRECT_THREAD();
+        if (_mail_sender)
+            _mail_sender->on_inventory(originating_peer, mail_message_received);
+    }
+
+    void node_impl::on_mail_fetch_message(peer_connection* originating_peer, const mail_fetch_message& mail_message_received)
+    {
+        VERIFY_CORRECT_THREAD();
+        if (_mail_sender)
+            _mail_sender->on_fetch(originating_peer, mail_message_received);
+    }
+
+    void node_impl::on_mail_subscription_message(peer_connection* originating_peer, const mail_subscription_message& mail_message_received)
+    {
+        VERIFY_CORRECT_THREAD();
+        if (_mail_sender)
+            _mail_sender->on_subscription(originating_peer, mail_message_received);
+    }
+
     void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
     {
       VERIFY_CORRECT_THREAD();
@@ -2324,21 +2375,25 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    message_ptr node_impl::get_message_for_item(const item_id& item, bool compressed)
     {
       try
       {
-        return _message_cache.get_message(item.item_hash);
+        // every peer the item goes to shares the cached copy
+        return _message_cache.get_shared_message(item.item_hash, compressed);
       }
       catch (fc::key_not_found_exception&)
       {}
       try
       {
-        return _delegate->get_item(item);
+        message_ptr item_message = std::make_shared<message>(_delegate->get_item(item));
+        if (compressed)
+          return compress_message(item_message);
+        return item_message;
       }
       catch (fc::key_not_found_exception&)
       {}
-      return item_not_available_message(item);
+      return std::make_shared<message>(item_not_available_message(item));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
@@ -2349,17 +2404,17 @@ namespace graphene { namespace net { namespace detail {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      message_ptr last_block_message_sent;
 
-      std::list<message> reply_messages;
+      std::list<message_ptr> reply_messages;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
         try
         {
-          message requested_message = _message_cache.get_message(item_hash);
+          message_ptr requested_message = _message_cache.get_shared_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
+               ("id", requested_message->id()));
           reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
             last_block_message_sent = requested_message;
@@ -2373,10 +2428,10 @@ namespace graphene { namespace net { namespace detail {
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
         {
-          message requested_message = _delegate->get_item(item_to_fetch);
+          message_ptr requested_message = std::make_shared<message>(_delegate->get_item(item_to_fetch));
           dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-               ("id", requested_message.id())
-               ("size", requested_message.size)
+               ("id", requested_message->id())
+               ("size", requested_message->size)
                ("endpoint", originating_peer->get_remote_endpoint()));
           reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
@@ -2385,7 +2440,7 @@ namespace graphene { namespace net { namespace detail {
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(std::make_shared<message>(item_not_available_message(item_to_fetch)));
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
@@ -2399,10 +2454,10 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
       }
 
-      for (const message& reply : reply_messages)
+      for (const message_ptr& reply : reply_messages)
       {
-        if (reply.msg_type == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply->msg_type == block_message_type)
+          originating_peer->send_item(item_id(block_message_type, reply->as<graphene::net::block_message>().block_id));
         else
           originating_peer->send_message(reply);
       }
@@ -2584,6 +2639,9 @@ namespace graphene { namespace net { namespace detail {
 
       ilog("Remote peer ${endpoint} closed their connection to us", ("endpoint", originating_peer->get_remote_endpoint()));
       display_current_connections();
+      // request mails which this peer was supposed to send from other peers
+      if (_mail_sender)
+        _mail_sender->check_requests();
       trigger_p2p_network_connect_loop();
 
       // notify the node delegate so it can update the display
@@ -3551,6 +3609,8 @@ namespace graphene { namespace net { namespace detail {
       peer->send_message(current_time_request_message(),
                          offsetof(current_time_request_message, request_sent_time));
       start_synchronizing_with_peer( peer );
+      if( _mail_sender )
+        _mail_sender->on_peer_connected( peer );
       if( _active_connections.size() != _last_reported_number_of_connections )
       {
         _last_reported_number_of_connections = (uint32_t)_active_connections.size();
@@ -4814,6 +4874,20 @@ namespace graphene { namespace net { namespace detail {
             _mail_sender->send_confirm_received(mail_uuid);
     }
 
+    void node_impl::mail_set_subscribed(const std::string receiver, const bool subscribed)
+    {
+        VERIFY_CORRECT_THREAD();
+        if (_mail_sender)
+            _mail_sender->set_subscribed(receiver, subscribed);
+    }
+
+    void node_impl::mail_set_targeted_routing(const bool enabled)
+    {
+        VERIFY_CORRECT_THREAD();
+        if (_mail_sender)
+            _mail_sender->set_targeted_routing(enabled);
+    }
+
   }  // end namespace detail
 
 
@@ -5005,6 +5079,16 @@ namespace graphene { namespace net { namespace detail {
       INVOKE_IN_IMPL(mail_send_confirm_received, mail_uuid);
   }
 
+  void node::mail_set_subscribed(const std::string receiver, const bool subscribed)
+  {
+      INVOKE_IN_IMPL(mail_set_subscribed, receiver, subscribed);
+  }
+
+  void node::mail_set_targeted_routing(const bool enabled)
+  {
+      INVOKE_IN_IMPL(mail_set_targeted_routing, enabled);
+  }
+
   struct simulated_network::node_info
   {
     node_delegate* delegate;
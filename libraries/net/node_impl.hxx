@@ -447,6 +447,12 @@ class node_impl : public peer_connection_delegate
                                     const mail_received_message& mail_message_received);
       void on_mail_confirm_received_message(peer_connection* originating_peer,
                                             const mail_confirm_received_message& mail_message_received);
+      void on_mail_inventory_message(peer_connection* originating_peer,
+                                     const mail_inventory_message& mail_message_received);
+      void on_mail_fetch_message(peer_connection* originating_peer,
+                                 const mail_fetch_message& mail_message_received);
+      void on_mail_subscription_message(peer_connection* originating_peer,
+                                        const mail_subscription_message& mail_message_received);
 
       void on_connection_closed(peer_connection* originating_peer) override;
 
@@ -521,7 +527,7 @@ class node_impl : public peer_connection_delegate
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      message_ptr                get_message_for_item(const item_id& item, bool compressed) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
@@ -534,6 +540,8 @@ class node_impl : public peer_connection_delegate
       void mail_send(const omnibazaar::mail_object& mail_object);
       void mail_send_received(const std::string mail_uuid);
       void mail_send_confirm_received(const std::string mail_uuid);
+      void mail_set_subscribed(const std::string receiver, const bool subscribed);
+      void mail_set_targeted_routing(const bool enabled);
       // </OmniBazaar methods>
 
     }; // end class node_impl
@@ -1,6 +1,15 @@
 #include <mail_sender.hpp>
 #include <omnibazaar_util.hpp>
 
+#include <algorithm>
+
+// How long mail bodies are kept for peers to fetch them after announcement.
+static const fc::microseconds OUTGOING_MAIL_EXPIRATION = fc::minutes(15);
+// How long repeated mails and notifications are ignored after they were received.
+static const fc::microseconds SEEN_MAIL_EXPIRATION = fc::minutes(2);
+// How long to wait for requested mail before requesting it from another peer that announced it.
+static const fc::microseconds MAIL_REQUEST_TIMEOUT = fc::seconds(10);
+
 omnibazaar::mail_sender::mail_sender(const graphene::net::detail::concurrent_unordered_set<graphene::net::peer_connection_ptr> &active_peer_connections)
     : _active_peer_connections_ptr(active_peer_connections)
 {
@@ -10,32 +19,235 @@ omnibazaar::mail_sender::~mail_sender()
 {
 }
 
+std::vector<graphene::net::peer_connection_ptr> omnibazaar::mail_sender::get_peers()const
+{
+    // Copy peers so that messages are not sent while holding the lock.
+    const fc::scoped_lock<fc::mutex> lock(_active_peer_connections_ptr.get_mutex());
+    return std::vector<graphene::net::peer_connection_ptr>(_active_peer_connections_ptr.begin(), _active_peer_connections_ptr.end());
+}
+
 void omnibazaar::mail_sender::send(const omnibazaar::mail_object& mail)
 {
     mail_ddump((mail));
-    const fc::scoped_lock<fc::mutex> lock(_active_peer_connections_ptr.get_mutex());
-    for (const graphene::net::peer_connection_ptr& peer : _active_peer_connections_ptr)
+    remove_expired();
+
+    // Keep mail body until peers had a chance to fetch it.
+    const fc::time_point expiration = fc::time_point::now() + OUTGOING_MAIL_EXPIRATION;
+    _outgoing[mail.uuid] = std::make_pair(mail, expiration);
+    _outgoing_expiration.emplace_back(expiration, mail.uuid);
+
+    const std::vector<graphene::net::peer_connection_ptr> peers = get_peers();
+    bool has_subscribed_peer = false;
+    if(_targeted_routing)
     {
-        peer->send_message(graphene::net::mail_message(mail));
+        for(const graphene::net::peer_connection_ptr& peer : peers)
+        {
+            if(peer->mail_subscribers.find(mail.recipient) != peer->mail_subscribers.end())
+            {
+                has_subscribed_peer = true;
+                break;
+            }
+        }
+    }
+
+    for(const graphene::net::peer_connection_ptr& peer : peers)
+    {
+        if(has_subscribed_peer && peer->mail_subscribers.find(mail.recipient) == peer->mail_subscribers.end())
+            continue;
+
+        if(peer->supports_mail_inventory)
+            send_message(*peer, graphene::net::mail_inventory_message(mail.uuid, mail.recipient));
+        else
+            send_message(*peer, graphene::net::mail_message(mail));
     }
 }
 
 void omnibazaar::mail_sender::send_received(const std::string mail_uuid)
 {
     mail_ddump((mail_uuid));
-    const fc::scoped_lock<fc::mutex> lock(_active_peer_connections_ptr.get_mutex());
-    for (const graphene::net::peer_connection_ptr& peer : _active_peer_connections_ptr)
+    for (const graphene::net::peer_connection_ptr& peer : get_peers())
     {
-        peer->send_message(graphene::net::mail_received_message(mail_uuid));
+        send_message(*peer, graphene::net::mail_received_message(mail_uuid));
     }
 }
 
 void omnibazaar::mail_sender::send_confirm_received(const std::string mail_uuid)
 {
     mail_ddump((mail_uuid));
-    const fc::scoped_lock<fc::mutex> lock(_active_peer_connections_ptr.get_mutex());
-    for (const graphene::net::peer_connection_ptr& peer : _active_peer_connections_ptr)
+    _outgoing.erase(mail_uuid);
+    for (const graphene::net::peer_connection_ptr& peer : get_peers())
+    {
+        send_message(*peer, graphene::net::mail_confirm_received_message(mail_uuid));
+    }
+}
+
+void omnibazaar::mail_sender::set_subscribed(const std::string& receiver, const bool subscribed)
+{
+    mail_ddump((receiver)(subscribed));
+
+    if(subscribed ? !_subscribers.insert(receiver).second : _subscribers.erase(receiver) == 0)
+        return;
+
+    graphene::net::mail_subscription_message msg;
+    (subscribed ? msg.subscribed : msg.unsubscribed).push_back(receiver);
+    for (const graphene::net::peer_connection_ptr& peer : get_peers())
+    {
+        send_message(*peer, msg);
+    }
+}
+
+void omnibazaar::mail_sender::on_peer_connected(const graphene::net::peer_connection_ptr& peer)
+{
+    if(_subscribers.empty())
+        return;
+
+    send_message(*peer, graphene::net::mail_subscription_message(
+                           std::vector<std::string>(_subscribers.begin(), _subscribers.end()), std::vector<std::string>()));
+}
+
+void omnibazaar::mail_sender::send_message(graphene::net::peer_connection& peer, const graphene::net::message& msg)
+{
+    peer.send_message(msg);
+}
+
+bool omnibazaar::mail_sender::on_mail(const mail_object& mail)
+{
+    // Mails requested after announcement are already marked as seen.
+    if(_requests.erase(mail.uuid) > 0)
+        return true;
+
+    return mark_seen("m" + mail.uuid);
+}
+
+bool omnibazaar::mail_sender::on_received(const std::string& mail_uuid)
+{
+    return mark_seen("r" + mail_uuid);
+}
+
+bool omnibazaar::mail_sender::on_confirm_received(const std::string& mail_uuid)
+{
+    return mark_seen("c" + mail_uuid);
+}
+
+void omnibazaar::mail_sender::on_inventory(graphene::net::peer_connection* peer, const graphene::net::mail_inventory_message& msg)
+{
+    // Nobody on this node would get the mail, so don't fetch it until recipient subscribes.
+    if(_subscribers.find(msg.recipient) == _subscribers.end())
+        return;
+
+    check_requests();
+    const auto itr = _requests.find(msg.mail_uuid);
+    if(itr != _requests.end())
+    {
+        // Mail is already requested, ask this peer if the first one fails to send it.
+        itr->second.announcers.push_back(peer->shared_from_this());
+        return;
+    }
+
+    // Mail is marked as seen when requested, so that it's not requested again from other peers announcing it.
+    if(!mark_seen("m" + msg.mail_uuid))
+        return;
+
+    mail_ddump((msg.mail_uuid)(msg.recipient));
+    request_mail(msg.mail_uuid, _requests[msg.mail_uuid], peer->shared_from_this());
+}
+
+void omnibazaar::mail_sender::request_mail(const std::string& mail_uuid, mail_request& request,
+                                           const graphene::net::peer_connection_ptr& peer)
+{
+    request.peer = peer;
+    request.deadline = fc::time_point::now() + MAIL_REQUEST_TIMEOUT;
+    send_message(*peer, graphene::net::mail_fetch_message(mail_uuid));
+}
+
+void omnibazaar::mail_sender::check_requests(const fc::time_point& now)
+{
+    if(_requests.empty())
+        return;
+
+    const std::vector<graphene::net::peer_connection_ptr> peers = get_peers();
+    for(auto itr = _requests.begin(); itr != _requests.end(); )
+    {
+        const graphene::net::peer_connection_ptr peer = itr->second.peer.lock();
+        if(itr->second.deadline <= now || !peer || std::find(peers.begin(), peers.end(), peer) == peers.end())
+            itr = retry_request(itr, peers);
+        else
+            ++itr;
+    }
+}
+
+omnibazaar::mail_sender::request_iterator omnibazaar::mail_sender::retry_request(
+        request_iterator itr, const std::vector<graphene::net::peer_connection_ptr>& peers)
+{
+    mail_request& request = itr->second;
+    while(!request.announcers.empty())
+    {
+        const graphene::net::peer_connection_ptr peer = request.announcers.front().lock();
+        request.announcers.pop_front();
+        if(peer && std::find(peers.begin(), peers.end(), peer) != peers.end())
+        {
+            mail_dlog("Requesting mail ${uuid} from another peer.", ("uuid", itr->first));
+            request_mail(itr->first, request, peer);
+            return ++itr;
+        }
+    }
+
+    // No other peer announced the mail, so accept it from the next one that does.
+    mail_dlog("Mail ${uuid} was not received from any peer.", ("uuid", itr->first));
+    _seen.erase("m" + itr->first);
+    return _requests.erase(itr);
+}
+
+void omnibazaar::mail_sender::on_fetch(graphene::net::peer_connection* peer, const graphene::net::mail_fetch_message& msg)
+{
+    const auto itr = _outgoing.find(msg.mail_uuid);
+    if(itr == _outgoing.end())
+    {
+        mail_dlog("Mail ${uuid} requested by peer is not available.", ("uuid", msg.mail_uuid));
+        return;
+    }
+
+    send_message(*peer, graphene::net::mail_message(itr->second.first));
+}
+
+void omnibazaar::mail_sender::on_subscription(graphene::net::peer_connection* peer, const graphene::net::mail_subscription_message& msg)
+{
+    peer->mail_subscribers.insert(msg.subscribed.begin(), msg.subscribed.end());
+    for(const std::string& receiver : msg.unsubscribed)
+        peer->mail_subscribers.erase(receiver);
+}
+
+bool omnibazaar::mail_sender::mark_seen(const std::string& key)
+{
+    remove_expired();
+
+    const fc::time_point expiration = fc::time_point::now() + SEEN_MAIL_EXPIRATION;
+    if(!_seen.emplace(key, expiration).second)
+    {
+        mail_dlog("Ignoring repeated mail message ${key}.", ("key", key));
+        return false;
+    }
+    _seen_expiration.emplace_back(expiration, key);
+    return true;
+}
+
+void omnibazaar::mail_sender::remove_expired()
+{
+    const fc::time_point now = fc::time_point::now();
+    while(!_seen_expiration.empty() && _seen_expiration.front().first <= now)
+    {
+        // Key could be forgotten and seen again after this expiration was queued.
+        const auto itr = _seen.find(_seen_expiration.front().second);
+        if(itr != _seen.end() && itr->second <= now)
+            _seen.erase(itr);
+        _seen_expiration.pop_front();
+    }
+    while(!_outgoing_expiration.empty() && _outgoing_expiration.front().first <= now)
     {
-        peer->send_message(graphene::net::mail_confirm_received_message(mail_uuid));
+        // Mail could be sent again after this expiration was queued.
+        const auto itr = _outgoing.find(_outgoing_expiration.front().second);
+        if(itr != _outgoing.end() && itr->second.second <= now)
+            _outgoing.erase(itr);
+        _outgoing_expiration.pop_front();
     }
 }
@@ -3,23 +3,31 @@
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_connection.hpp>
 #include <graphene/net/concurrent_unordered_set.hpp>
+#include <graphene/net/core_messages.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 #include <mail_object.hpp>
 
 #include <fc/filesystem.hpp>
 
+#include <deque>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace omnibazaar {
 
     // Class for managing mail p2p communication.
     // No thread sync is required provided it is called only by graphene::net::node.
+    //
+    // Mails are announced to peers by UUID and recipient, and peers request mail body only if recipient
+    // is subscribed on them and they did not receive this mail recently. Peers which don't support announcements
+    // get mail bodies right away. Optionally, mails are announced only to peers that advertised subscription
+    // of the recipient.
 	class mail_sender {
 
 	public:
         mail_sender(const graphene::net::detail::concurrent_unordered_set<graphene::net::peer_connection_ptr>& active_peer_connections);
-		~mail_sender();
+		virtual ~mail_sender();
 
         // Send specified mail object to other nodes.
         void send(const mail_object& mail);
@@ -29,8 +37,62 @@ namespace omnibazaar {
 
         // Send notification that mail reception was confirmed by sending user.
         void send_confirm_received(const std::string mail_uuid);
-	
+
+        // Advertise to peers that specified user is (or is no longer) subscribed to mail on this node.
+        void set_subscribed(const std::string& receiver, const bool subscribed);
+
+        // Send mails only to peers that advertised subscription of their recipient, if there are any.
+        void set_targeted_routing(const bool enabled) { _targeted_routing = enabled; }
+
+        // Advertise current subscriptions to newly connected peer.
+        void on_peer_connected(const graphene::net::peer_connection_ptr& peer);
+
+        // Handlers of incoming mail messages. Those which return bool return false for duplicate messages
+        // that were already received recently and should be ignored.
+        bool on_mail(const mail_object& mail);
+        bool on_received(const std::string& mail_uuid);
+        bool on_confirm_received(const std::string& mail_uuid);
+        void on_inventory(graphene::net::peer_connection* peer, const graphene::net::mail_inventory_message& msg);
+        void on_fetch(graphene::net::peer_connection* peer, const graphene::net::mail_fetch_message& msg);
+        void on_subscription(graphene::net::peer_connection* peer, const graphene::net::mail_subscription_message& msg);
+
+        // Request mails from the next peer that announced them if the peer they were requested from
+        // did not send them in time or disconnected.
+        void check_requests(const fc::time_point& now = fc::time_point::now());
+
+    protected:
+        virtual void send_message(graphene::net::peer_connection& peer, const graphene::net::message& msg);
+
 	private:
+        // Mail requested from a peer after announcement, with other peers that announced it in the meantime.
+        struct mail_request
+        {
+            std::weak_ptr<graphene::net::peer_connection> peer;
+            fc::time_point deadline;
+            std::deque<std::weak_ptr<graphene::net::peer_connection>> announcers;
+        };
+        typedef std::unordered_map<std::string, mail_request>::iterator request_iterator;
+
+        std::vector<graphene::net::peer_connection_ptr> get_peers()const;
+        // Remember specified key as seen. Returns false if it was already seen and has not expired yet.
+        bool mark_seen(const std::string& key);
+        void remove_expired();
+        void request_mail(const std::string& mail_uuid, mail_request& request, const graphene::net::peer_connection_ptr& peer);
+        // Request mail from the next announcing peer that is still connected, or forget the request if there is none.
+        request_iterator retry_request(request_iterator itr, const std::vector<graphene::net::peer_connection_ptr>& peers);
+
         const graphene::net::detail::concurrent_unordered_set<graphene::net::peer_connection_ptr>& _active_peer_connections_ptr;
+
+        // Recently sent mails that peers may request, with their expiration time.
+        std::unordered_map<std::string, std::pair<mail_object, fc::time_point>> _outgoing;
+        std::deque<std::pair<fc::time_point, std::string>> _outgoing_expiration;
+        // Recently received mails and notifications with their expiration time, and expiration queue.
+        std::unordered_map<std::string, fc::time_point> _seen;
+        std::deque<std::pair<fc::time_point, std::string>> _seen_expiration;
+        // Mails requested from peers after announcement, which are accepted although already marked as seen.
+        std::unordered_map<std::string, mail_request> _requests;
+        // Users subscribed to mail on this node.
+        std::unordered_set<std::string> _subscribers;
+        bool _targeted_routing = false;
 	};
 }
@@ -5,9 +5,80 @@
 #include <fc/reflect/variant.hpp>
 #include <fc/thread/scoped_lock.hpp>
 #include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/crypto/city.hpp>
+#include <fc/optional.hpp>
+
+namespace omnibazaar { namespace detail {
+
+    // Types of records in mail log.
+    enum mail_record_type
+    {
+        // New mail, contains mail body.
+        mail_stored = 0,
+        // Mail was delivered to receiver.
+        mail_delivered = 1,
+        // Mail was confirmed by sender and is no longer needed.
+        mail_removed = 2
+    };
+
+    // Header at the beginning of mail log file.
+    struct mail_log_header
+    {
+        uint64_t magic = 0;
+        uint64_t id = 0;
+    };
+
+    // Header of every record in mail log, followed by packed mail_log_record.
+    struct mail_record_header
+    {
+        uint32_t size = 0;
+        uint64_t checksum = 0;
+    };
+
+    struct mail_log_record
+    {
+        uint8_t type = mail_stored;
+        std::string uuid;
+        fc::optional<mail_object> mail;
+    };
+
+    struct mail_index_entry
+    {
+        std::string uuid;
+        std::string receiver;
+        bool is_delivered = false;
+        uint64_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // Contents of index file, valid for log with specified ID up to specified size.
+    struct mail_index
+    {
+        uint64_t log_id = 0;
+        uint64_t log_size = 0;
+        std::vector<mail_index_entry> entries;
+    };
+
+} }
+
+FC_REFLECT( omnibazaar::detail::mail_log_header, (magic)(id) )
+FC_REFLECT( omnibazaar::detail::mail_record_header, (size)(checksum) )
+FC_REFLECT( omnibazaar::detail::mail_log_record, (type)(uuid)(mail) )
+FC_REFLECT( omnibazaar::detail::mail_index_entry, (uuid)(receiver)(is_delivered)(offset)(size) )
+FC_REFLECT( omnibazaar::detail::mail_index, (log_id)(log_size)(entries) )
+
+static const std::string LOG_FILE_NAME("mails.log");
+static const std::string INDEX_FILE_NAME("mails.index");
+static const uint64_t LOG_MAGIC = 0x474f4c4c49414d4f; // "OMAILLOG"
+static const uint64_t LOG_HEADER_SIZE = 16;
+static const uint64_t RECORD_HEADER_SIZE = 12;
+// Log is not compacted until it wastes at least this many bytes.
+static const uint64_t MIN_COMPACTION_SIZE = 16 * 1024 * 1024;
 
 static const std::string DELIVERED_STR("delivered");
 static const std::string UNDELIVERED_STR("undelivered");
+// Folders used by previous versions, which stored every mail in a separate file.
 // One folder is for storing mail that was sent but not yet flagged as received,
 // another folder is for storing mail for which sender did not yet get delivery notification.
 static const std::pair<std::string, bool> MAIL_FOLDERS[2] = {
@@ -17,6 +88,8 @@ static const std::pair<std::string, bool> MAIL_FOLDERS[2] = {
 
 namespace omnibazaar {
 
+    using namespace detail;
+
     mail_storage::mail_storage(const fc::path& parent_dir)
     {
         mail_ddump((parent_dir));
@@ -24,6 +97,19 @@ namespace omnibazaar {
         set_dir(parent_dir);
     }
 
+    mail_storage::~mail_storage()
+    {
+        try
+        {
+            const fc::scoped_lock<fc::mutex> lock(_mutex);
+            close();
+        }
+        catch(const fc::exception& e)
+        {
+            mail_elog("Error closing mail storage: ${e}", ("e", e.to_detail_string()));
+        }
+    }
+
     void mail_storage::set_dir(const fc::path& parent_dir)
     {
         mail_ddump((parent_dir));
@@ -33,12 +119,22 @@ namespace omnibazaar {
 
         mail_ilog("Changing mail directory from '${olddir}' to '${newdir}'.", ("olddir", _parent_dir)("newdir", parent_dir));
 
+        close();
         _parent_dir = parent_dir;
 
         // Since root directory is now changed, need to reload the cache.
         reload_cache();
     }
 
+    void mail_storage::close()
+    {
+        if(!_log.is_open())
+            return;
+
+        save_index();
+        _log.close();
+    }
+
     void mail_storage::reload_cache()
     {
         mail_ddump((""));
@@ -46,42 +142,398 @@ namespace omnibazaar {
         // Clear cache.
         _cache_by_uuid.clear();
         _cache_by_receiver.clear();
+        _log_id = 0;
+        _log_size = 0;
+        _live_size = 0;
 
-        if(!fc::exists(_parent_dir) || !fc::is_directory(_parent_dir))
+        if(_parent_dir.string().empty())
         {
-            mail_wlog("Mail parent directory '${dir}' does not exist or is not a directory.", ("dir", _parent_dir));
+            mail_wlog("Mail parent directory is empty, unable to load mails.");
             return;
         }
 
+        if(fc::exists(_parent_dir) && !fc::is_directory(_parent_dir))
+        {
+            mail_wlog("Mail parent directory '${dir}' is not a directory.", ("dir", _parent_dir));
+            return;
+        }
+        fc::create_directories(_parent_dir);
+
+        const fc::path log_path = _parent_dir / LOG_FILE_NAME;
+        if(fc::exists(log_path))
+        {
+            std::ifstream in(log_path.generic_string(), std::ios::binary);
+            std::vector<char> data(LOG_HEADER_SIZE);
+            in.read(data.data(), data.size());
+            const mail_log_header header = in ? fc::raw::unpack<mail_log_header>(data) : mail_log_header();
+            if(header.magic == LOG_MAGIC)
+            {
+                _log_id = header.id;
+            }
+            else
+            {
+                mail_elog("Mail log '${path}' is corrupted, moving it aside and starting a new one.", ("path", log_path));
+                fc::rename(log_path, _parent_dir / (LOG_FILE_NAME + ".corrupted"));
+            }
+        }
+
+        if(_log_id == 0)
+        {
+            // Use current time as log ID so that index of some old log is never mistaken for index of this one.
+            mail_log_header header;
+            header.magic = LOG_MAGIC;
+            header.id = fc::time_point::now().time_since_epoch().count();
+            const std::vector<char> data = fc::raw::pack(header);
+            std::ofstream out(log_path.generic_string(), std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size());
+            out.close();
+            FC_ASSERT(out, "Unable to create mail log '${path}'.", ("path", log_path));
+            _log_id = header.id;
+        }
+
+        _log.open(log_path.generic_string(), std::ios::in | std::ios::out | std::ios::binary);
+        FC_ASSERT(_log.is_open(), "Unable to open mail log '${path}'.", ("path", log_path));
+
+        replay_log(load_index());
+        import_legacy_mails();
+        mail_ilog("Loaded ${n} mails from '${path}'.", ("n", _cache_by_uuid.size())("path", log_path));
+
+        compact_if_needed();
+    }
+
+    uint64_t mail_storage::load_index()
+    {
+        const fc::path index_path = _parent_dir / INDEX_FILE_NAME;
+        if(!fc::exists(index_path))
+            return LOG_HEADER_SIZE;
+
+        try
+        {
+            std::vector<char> data(fc::file_size(index_path));
+            std::ifstream in(index_path.generic_string(), std::ios::binary);
+            in.read(data.data(), data.size());
+            FC_ASSERT(in, "Unable to read mail index.");
+            const mail_index index = fc::raw::unpack<mail_index>(data);
+
+            if(index.log_id != _log_id || index.log_size > fc::file_size(_parent_dir / LOG_FILE_NAME))
+            {
+                mail_wlog("Mail index does not match mail log, rebuilding it.");
+                return LOG_HEADER_SIZE;
+            }
+
+            for(const mail_index_entry& entry : index.entries)
+            {
+                _cache_by_uuid[entry.uuid] = mail_info(entry.receiver, entry.is_delivered, entry.offset, entry.size);
+                if(!entry.is_delivered)
+                    _cache_by_receiver.insert( {entry.receiver, entry.uuid} );
+                _live_size += entry.size;
+            }
+            return index.log_size;
+        }
+        catch(const fc::exception& e)
+        {
+            mail_wlog("Unable to load mail index, rebuilding it: ${e}", ("e", e.to_detail_string()));
+            _cache_by_uuid.clear();
+            _cache_by_receiver.clear();
+            _live_size = 0;
+            return LOG_HEADER_SIZE;
+        }
+    }
+
+    void mail_storage::save_index()const
+    {
+        mail_index index;
+        index.log_id = _log_id;
+        index.log_size = _log_size;
+        index.entries.reserve(_cache_by_uuid.size());
+        for(const auto& itr : _cache_by_uuid)
+        {
+            mail_index_entry entry;
+            entry.uuid = itr.first;
+            entry.receiver = itr.second.receiver;
+            entry.is_delivered = itr.second.is_delivered;
+            entry.offset = itr.second.offset;
+            entry.size = itr.second.size;
+            index.entries.push_back(std::move(entry));
+        }
+
+        // Write to temporary file first so that crash never leaves a partially written index.
+        const fc::path index_path = _parent_dir / INDEX_FILE_NAME;
+        const fc::path tmp_path = _parent_dir / (INDEX_FILE_NAME + ".tmp");
+        const std::vector<char> data = fc::raw::pack(index);
+        std::ofstream out(tmp_path.generic_string(), std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+        out.close();
+        if(!out)
+        {
+            mail_elog("Unable to write mail index to '${path}'.", ("path", tmp_path));
+            return;
+        }
+        fc::rename(tmp_path, index_path);
+    }
+
+    void mail_storage::replay_log(uint64_t position)
+    {
+        const fc::path log_path = _parent_dir / LOG_FILE_NAME;
+        const uint64_t file_size = fc::file_size(log_path);
+
+        _log.seekg(position);
+        std::vector<char> data;
+        while(position + RECORD_HEADER_SIZE <= file_size)
+        {
+            data.resize(RECORD_HEADER_SIZE);
+            if(!_log.read(data.data(), data.size()))
+                break;
+            const mail_record_header header = fc::raw::unpack<mail_record_header>(data);
+            if(position + RECORD_HEADER_SIZE + header.size > file_size)
+                break;
+
+            data.resize(header.size);
+            if(!_log.read(data.data(), data.size()) || fc::city_hash64(data.data(), data.size()) != header.checksum)
+                break;
+
+            mail_log_record record;
+            try
+            {
+                record = fc::raw::unpack<mail_log_record>(data);
+            }
+            catch(const fc::exception& e)
+            {
+                mail_wlog("Unable to unpack mail record: ${e}", ("e", e.to_detail_string()));
+                break;
+            }
+
+            const uint32_t size = RECORD_HEADER_SIZE + header.size;
+            apply(record.type, record.uuid, record.mail.valid() ? record.mail->recipient : std::string(), position, size);
+            position += size;
+        }
+        _log.clear();
+
+        if(position < file_size)
+        {
+            // Most likely node was stopped while a record was being written.
+            mail_wlog("Truncating ${n} bytes of incomplete records at the end of mail log.", ("n", file_size - position));
+            _log.close();
+            fc::resize_file(log_path, position);
+            _log.open(log_path.generic_string(), std::ios::in | std::ios::out | std::ios::binary);
+            FC_ASSERT(_log.is_open(), "Unable to open mail log '${path}'.", ("path", log_path));
+        }
+        _log_size = position;
+    }
+
+    void mail_storage::import_legacy_mails()
+    {
         for(auto folder_info : MAIL_FOLDERS)
         {
             const fc::path path = _parent_dir / folder_info.first;
             if(!fc::exists(path))
-            {
-                mail_wlog("Mail folder '${path}' does not exist.", ("path", path));
                 continue;
+
+            mail_ilog("Importing mails from '${path}'.", ("path", path));
+            std::vector<fc::path> files;
+            for(fc::directory_iterator itr(path); itr != fc::directory_iterator(); ++itr)
+            {
+                if(!itr->string().empty() && fc::is_regular_file(*itr))
+                    files.push_back(*itr);
             }
 
-            // Load mail info from disk to cache.
-            for (fc::directory_iterator itr(path); itr != fc::directory_iterator(); ++itr)
+            bool imported_all = true;
+            for(const fc::path& file : files)
             {
-                mail_dlog("Loading mail from '${path}'", ("path", *itr));
-                if (!itr->string().empty() && fc::is_regular_file(*itr))
+                mail_object mail;
+                try
                 {
-                    const fc::variant var = fc::json::from_file(*itr);
-                    mail_dlog("Loaded mail variable: ${var}", ("var", var));
-                    if(!var.is_null())
-                    {
-                        const mail_object new_mail_object = var.as<mail_object>();
-                        mail_dlog("Loaded mail object: ${obj}", ("obj", new_mail_object));
-                        _cache_by_uuid[new_mail_object.uuid] = mail_info(new_mail_object.recipient, folder_info.second);
-                        _cache_by_receiver.insert( {new_mail_object.recipient, new_mail_object.uuid} );
-                    }
+                    const fc::variant var = fc::json::from_file(file);
+                    FC_ASSERT(!var.is_null(), "File is empty.");
+                    mail = var.as<mail_object>();
+                    FC_ASSERT(!mail.uuid.empty(), "Mail UUID is empty.");
                 }
+                catch(const fc::exception& e)
+                {
+                    mail_wlog("Unable to read mail from '${path}', skipping it: ${e}", ("path", file)("e", e.to_detail_string()));
+                    imported_all = false;
+                    continue;
+                }
+
+                // Legacy file is the only copy of the mail until its records are written.
+                if(!append(mail_stored, mail.uuid, &mail)
+                   || (folder_info.second && !append(mail_delivered, mail.uuid, nullptr)))
+                {
+                    imported_all = false;
+                    continue;
+                }
+                fc::remove(file);
             }
+
+            if(imported_all)
+                fc::remove_all(path);
+            else
+                mail_wlog("Some mails were not imported, leaving them in '${path}'.", ("path", path));
         }
     }
 
+    bool mail_storage::append(const uint8_t type, const std::string& uuid, const mail_object* mail)
+    {
+        mail_log_record record;
+        record.type = type;
+        record.uuid = uuid;
+        if(mail != nullptr)
+            record.mail = *mail;
+
+        const std::vector<char> data = fc::raw::pack(record);
+        mail_record_header header;
+        header.size = data.size();
+        header.checksum = fc::city_hash64(data.data(), data.size());
+        const std::vector<char> header_data = fc::raw::pack(header);
+
+        _log.seekp(_log_size);
+        _log.write(header_data.data(), header_data.size());
+        _log.write(data.data(), data.size());
+        _log.flush();
+        if(!_log)
+        {
+            // Next append will overwrite whatever was partially written.
+            mail_elog("Unable to write mail record for ${uuid}.", ("uuid", uuid));
+            _log.clear();
+            return false;
+        }
+
+        const uint32_t size = header_data.size() + data.size();
+        apply(type, uuid, mail != nullptr ? mail->recipient : std::string(), _log_size, size);
+        _log_size += size;
+        return true;
+    }
+
+    void mail_storage::apply(const uint8_t type, const std::string& uuid, const std::string& receiver,
+                             const uint64_t offset, const uint32_t size)
+    {
+        auto itr = _cache_by_uuid.find(uuid);
+        if(itr != _cache_by_uuid.end())
+        {
+            // Previous record of this mail is no longer needed.
+            _live_size -= itr->second.size;
+            if(!itr->second.is_delivered)
+                erase_from_receiver_cache(itr->second.receiver, uuid);
+        }
+
+        switch(type)
+        {
+        case mail_stored:
+            _cache_by_uuid[uuid] = mail_info(receiver, false, offset, size);
+            _cache_by_receiver.insert( {receiver, uuid} );
+            _live_size += size;
+            break;
+        case mail_delivered:
+            // Receiver is only needed to find undelivered mails.
+            _cache_by_uuid[uuid] = mail_info(std::string(), true, offset, size);
+            _live_size += size;
+            break;
+        case mail_removed:
+            if(itr != _cache_by_uuid.end())
+                _cache_by_uuid.erase(itr);
+            break;
+        default:
+            mail_wlog("Unknown mail record type ${t} for ${uuid}.", ("t", type)("uuid", uuid));
+        }
+    }
+
+    void mail_storage::erase_from_receiver_cache(const std::string& receiver, const std::string& mail_uuid)
+    {
+        typedef std::unordered_multimap<std::string, std::string>::iterator iter_type;
+        // Find all values for specified key.
+        std::pair<iter_type, iter_type> itrs = _cache_by_receiver.equal_range(receiver);
+        // Iterate through values and remove one that matches specified UUID.
+        while(itrs.first != itrs.second)
+        {
+            if((*itrs.first).second == mail_uuid)
+            {
+                _cache_by_receiver.erase(itrs.first);
+                break;
+            }
+            ++itrs.first;
+        }
+    }
+
+    mail_object mail_storage::read_mail(const mail_info& info)const
+    {
+        FC_ASSERT(!info.is_delivered && info.size > RECORD_HEADER_SIZE);
+
+        std::vector<char> data(info.size);
+        _log.seekg(info.offset);
+        if(!_log.read(data.data(), data.size()))
+        {
+            _log.clear();
+            FC_THROW("Unable to read mail record at ${pos}.", ("pos", info.offset));
+        }
+
+        const mail_record_header header = fc::raw::unpack<mail_record_header>(data);
+        const char* body = data.data() + RECORD_HEADER_SIZE;
+        FC_ASSERT(header.size == info.size - RECORD_HEADER_SIZE
+                  && fc::city_hash64(body, header.size) == header.checksum,
+                  "Mail record at ${pos} is corrupted.", ("pos", info.offset));
+
+        const mail_log_record record = fc::raw::unpack<mail_log_record>(std::vector<char>(body, body + header.size));
+        FC_ASSERT(record.mail.valid(), "Mail record at ${pos} has no mail.", ("pos", info.offset));
+        return *record.mail;
+    }
+
+    void mail_storage::compact_if_needed()
+    {
+        const uint64_t wasted_size = _log_size - LOG_HEADER_SIZE - _live_size;
+        if(wasted_size < MIN_COMPACTION_SIZE || wasted_size < _live_size)
+            return;
+
+        mail_ilog("Compacting mail log: ${live} bytes used, ${wasted} bytes wasted.", ("live", _live_size)("wasted", wasted_size));
+
+        const fc::path log_path = _parent_dir / LOG_FILE_NAME;
+        const fc::path tmp_path = _parent_dir / (LOG_FILE_NAME + ".tmp");
+
+        mail_log_header header;
+        header.magic = LOG_MAGIC;
+        header.id = _log_id + 1;
+        const std::vector<char> header_data = fc::raw::pack(header);
+
+        // Copy last record of every mail as is, delivered mails are left without body.
+        std::unordered_map<std::string, uint64_t> new_offsets;
+        new_offsets.reserve(_cache_by_uuid.size());
+        std::ofstream out(tmp_path.generic_string(), std::ios::binary | std::ios::trunc);
+        out.write(header_data.data(), header_data.size());
+        uint64_t position = header_data.size();
+        std::vector<char> data;
+        for(const auto& itr : _cache_by_uuid)
+        {
+            data.resize(itr.second.size);
+            _log.seekg(itr.second.offset);
+            if(!_log.read(data.data(), data.size()))
+            {
+                _log.clear();
+                mail_elog("Unable to read mail record at ${pos}, compaction aborted.", ("pos", itr.second.offset));
+                return;
+            }
+            out.write(data.data(), data.size());
+            new_offsets[itr.first] = position;
+            position += data.size();
+        }
+        out.close();
+        if(!out)
+        {
+            mail_elog("Unable to write compacted mail log to '${path}'.", ("path", tmp_path));
+            return;
+        }
+
+        _log.close();
+        fc::rename(tmp_path, log_path);
+        _log.open(log_path.generic_string(), std::ios::in | std::ios::out | std::ios::binary);
+        FC_ASSERT(_log.is_open(), "Unable to open mail log '${path}'.", ("path", log_path));
+
+        for(auto& itr : _cache_by_uuid)
+            itr.second.offset = new_offsets[itr.first];
+        _log_id = header.id;
+        _log_size = position;
+        _live_size = position - header_data.size();
+        save_index();
+    }
+
     void mail_storage::store(const mail_object& mail)
     {
         mail_ddump((mail));
@@ -95,19 +547,13 @@ namespace omnibazaar {
         // Thread safety.
         const fc::scoped_lock<fc::mutex> lock(_mutex);
 
-        if(_parent_dir.string().empty())
+        if(!_log.is_open())
         {
-            mail_wlog("Mail parent directory is empty, unable to save mails.");
+            mail_wlog("Mail log is not open, unable to save mails.");
             return;
         }
 
-        // Save to disk.
-        fc::create_directories(_parent_dir / UNDELIVERED_STR);
-        fc::json::save_to_file(mail, _parent_dir / UNDELIVERED_STR / mail.uuid);
-
-        // Save to cache.
-        _cache_by_uuid[mail.uuid] = mail_info(mail.recipient, false);
-        _cache_by_receiver.insert( {mail.recipient, mail.uuid} );
+        append(mail_stored, mail.uuid, &mail);
     }
 
     void mail_storage::remove(const std::string& mail_uuid)
@@ -123,44 +569,15 @@ namespace omnibazaar {
         // Thread safety.
         const fc::scoped_lock<fc::mutex> lock(_mutex);
 
-        // Remove from disk.
-        mail_dlog("Removing '${mail}' from disk.", ("mail", mail_uuid));
-        for(auto folder_info : MAIL_FOLDERS)
+        if(_cache_by_uuid.find(mail_uuid) == _cache_by_uuid.end())
         {
-            const fc::path mail_path = _parent_dir / folder_info.first / mail_uuid;
-            if(fc::exists(mail_path))
-            {
-                fc::remove(mail_path);
-            }
-            else
-            {
-                mail_wlog("Path '${path}' does not exist.", ("path", mail_path));
-            }
+            mail_wlog("Mail '${mail}' does not exist.", ("mail", mail_uuid));
+            return;
         }
 
-        // Remove from cache.
-        mail_dlog("Removing '${mail}' from cache.", ("mail", mail_uuid));
-        const auto itr = _cache_by_uuid.find(mail_uuid);
-        if(itr != _cache_by_uuid.end())
-        {
-            // Remove from receiver cache.
-            typedef std::unordered_multimap<std::string, std::string>::iterator iter_type;
-            // Find all values for specified key.
-            std::pair<iter_type, iter_type> itrs = _cache_by_receiver.equal_range(itr->second.receiver);
-            // Iterate through values and remove one that matches specified UUID.
-            while(itrs.first != itrs.second)
-            {
-                if((*itrs.first).second == mail_uuid)
-                {
-                    _cache_by_receiver.erase(itrs.first);
-                    break;
-                }
-                ++itrs.first;
-            }
-
-            // Remove from UUID cache.
-            _cache_by_uuid.erase(itr);
-        }
+        mail_dlog("Removing '${mail}'.", ("mail", mail_uuid));
+        append(mail_removed, mail_uuid, nullptr);
+        compact_if_needed();
     }
 
     std::vector<mail_object> mail_storage::get_mails_by_receiver(const std::string& receiver)const
@@ -176,35 +593,19 @@ namespace omnibazaar {
         // Thread safety.
         const fc::scoped_lock<fc::mutex> lock(_mutex);
 
-        if(!fc::exists(_parent_dir))
-        {
-            mail_wlog("Mails directory '${dir}' does not exist.", ("dir", _parent_dir));
-            return std::vector<mail_object>();
-        }
-
         // Read and return mail.
         std::vector<mail_object> mails;
         typedef std::unordered_multimap<std::string, std::string>::const_iterator iter_type;
         std::pair<iter_type, iter_type> itrs = _cache_by_receiver.equal_range(receiver);
         while(itrs.first != itrs.second)
         {
-            const fc::path mail_path = _parent_dir / UNDELIVERED_STR / (*itrs.first).second;
-            if(fc::exists(mail_path))
+            try
             {
-                const fc::variant var = fc::json::from_file(mail_path);
-                mail_ddump((var));
-                if(!var.is_null())
-                {
-                    mails.push_back(var.as<mail_object>());
-                }
-                else
-                {
-                    mail_wlog("Unable to read mail from '${path}'", ("path", mail_path));
-                }
+                mails.push_back(read_mail(_cache_by_uuid.at((*itrs.first).second)));
             }
-            else
+            catch(const fc::exception& e)
             {
-                mail_wlog("File '${path}' does not exist.", ("path", mail_path));
+                mail_wlog("Unable to read mail ${uuid}: ${e}", ("uuid", (*itrs.first).second)("e", e.to_detail_string()));
             }
 
             ++itrs.first;
@@ -225,54 +626,62 @@ namespace omnibazaar {
         // Thread safety.
         const fc::scoped_lock<fc::mutex> lock(_mutex);
 
-        if(!fc::exists(_parent_dir / UNDELIVERED_STR))
+        const auto itr = _cache_by_uuid.find(mail_uuid);
+        if(itr == _cache_by_uuid.end())
         {
-            mail_wlog("Mails directory '${path}' does not exist.", ("path", _parent_dir / UNDELIVERED_STR));
+            mail_wlog("Mail '${mail}' does not exist.", ("mail", mail_uuid));
             return;
         }
-
-        // Update value in cache.
-        mail_dlog("Updating cache.");
-        auto itr = _cache_by_uuid.find(mail_uuid);
-        if(itr != _cache_by_uuid.end())
+        if(itr->second.is_delivered)
         {
-            itr->second.is_delivered = true;
+            return;
         }
 
-        // Move mail file to delivered folder.
-        const fc::path current_mail_path = _parent_dir / UNDELIVERED_STR / mail_uuid;
-        mail_dlog("Moving file '${file}' to delivered folder '${dir}'", ("file", current_mail_path)("dir", _parent_dir / DELIVERED_STR));
-        if(fc::exists(current_mail_path))
-        {
-            const fc::path new_mail_dir = _parent_dir / DELIVERED_STR;
-            const fc::path new_mail_path = new_mail_dir / mail_uuid;
+        mail_dlog("Marking '${mail}' as delivered.", ("mail", mail_uuid));
+        append(mail_delivered, mail_uuid, nullptr);
+        compact_if_needed();
+    }
 
-            // create the delivered folder if it doesn't exist
-            if (!fc::exists(new_mail_dir))
-            {
-                mail_wlog("Directory '${dir}' does not exist, creating.", ("dir", new_mail_dir));
-                fc::create_directories(new_mail_dir);
-            }
+    fc::optional<mail_object> mail_storage::get_pending_mail(const std::string& mail_uuid)const
+    {
+        mail_ddump((mail_uuid));
+
+        // Thread safety.
+        const fc::scoped_lock<fc::mutex> lock(_mutex);
 
-            // move the mail file from the undelivered folder to the delivered folder
-            mail_dlog("Moving '${path1}' to '${path2}'", ("path1", current_mail_path)("path2", new_mail_path));
-            fc::rename(current_mail_path, new_mail_path);
+        const auto itr = _cache_by_uuid.find(mail_uuid);
+        if(itr == _cache_by_uuid.end() || itr->second.is_delivered)
+        {
+            return fc::optional<mail_object>();
+        }
+
+        try
+        {
+            return read_mail(itr->second);
         }
-        else
+        catch(const fc::exception& e)
         {
-            mail_wlog("File '${path}' does not exist.", ("path", current_mail_path));
+            mail_wlog("Unable to read mail ${uuid}: ${e}", ("uuid", mail_uuid)("e", e.to_detail_string()));
+            return fc::optional<mail_object>();
         }
     }
 
-    std::vector<fc::path> mail_storage::get_pending_mails()const
+    std::vector<std::string> mail_storage::get_pending_mails()const
     {
         mail_ddump((""));
 
         // Thread safety.
         const fc::scoped_lock<fc::mutex> lock(_mutex);
 
-        mail_dlog("Getting mails from '${dir}'", ("dir", _parent_dir / UNDELIVERED_STR));
-        return util::get_files_in_folder(_parent_dir / UNDELIVERED_STR);
+        std::vector<std::string> ids;
+        for(const auto& itr : _cache_by_uuid)
+        {
+            if(!itr.second.is_delivered)
+            {
+                ids.push_back(itr.first);
+            }
+        }
+        return ids;
     }
 
     std::vector<std::string> mail_storage::get_received_mails()const
@@ -1,26 +1,34 @@
 #pragma once
 
 #include <fc/filesystem.hpp>
+#include <fc/optional.hpp>
 #include <fc/thread/mutex.hpp>
+#include <fstream>
 #include <unordered_map>
 
 namespace omnibazaar {
     class mail_object;
 
     // Class for managing storage on disk and access to user mails. This class is thread-safe.
+    //
+    // Mails are kept in a single append-only log file. Every change (new mail, delivery, removal) is appended
+    // as a separate record, and an index of live mails by UUID and receiver is kept in memory. The index is saved
+    // to disk on shutdown, so at startup only records appended after the last save need to be read.
+    // Log is compacted when most of it is taken by bodies of delivered or removed mails.
     class mail_storage
     {
     public:
         mail_storage(const fc::path& parent_dir = fc::path());
+        ~mail_storage();
 
         // Set parent directory for mail files storage. This is usually the node config parent directory.
         // This method implicitly calls reload_cache().
         void set_dir(const fc::path& parent_dir);
 
-        // Store specified mail object to folder with undelivered mail.
+        // Store specified mail object as undelivered.
         void store(const mail_object& mail);
 
-        // Move specified mail to delivered folder.
+        // Mark specified mail as delivered.
         void set_received(const std::string& mail_uuid);
 
         // Remove mail with specified UUID from cache and disk.
@@ -29,8 +37,11 @@ namespace omnibazaar {
         // Get all pending mails for specified receiver.
         std::vector<mail_object> get_mails_by_receiver(const std::string& receiver)const;
 
-        // Get all mails that are not yet delivered to receivers.
-        std::vector<fc::path> get_pending_mails()const;
+        // Get mail with specified UUID if it is not yet delivered to receiver.
+        fc::optional<mail_object> get_pending_mail(const std::string& mail_uuid)const;
+
+        // Get UUIDs of all mails that are not yet delivered to receivers.
+        std::vector<std::string> get_pending_mails()const;
 
         // Get all mails UUIDs which are confirmed by receivers.
         std::vector<std::string> get_received_mails()const;
@@ -42,20 +53,47 @@ namespace omnibazaar {
             // Message receiver.
             std::string receiver;
             // Flag indicating that receiver notified node that message was delivered,
-            // message is now placed to "delivered" folder, and waiting for sender to get delivery notification.
+            // message body is dropped, and node is waiting for sender to get delivery notification.
             bool is_delivered;
+            // Position and size of the last log record for this mail. For undelivered mail it contains mail body.
+            uint64_t offset;
+            uint32_t size;
 
-            mail_info(const std::string& r = std::string(), const bool d = false)
-                : receiver(r), is_delivered(d)
+            mail_info(const std::string& r = std::string(), const bool d = false, const uint64_t o = 0, const uint32_t s = 0)
+                : receiver(r), is_delivered(d), offset(o), size(s)
             {}
         };
 
         // Reset and reload mail cache from disk.
         void reload_cache();
+        // Read log records starting at specified position and apply them to cache, truncating incomplete tail.
+        void replay_log(uint64_t position);
+        // Load saved index if it matches current log. Returns log position up to which index is valid.
+        uint64_t load_index();
+        void save_index()const;
+        // Move mails from directories used by previous versions into the log.
+        void import_legacy_mails();
+        void close();
+
+        // Append record to the log and apply it to cache. Returns false if record could not be written.
+        bool append(const uint8_t type, const std::string& uuid, const mail_object* mail);
+        // Update cache with a record located at specified position.
+        void apply(const uint8_t type, const std::string& uuid, const std::string& receiver,
+                   const uint64_t offset, const uint32_t size);
+        // Read mail body from the record at specified position.
+        mail_object read_mail(const mail_info& info)const;
+        void erase_from_receiver_cache(const std::string& receiver, const std::string& mail_uuid);
+        // Rewrite the log with only live records if enough space is wasted.
+        void compact_if_needed();
 
         std::unordered_map<std::string, mail_info> _cache_by_uuid;
         std::unordered_multimap<std::string, std::string> _cache_by_receiver;
         fc::path _parent_dir;
+        mutable std::fstream _log;
+        // Log identifier, changed on every compaction so that stale index is not used.
+        uint64_t _log_id = 0;
+        uint64_t _log_size = 0;
+        uint64_t _live_size = 0;
         mutable fc::mutex _mutex;
     };
 }
@@ -44,26 +44,30 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    message_ptr peer_connection::real_queued_message::get_message(peer_connection_delegate*, bool compressed)
     {
       if (message_send_time_field_offset != (size_t)-1)
       {
         // patch the current time into the message.  Since this operates on the packed version of the structure,
         // it won't work for anything after a variable-length field
+        std::shared_ptr<message> patched_message = std::make_shared<message>(*message_to_send);
         std::vector<char> packed_current_time = fc::raw::pack(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        assert(message_send_time_field_offset + packed_current_time.size() <= patched_message->data.size());
+        memcpy(patched_message->data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
+        return patched_message;
       }
+      if (compressed)
+        return compress_message(message_to_send);
       return message_to_send;
     }
     size_t peer_connection::real_queued_message::get_size_in_queue()
     {
-      return message_to_send.data.size();
+      return message_to_send->data.size();
     }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+    message_ptr peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node, bool compressed)
     {
-      return node->get_message_for_item(item_to_send);
+      return node->get_message_for_item(item_to_send, compressed);
     }
 
     size_t peer_connection::virtual_queued_message::get_size_in_queue()
@@ -88,6 +92,8 @@ namespace graphene { namespace net
       inhibit_fetching_sync_blocks(false),
       transaction_fetching_inhibited_until(fc::time_point::min()),
       last_known_fork_block_number(0),
+      supports_mail_inventory(false),
+      supports_compression(false),
       firewall_check_state(nullptr),
 #ifndef NDEBUG
       _thread(&fc::thread::current()),
@@ -272,7 +278,10 @@ namespace graphene { namespace net
       BOOST_SCOPE_EXIT(this_) {
         this_->_currently_handling_message = false;
       } BOOST_SCOPE_EXIT_END
-      _node->on_message( this, received_message );
+      if( received_message.msg_type == core_message_type_enum::compressed_message_type )
+        _node->on_message( this, decompress_message( received_message.as<compressed_message>() ) );
+      else
+        _node->on_message( this, received_message );
     }
 
     void peer_connection::on_connection_closed( message_oriented_connection* originating_connection )
@@ -295,13 +304,14 @@ namespace graphene { namespace net
       while (!_queued_messages.empty())
       {
         _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        message_ptr message_to_send = _queued_messages.front()->get_message(_node, supports_compression);
         try
         {
           //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
           //     "to send message of type ${type} for peer ${endpoint}",
-          //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
+          //     ("type", message_to_send->msg_type)("endpoint", get_remote_endpoint()));
+          // let the connection hold back small messages while more are waiting, they are written together
+          _message_connection.send_message(*message_to_send, _queued_messages.size() > 1);
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
@@ -379,6 +389,13 @@ namespace graphene { namespace net
       send_queueable_message(std::move(message_to_enqueue));
     }
 
+    void peer_connection::send_message(const message_ptr& message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(message_to_send));
+      send_queueable_message(std::move(message_to_enqueue));
+    }
+
     void peer_connection::send_item(const item_id& item_to_send)
     {
       VERIFY_CORRECT_THREAD();
@@ -192,6 +192,7 @@ void account_history_plugin_impl::add_account_history( const account_id_type acc
        obj.account = account_id;
        obj.sequence = stats_obj.total_ops + 1;
        obj.next = stats_obj.most_recent_op;
+       obj.set_operation( op_id(db).op );
    });
    db.modify( stats_obj, [&]( account_statistics_object& obj ){
        obj.most_recent_op = ath.id;
@@ -160,6 +160,7 @@ void elasticsearch_plugin_impl::add_elasticsearch( const account_id_type account
       obj.account = account_id;
       obj.sequence = stats_obj.total_ops + 1;
       obj.next = stats_obj.most_recent_op;
+      obj.set_operation(oho->op);
    });
 
    // keep stats growing as no op will be removed
@@ -4874,15 +4874,9 @@ std::pair<string, fc::uint128_t> wallet_api::get_max_account_reputation_weight()
 
         for(const account_statistics_object &stats : tmp_stats)
         {
-            fc::uint128_t weight_sum = 0;
-            for(const auto& iter : stats.reputation_votes)
+            if(stats.reputation_weight_sum > max_weight_sum)
             {
-                const std::pair<uint16_t, asset> &vote_info = iter.second;
-                weight_sum += vote_info.second.amount.value;
-            }
-            if(weight_sum > max_weight_sum)
-            {
-                max_weight_sum = weight_sum;
+                max_weight_sum = stats.reputation_weight_sum;
                 max_account = stats.owner;
             }
         }
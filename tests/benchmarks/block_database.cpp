@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <random>
+
+using namespace graphene::chain;
+
+namespace {
+
+/**
+ * Create block with a few transfers, so that block size is close to blocks seen on a busy chain.
+ */
+signed_block make_block(const block_id_type& previous, const uint32_t i)
+{
+   signed_block b;
+   b.previous = previous;
+   b.timestamp = fc::time_point_sec(GRAPHENE_DEFAULT_BLOCK_INTERVAL * i);
+   b.witness = witness_id_type(i % 11);
+   for(uint32_t t = 0; t < i % 8; ++t)
+   {
+      transfer_operation op;
+      op.from = account_id_type(i);
+      op.to = account_id_type(t);
+      op.amount = asset(i * t);
+      signed_transaction trx;
+      trx.operations.push_back(op);
+      trx.signatures.push_back(signature_type());
+      b.transactions.push_back(processed_transaction(trx));
+   }
+   return b;
+}
+
+int64_t elapsed_ms(const fc::time_point start_time)
+{
+   return (fc::time_point::now() - start_time).count() / 1000;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( block_database_read_bench )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t block_count = 1000000;
+      const uint32_t random_reads = 1000000;
+#else
+      const uint32_t block_count = 50000;
+      const uint32_t random_reads = 50000;
+#endif
+
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      vector<block_id_type> ids(block_count + 1);
+
+      {
+         block_database bdb;
+         bdb.open( data_dir.path() );
+
+         fc::time_point start_time = fc::time_point::now();
+         for( uint32_t i = 1; i <= block_count; ++i )
+         {
+            const signed_block b = make_block(ids[i - 1], i);
+            ids[i] = b.id();
+            bdb.store( ids[i], b );
+         }
+         ilog("Stored ${n} blocks in ${t} milliseconds.", ("n", block_count)("t", elapsed_ms(start_time)));
+
+         start_time = fc::time_point::now();
+         bdb.close();
+         ilog("Closed block database in ${t} milliseconds.", ("t", elapsed_ms(start_time)));
+      }
+
+      block_database bdb;
+      fc::time_point start_time = fc::time_point::now();
+      bdb.open( data_dir.path() );
+      ilog("Opened block database in ${t} milliseconds.", ("t", elapsed_ms(start_time)));
+
+      // Sequential reads, as done during replay.
+      uint32_t missing = 0;
+      start_time = fc::time_point::now();
+      for( uint32_t i = 1; i <= block_count; ++i )
+      {
+         const auto b = bdb.fetch_by_number(i);
+         if( !b.valid() || b->previous != ids[i - 1] )
+            ++missing;
+      }
+      ilog("Sequential fetch_by_number of ${n} blocks took ${t} milliseconds.", ("n", block_count)("t", elapsed_ms(start_time)));
+      BOOST_CHECK_EQUAL(missing, 0);
+
+      // Random reads, as done by API nodes serving get_block.
+      std::mt19937 gen(block_count);
+      std::uniform_int_distribution<uint32_t> dist(1, block_count);
+      missing = 0;
+      start_time = fc::time_point::now();
+      for( uint32_t i = 0; i < random_reads; ++i )
+      {
+         const uint32_t num = dist(gen);
+         const auto b = bdb.fetch_by_number(num);
+         if( !b.valid() || b->previous != ids[num - 1] )
+            ++missing;
+      }
+      ilog("Random fetch_by_number of ${n} blocks took ${t} milliseconds.", ("n", random_reads)("t", elapsed_ms(start_time)));
+      BOOST_CHECK_EQUAL(missing, 0);
+
+      missing = 0;
+      start_time = fc::time_point::now();
+      for( uint32_t i = 0; i < random_reads; ++i )
+      {
+         if( !bdb.contains(ids[dist(gen)]) )
+            ++missing;
+      }
+      ilog("Random contains of ${n} blocks took ${t} milliseconds.", ("n", random_reads)("t", elapsed_ms(start_time)));
+      BOOST_CHECK_EQUAL(missing, 0);
+
+      const auto last = bdb.last();
+      BOOST_REQUIRE(last.valid());
+      BOOST_CHECK(last->id() == ids[block_count]);
+
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/hardfork.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <reputation_vote_object.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace graphene::chain;
+
+namespace {
+
+/**
+ * Reference implementation of Proof of Participation scores calculation
+ * which scans all accounts and all reputation votes, as maintenance did before scores were updated incrementally.
+ * Returns expected pop_score of every account.
+ */
+map<account_id_type, uint16_t> full_scan_pop_scores(const database& db)
+{
+   const auto& account_idx = dynamic_cast<const primary_index<account_index>&>(db.get_index_type<account_index>());
+   const account_referrer_index& referrer_idx = account_idx.get_secondary_index<account_referrer_index>();
+   size_t max_referred = 0;
+   for(const auto& iter : referrer_idx.referred_by)
+      max_referred = std::max(max_referred, iter.second.size());
+
+   const auto& listing_idx = db.get_index_type<account_index>().indices().get<by_listings_count>();
+   const uint64_t max_listings = listing_idx.empty() ? 0 : (--listing_idx.end())->listings_count;
+
+   const auto& accounts_reputations = db.get_index_type<account_index>().indices().get<by_reputation_votes>();
+   const uint64_t max_reputation_votes = accounts_reputations.empty() ? 0 : (--accounts_reputations.end())->reputation_votes_count;
+
+   const omnibazaar::pop_weights pop_weights = db.get_global_properties().parameters.pop_weights;
+   const auto& all_accounts = db.get_index_type<account_index>().indices();
+   const bool use_max_weight_sum = db.head_block_time() > HARDFORK_OM_713_TIME;
+
+   // Sum all reputation votes of every account.
+   map<account_id_type, std::pair<fc::uint128_t, fc::uint128_t>> vote_sums;
+   map<account_id_type, uint64_t> votes_count;
+   for(const auto& vote : db.get_index_type<omnibazaar::reputation_vote_index>().indices())
+   {
+      vote_sums[vote.target].first += fc::uint128_t(vote.reputation) * vote.amount.amount.value;
+      vote_sums[vote.target].second += vote.amount.amount.value;
+      ++votes_count[vote.target];
+   }
+
+   fc::uint128_t max_weight_sum = 0;
+   if(use_max_weight_sum)
+   {
+      for(const auto& iter : vote_sums)
+         max_weight_sum = std::max(max_weight_sum, iter.second.second);
+   }
+
+   map<account_id_type, uint16_t> result;
+   for(const account_object& account : all_accounts)
+   {
+      uint16_t referral_score = account.referral_score;
+      uint16_t listings_score = account.listings_score;
+      uint16_t reputation_score = account.reputation_score;
+
+      const auto referrer_iter = referrer_idx.referred_by.find(account.id);
+      if(max_referred > 0 && referrer_iter != referrer_idx.referred_by.end())
+         referral_score = (uint64_t)referrer_iter->second.size() * GRAPHENE_100_PERCENT / max_referred;
+
+      const account_statistics_object& stats = account.statistics(db);
+      const auto sums_iter = vote_sums.find(account.id);
+      BOOST_CHECK_EQUAL(account.reputation_votes_count, sums_iter == vote_sums.end() ? 0 : votes_count[account.id]);
+      if(sums_iter != vote_sums.end())
+      {
+         const fc::uint128_t weighted_votes_sum = sums_iter->second.first;
+         const fc::uint128_t weight_sum = sums_iter->second.second;
+         BOOST_CHECK(weighted_votes_sum == stats.reputation_weighted_votes_sum);
+         BOOST_CHECK(weight_sum == stats.reputation_weight_sum);
+
+         reputation_score = ((weighted_votes_sum * account.reputation_votes_count * GRAPHENE_100_PERCENT)
+                             / ((use_max_weight_sum ? max_weight_sum : weight_sum) * max_reputation_votes)
+                             / OMNIBAZAAR_REPUTATION_MAX
+                             ).to_integer();
+      }
+
+      if(max_listings > 0)
+         listings_score = (fc::uint128_t(account.listings_count) * GRAPHENE_100_PERCENT / max_listings).to_integer();
+
+      result[account.id] = pop_weights.calc_pop_score(referral_score,
+                                                      listings_score,
+                                                      reputation_score,
+                                                      account.trust_score,
+                                                      account.reliability_score,
+                                                      account.verified);
+   }
+   return result;
+}
+
+void check_pop_scores(const database& db)
+{
+   const fc::time_point start_time = fc::time_point::now();
+   const auto expected = full_scan_pop_scores(db);
+   ilog("Full scan of ${n} accounts took ${t} milliseconds.",
+        ("n", expected.size())("t", (fc::time_point::now() - start_time).count() / 1000));
+
+   uint32_t mismatches = 0;
+   for(const auto& iter : expected)
+   {
+      if(iter.first(db).pop_score != iter.second)
+         ++mismatches;
+   }
+   BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+int64_t generate_maintenance_block(database& db, const fc::ecc::private_key& witness_key)
+{
+   const uint32_t slot = db.get_slot_at_time(db.get_dynamic_global_properties().next_maintenance_time);
+   const fc::time_point start_time = fc::time_point::now();
+   db.generate_block(db.get_slot_time(slot), db.get_scheduled_witness(slot), witness_key, ~0);
+   return (fc::time_point::now() - start_time).count() / 1000;
+}
+
+void pop_score_bench(const uint32_t account_count, const uint32_t changed_count)
+{
+   const auto witness_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")));
+
+   genesis_state_type genesis_state;
+   genesis_state.initial_timestamp = HARDFORK_OM_713_TIME + GRAPHENE_DEFAULT_MAINTENANCE_INTERVAL;
+   genesis_state.initial_active_witnesses = 10;
+   for(uint32_t i = 0; i < genesis_state.initial_active_witnesses; ++i)
+   {
+      const string name = "init" + fc::to_string(i);
+      genesis_state.initial_accounts.emplace_back(name, "", "", witness_key.get_public_key());
+      genesis_state.initial_committee_candidates.push_back({name});
+      genesis_state.initial_witness_candidates.push_back({name, witness_key.get_public_key()});
+   }
+   for(uint32_t i = 0; i < account_count; ++i)
+      genesis_state.initial_accounts.emplace_back("target" + fc::to_string(i), "", "",
+                                                  public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()));
+
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   database db;
+   db.open(data_dir.path(), [&]{return genesis_state;}, "test");
+
+   const account_id_type first = db.get_index_type<account_index>().indices().get<by_name>().find("target0")->get_id();
+   const auto target = [&](const uint32_t i) { return account_id_type(first.instance.value + (i % account_count)); };
+
+   // Each account receives one negative and one positive vote and every 10th account hosts some listings.
+   db._undo_db.disable();
+   for(uint32_t i = 0; i < account_count; ++i)
+   {
+      account_object::update_reputation(db, target(i), target(i + 1), i % OMNIBAZAAR_REPUTATION_DEFAULT, asset(1000 + i % 997));
+      account_object::update_reputation(db, target(i), target(i + 7), OMNIBAZAAR_REPUTATION_MAX - i % OMNIBAZAAR_REPUTATION_DEFAULT, asset(1000 + i % 991));
+      if(i % 10 == 0)
+         db.modify(target(i)(db), [&](account_object& a) { a.listings_count = i % 113; });
+   }
+   db._undo_db.enable();
+
+   ilog("First maintenance with ${n} accounts took ${t} milliseconds.",
+        ("n", account_count)("t", generate_maintenance_block(db, witness_key)));
+   check_pop_scores(db);
+
+   // Change vote values of a few accounts without changing vote counts and weights, so that globals stay the same.
+   db._undo_db.disable();
+   for(uint32_t i = 0; i < changed_count; ++i)
+   {
+      const uint32_t idx = i * (account_count / changed_count);
+      account_object::update_reputation(db, target(idx), target(idx + 1), (idx + 1) % OMNIBAZAAR_REPUTATION_DEFAULT, asset(1000 + idx % 997));
+   }
+   db._undo_db.enable();
+
+   ilog("Maintenance with ${c} changed of ${n} accounts took ${t} milliseconds.",
+        ("c", changed_count)("n", account_count)("t", generate_maintenance_block(db, witness_key)));
+   check_pop_scores(db);
+
+   db.close();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( pop_score_100k_bench )
+{
+   try {
+#ifdef NDEBUG
+      pop_score_bench(100000, 1000);
+#else
+      pop_score_bench(10000, 100);
+#endif
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( pop_score_1m_bench )
+{
+   try {
+#ifdef NDEBUG
+      pop_score_bench(1000000, 1000);
+#else
+      pop_score_bench(30000, 100);
+#endif
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
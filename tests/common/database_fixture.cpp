@@ -37,6 +37,9 @@
 #include <graphene/chain/vesting_balance_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 
+#include <../omnibazaar/escrow_object.hpp>
+#include <../omnibazaar/listing_object.hpp>
+
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -888,6 +891,63 @@ void database_fixture::bid_collateral(const account_object& who, const asset& to
    verify_asset_supplies(db);
 } FC_CAPTURE_AND_RETHROW( (who.name)(to_bid)(to_cover) ) }
 
+void database_fixture::make_publisher( const account_object& account )
+{ try {
+   set_expiration( db, trx );
+   account_update_operation op;
+   op.account = account.id;
+   op.is_a_publisher = true;
+   op.publisher_ip = account.name + ".example.com";
+   trx.operations.push_back(op);
+   for( auto& op : trx.operations ) db.current_fee_schedule().set_fee(op);
+   trx.validate();
+   db.push_transaction(trx, ~0);
+   trx.operations.clear();
+} FC_CAPTURE_AND_RETHROW( (account.id) ) }
+
+const omnibazaar::listing_object& database_fixture::create_listing( const account_object& seller, const account_object& publisher, const asset& price,
+                                                                  uint16_t priority_fee )
+{ try {
+   set_expiration( db, trx );
+   omnibazaar::listing_create_operation op;
+   op.seller = seller.id;
+   op.publisher = publisher.id;
+   op.price = price;
+   op.listing_hash = fc::sha256::hash( std::to_string( db.get_index_type<omnibazaar::listing_index>().get_next_id().instance() ) );
+   op.quantity = 1;
+   op.priority_fee = priority_fee;
+   op.ob_fee = op.calculate_omnibazaar_fee( db );
+   // Listing operations require a fee, while fees are zero in tests.
+   op.fee = asset(1);
+   trx.operations.push_back(op);
+   trx.validate();
+   auto processed = db.push_transaction(trx, ~0);
+   trx.operations.clear();
+   verify_asset_supplies(db);
+   return db.get<omnibazaar::listing_object>( processed.operation_results[0].get<object_id_type>() );
+} FC_CAPTURE_AND_RETHROW( (seller.id)(publisher.id)(price)(priority_fee) ) }
+
+const omnibazaar::escrow_object& database_fixture::create_escrow( const account_object& buyer, const account_object& seller, const account_object& agent,
+                                                                const asset& amount, fc::time_point_sec expiration, bool transfer_to_escrow )
+{ try {
+   set_expiration( db, trx );
+   omnibazaar::escrow_create_operation op;
+   op.expiration_time = expiration;
+   op.buyer = buyer.id;
+   op.seller = seller.id;
+   op.escrow = agent.id;
+   op.amount = amount;
+   op.transfer_to_escrow = transfer_to_escrow;
+   op.ob_fee = op.calculate_omnibazaar_fee( db );
+   trx.operations.push_back(op);
+   for( auto& op : trx.operations ) db.current_fee_schedule().set_fee(op);
+   trx.validate();
+   auto processed = db.push_transaction(trx, ~0);
+   trx.operations.clear();
+   verify_asset_supplies(db);
+   return db.get<omnibazaar::escrow_object>( processed.operation_results[0].get<object_id_type>() );
+} FC_CAPTURE_AND_RETHROW( (buyer.id)(seller.id)(agent.id)(amount)(expiration) ) }
+
 void database_fixture::fund_fee_pool( const account_object& from, const asset_object& asset_to_fund, const share_type amount )
 {
    asset_fund_fee_pool_operation fund;
@@ -268,6 +268,11 @@ struct database_fixture {
    asset cancel_limit_order( const limit_order_object& order );
    void transfer( account_id_type from, account_id_type to, const asset& amount, const asset& fee = asset() );
    void transfer( const account_object& from, const account_object& to, const asset& amount, const asset& fee = asset() );
+   void make_publisher( const account_object& account );
+   const omnibazaar::listing_object& create_listing( const account_object& seller, const account_object& publisher, const asset& price,
+                                                     uint16_t priority_fee = 0 );
+   const omnibazaar::escrow_object& create_escrow( const account_object& buyer, const account_object& seller, const account_object& agent,
+                                                   const asset& amount, fc::time_point_sec expiration, bool transfer_to_escrow = false );
    void fund_fee_pool( const account_object& from, const asset_object& asset_to_fund, const share_type amount );
    void enable_fees();
    void change_fees( const flat_set< fee_parameters >& new_params, uint32_t new_scale = 0 );
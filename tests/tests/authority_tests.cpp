@@ -1091,6 +1091,151 @@ BOOST_FIXTURE_TEST_CASE( voting_account, database_fixture )
                          vikram_committee_member) != db.get_global_properties().active_committee_members.end());
 } FC_LOG_AND_RETHROW() }
 
+BOOST_FIXTURE_TEST_CASE( vote_weights, database_fixture )
+{ try {
+   ACTORS((nathan)(vikram));
+   committee_member_id_type nathan_committee_member = create_committee_member(nathan_id(db)).id;
+   committee_member_id_type vikram_committee_member = create_committee_member(vikram_id(db)).id;
+   generate_block();
+
+   transfer(account_id_type(), nathan_id, asset(1000000));
+   transfer(account_id_type(), vikram_id, asset(100));
+   BOOST_CHECK( db.check_vote_weights() );
+
+   {
+      account_update_operation op;
+      op.account = vikram_id;
+      op.new_options = vikram_id(db).options;
+      op.new_options->votes.insert(vikram_committee_member(db).vote_id);
+      op.new_options->num_committee = 1;
+      trx.operations.push_back(op);
+      sign( trx, vikram_private_key );
+      PUSH_TX( db, trx );
+      trx.clear();
+   }
+   BOOST_CHECK( db.check_vote_weights() );
+
+   // Stake of nathan moves to votes of vikram.
+   {
+      account_update_operation op;
+      op.account = nathan_id;
+      op.new_options = nathan_id(db).options;
+      op.new_options->voting_account = vikram_id;
+      op.new_options->votes = flat_set<vote_id_type>{nathan_committee_member(db).vote_id};
+      op.new_options->num_committee = 1;
+      trx.operations.push_back(op);
+      sign( trx, nathan_private_key );
+      PUSH_TX( db, trx );
+      trx.clear();
+   }
+   BOOST_CHECK( db.check_vote_weights() );
+
+   generate_block();
+   transfer(nathan_id, vikram_id, asset(5000));
+   BOOST_CHECK( db.check_vote_weights() );
+
+   // Undo of the pending transfer and of the block with the votes.
+   db.pop_block();
+   BOOST_CHECK( db.check_vote_weights() );
+
+   generate_blocks(db.get_dynamic_global_properties().next_maintenance_time + GRAPHENE_DEFAULT_BLOCK_INTERVAL);
+   BOOST_CHECK( db.check_vote_weights() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( vote_weights_reopen, database_fixture )
+{ try {
+   ACTORS((nathan)(vikram));
+   committee_member_id_type vikram_committee_member = create_committee_member(vikram_id(db)).id;
+   const asset_id_type test_asset = create_user_issued_asset("VOTETEST").id;
+   generate_block();
+
+   transfer(account_id_type(), nathan_id, asset(1000000));
+   transfer(account_id_type(), vikram_id, asset(100));
+   // Core in orders counts as stake too.
+   BOOST_REQUIRE( create_sell_order(nathan_id, asset(1000), asset(1000, test_asset)) != nullptr );
+
+   {
+      account_update_operation op;
+      op.account = vikram_id;
+      op.new_options = vikram_id(db).options;
+      op.new_options->votes.insert(vikram_committee_member(db).vote_id);
+      op.new_options->num_committee = 1;
+      trx.operations.push_back(op);
+      sign( trx, vikram_private_key );
+      PUSH_TX( db, trx );
+      trx.clear();
+   }
+   {
+      account_update_operation op;
+      op.account = nathan_id;
+      op.new_options = nathan_id(db).options;
+      op.new_options->voting_account = vikram_id;
+      trx.operations.push_back(op);
+      sign( trx, nathan_private_key );
+      PUSH_TX( db, trx );
+      trx.clear();
+   }
+   // Make the changes irreversible, so that they are loaded from the saved object database instead of replayed.
+   generate_blocks( 2 * GRAPHENE_MIN_UNDO_HISTORY );
+   BOOST_CHECK( db.check_vote_weights() );
+   db.close();
+
+   // Accounts, balances and statistics are loaded from their own files and all of them feed vote weights.
+   database reopened;
+   reopened.open( data_dir->path(), [this]{ return genesis_state; }, "test" );
+   BOOST_CHECK( reopened.check_vote_weights() );
+   reopened.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( parallel_vote_tally, database_fixture )
+{ try {
+   ACTORS((nathan)(vikram));
+   committee_member_id_type nathan_committee_member = create_committee_member(nathan_id(db)).id;
+   committee_member_id_type vikram_committee_member = create_committee_member(vikram_id(db)).id;
+   generate_block();
+
+   // Enough voters with different stakes and votes that each worker thread gets a few of them.
+   for( int i = 0; i < 20; ++i )
+   {
+      const auto voter_key = generate_private_key( "voter" + fc::to_string(i) );
+      const account_id_type voter_id = create_account( "voter" + fc::to_string(i), voter_key.get_public_key() ).id;
+      transfer( account_id_type(), voter_id, asset(1000 + 37 * i) );
+
+      account_update_operation op;
+      op.account = voter_id;
+      op.new_options = voter_id(db).options;
+      if( i % 3 == 0 )
+         op.new_options->voting_account = i % 2 ? nathan_id : vikram_id;
+      else
+      {
+         op.new_options->votes.insert(nathan_committee_member(db).vote_id);
+         if( i % 3 == 2 )
+            op.new_options->votes.insert(vikram_committee_member(db).vote_id);
+         op.new_options->num_committee = 1;
+      }
+      trx.operations.push_back(op);
+      sign( trx, voter_key );
+      PUSH_TX( db, trx );
+      trx.clear();
+   }
+   generate_block();
+
+   vector<uint64_t> serial_votes( db.get_global_properties().next_available_vote_id );
+   const uint64_t serial_total = db.tally_base_voting_stake( serial_votes );
+
+   db.set_worker_threads( 4 );
+   vector<uint64_t> parallel_votes( db.get_global_properties().next_available_vote_id );
+   const uint64_t parallel_total = db.tally_base_voting_stake( parallel_votes );
+   BOOST_CHECK_EQUAL( parallel_total, serial_total );
+   BOOST_CHECK( parallel_votes == serial_votes );
+   BOOST_CHECK( parallel_votes[nathan_committee_member(db).vote_id.instance()] > 0 );
+
+   // Maintenance tallies on worker threads as well.
+   generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+   BOOST_CHECK( db.check_vote_weights() );
+   db.set_worker_threads( 0 );
+} FC_LOG_AND_RETHROW() }
+
 /*
  * Simple corporate accounts:
  *
@@ -1309,4 +1454,78 @@ BOOST_FIXTURE_TEST_CASE( nonminimal_sig_test, database_fixture )
    }
 }
 
+BOOST_AUTO_TEST_CASE( signature_cache )
+{ try {
+   fc::ecc::private_key nathan_key = fc::ecc::private_key::regenerate(fc::digest("nathan"));
+   const chain_id_type& chain_id = db.get_chain_id();
+
+   transfer_operation op;
+   op.from = account_id_type(1);
+   op.to = account_id_type(2);
+   op.amount = asset(1);
+   signed_transaction tx;
+   tx.operations.push_back( op );
+   tx.sign( nathan_key, chain_id );
+
+   const signature_cache_stats before = get_signature_cache_stats();
+   BOOST_CHECK( tx.get_signature_keys( chain_id ) == flat_set<public_key_type>{ nathan_key.get_public_key() } );
+   const signature_cache_stats after_miss = get_signature_cache_stats();
+   BOOST_CHECK_EQUAL( after_miss.misses, before.misses + 1 );
+
+   // Another copy of the same transaction gets the key from the cache.
+   signed_transaction copy( static_cast<const transaction&>( tx ) );
+   copy.signatures = tx.signatures;
+   BOOST_CHECK( copy.get_signature_keys( chain_id ) == flat_set<public_key_type>{ nathan_key.get_public_key() } );
+   const signature_cache_stats after_hit = get_signature_cache_stats();
+   BOOST_CHECK_EQUAL( after_hit.hits, after_miss.hits + 1 );
+   BOOST_CHECK_EQUAL( after_hit.misses, after_miss.misses );
+
+   // Duplicate signatures are still detected when keys come from the cache.
+   copy.signatures.push_back( tx.signatures.front() );
+   GRAPHENE_REQUIRE_THROW( copy.get_signature_keys( chain_id ), fc::exception );
+
+   set_signature_cache_capacity( 0 );
+   BOOST_CHECK_EQUAL( get_signature_cache_stats().size, 0u );
+   set_signature_cache_capacity( before.capacity );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( precomputed_signature_keys )
+{ try {
+   fc::ecc::private_key nathan_key = fc::ecc::private_key::regenerate(fc::digest("nathan"));
+   fc::ecc::private_key dan_key = fc::ecc::private_key::regenerate(fc::digest("dan"));
+   const chain_id_type& chain_id = db.get_chain_id();
+   const flat_set<public_key_type> nathan_keys{ nathan_key.get_public_key() };
+
+   transfer_operation op;
+   op.from = account_id_type(1);
+   op.to = account_id_type(2);
+   op.amount = asset(1);
+   signed_transaction tx;
+   tx.operations.push_back( op );
+   signed_transaction dan_tx( tx );
+   tx.sign( nathan_key, chain_id );
+   dan_tx.sign( dan_key, chain_id );
+   const vector<signature_type> nathan_signatures = tx.signatures;
+   tx.precompute_signature_keys( chain_id );
+   BOOST_CHECK( tx.get_signature_keys( chain_id ) == nathan_keys );
+
+   // Keys are recovered again after signatures are replaced without sign() or clear().
+   tx.signatures = dan_tx.signatures;
+   BOOST_CHECK( tx.get_signature_keys( chain_id ) == flat_set<public_key_type>{ dan_key.get_public_key() } );
+
+   tx.signatures = nathan_signatures;
+   tx.precompute_signature_keys( chain_id );
+
+   // A copy with the same contents uses the precomputed keys, a modified one does not.
+   processed_transaction processed( tx );
+   BOOST_CHECK( processed.get_signature_keys( chain_id ) == nathan_keys );
+   processed.operations.push_back( op );
+   BOOST_CHECK( processed.get_signature_keys( chain_id ) != nathan_keys );
+
+   // Keys precomputed for one chain are not used for another.
+   chain_id_type other_chain_id = fc::sha256::hash( std::string( "other" ) );
+   BOOST_CHECK( tx.get_signature_keys( other_chain_id ) != nathan_keys );
+   BOOST_CHECK( tx.get_signature_keys( chain_id ) == nathan_keys );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
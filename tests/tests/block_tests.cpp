@@ -32,6 +32,8 @@
 #include <graphene/chain/committee_member_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
 #include <graphene/chain/market_object.hpp>
+#include <../omnibazaar/escrow_object.hpp>
+#include <../omnibazaar/listing_object.hpp>
 
 #include <graphene/utilities/tempdir.hpp>
 
@@ -298,6 +300,74 @@ BOOST_AUTO_TEST_CASE( fork_blocks )
 }
 
 
+BOOST_AUTO_TEST_CASE( fork_db_max_bytes )
+{
+   try {
+      uint32_t timestamp = GRAPHENE_TESTING_GENESIS_TIMESTAMP;
+      const auto make_block = [&timestamp]( const signed_block& prev ) {
+         signed_block b;
+         b.previous = prev.id();
+         b.timestamp = fc::time_point_sec( timestamp++ );
+         return b;
+      };
+
+      // a0 - a1 - a2 - a3 - a4 - a5
+      //  |         |
+      //  x1 - x2   b3 - b4 - b5 - b6 - b7
+      vector<signed_block> a( 1, signed_block() );
+      a[0].timestamp = fc::time_point_sec( timestamp++ );
+      for( uint32_t i = 1; i <= 5; ++i )
+         a.push_back( make_block( a.back() ) );
+      vector<signed_block> x( 1, make_block( a[0] ) );
+      x.push_back( make_block( x.back() ) );
+      vector<signed_block> b( 1, make_block( a[2] ) );
+      for( uint32_t i = 4; i <= 7; ++i )
+         b.push_back( make_block( b.back() ) );
+
+      // empty blocks all have the same size
+      const uint64_t block_size = fc::raw::pack_size( a[0] );
+      fork_database fdb;
+      fdb.set_max_bytes( 9 * block_size );
+      fdb.start_block( a[0] );
+      for( uint32_t i = 1; i <= 5; ++i )
+         fdb.push_block( a[i] );
+      fdb.push_block( x[0] );
+      fdb.push_block( x[1] );
+      fdb.push_block( b[0] );
+      BOOST_CHECK_EQUAL( fdb.total_bytes(), 9 * block_size );
+
+      // the oldest fork is dropped as a whole, not leaving x2 without its parent
+      fdb.push_block( b[1] );
+      BOOST_CHECK( !fdb.is_known_block( x[0].id() ) );
+      BOOST_CHECK( !fdb.is_known_block( x[1].id() ) );
+      BOOST_CHECK_EQUAL( fdb.total_bytes(), 8 * block_size );
+      BOOST_CHECK( fdb.head()->id == a[5].id() );
+
+      // b becomes the longest fork, both branches are kept to switch from the old head
+      fdb.push_block( b[2] );
+      fdb.push_block( b[3] );
+      BOOST_CHECK( fdb.head()->id == b[3].id() );
+      BOOST_CHECK_EQUAL( fdb.total_bytes(), 10 * block_size );
+      auto branches = fdb.fetch_branch_from( b[3].id(), a[5].id() );
+      BOOST_CHECK_EQUAL( branches.first.size(), 4u );
+      BOOST_CHECK_EQUAL( branches.second.size(), 3u );
+      BOOST_CHECK( branches.first.back()->previous_id() == a[2].id() );
+
+      // once the switch is behind, the old branch is dropped
+      fdb.push_block( b[4] );
+      BOOST_CHECK( fdb.head()->id == b[4].id() );
+      BOOST_CHECK( !fdb.is_known_block( a[3].id() ) );
+      BOOST_CHECK( !fdb.is_known_block( a[4].id() ) );
+      BOOST_CHECK( !fdb.is_known_block( a[5].id() ) );
+      BOOST_CHECK_EQUAL( fdb.total_bytes(), 8 * block_size );
+      for( const signed_block& block : b )
+         BOOST_CHECK( fdb.is_known_block( block.id() ) );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 /**
  *  These test has been disabled, out of order blocks should result in the node getting disconnected.
  *  
@@ -760,6 +830,111 @@ BOOST_FIXTURE_TEST_CASE( limit_order_expiration, database_fixture )
    BOOST_CHECK_EQUAL( get_balance(*nathan, *core), 50000 );
 } FC_LOG_AND_RETHROW() }
 
+BOOST_FIXTURE_TEST_CASE( escrow_and_listing_expiration, database_fixture )
+{ try {
+   ACTORS((buyer)(seller)(agent)(publisher)(sink));
+   transfer(account_id_type(), buyer_id, asset(100000));
+   transfer(account_id_type(), seller_id, asset(100000));
+   make_publisher(publisher);
+   {
+      account_update_operation op;
+      op.account = agent_id;
+      op.is_an_escrow = true;
+      op.escrow_fee = 0;
+      trx.operations.push_back(op);
+      op = account_update_operation();
+      op.account = buyer_id;
+      op.escrows = std::set<account_id_type>{ agent_id };
+      trx.operations.push_back(op);
+      op.account = seller_id;
+      trx.operations.push_back(op);
+      set_expiration( db, trx );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+   }
+   generate_block();
+   db.modify( db.get_global_properties(), []( global_property_object& p ) {
+      p.parameters.maximum_listing_lifetime = 600;
+   });
+
+   // Keep operations of the last applied block, they are cleared after it is applied.
+   vector<operation_history_object> block_ops;
+   boost::signals2::scoped_connection connection = db.applied_block.connect( [&]( const signed_block& ) {
+      block_ops.clear();
+      for( const auto& op : db.get_applied_operations() )
+         if( op.valid() )
+            block_ops.push_back( *op );
+   });
+   const auto expiration_ops = [&]() {
+      vector<operation_history_object> result;
+      for( const auto& op : block_ops )
+         if( op.op.which() == operation::tag<omnibazaar::escrow_release_operation>::value
+             || op.op.which() == operation::tag<omnibazaar::listing_delete_operation>::value )
+            result.push_back( op );
+      return result;
+   };
+
+   // All escrows and listings expiring in one block are closed in one batch.
+   {
+      const fc::time_point_sec expiration = db.head_block_time() + 600;
+      const escrow_id_type e1 = create_escrow(buyer, seller, agent, asset(1000), expiration).id;
+      const escrow_id_type e2 = create_escrow(buyer, seller, agent, asset(2000), expiration).id;
+      const listing_id_type l1 = create_listing(seller, publisher, asset(100)).id;
+      const listing_id_type l2 = create_listing(seller, publisher, asset(200)).id;
+      BOOST_CHECK( l1(db).expiration_time == expiration );
+      const int64_t seller_balance = get_balance(seller_id, asset_id_type());
+      const int64_t buyer_balance = get_balance(buyer_id, asset_id_type());
+
+      generate_blocks(expiration);
+      BOOST_CHECK( db.find(e1) == nullptr );
+      BOOST_CHECK( db.find(e2) == nullptr );
+      BOOST_CHECK( db.find(l1) == nullptr );
+      BOOST_CHECK( db.find(l2) == nullptr );
+      BOOST_CHECK_EQUAL( get_balance(seller_id, asset_id_type()), seller_balance + 3000 );
+      BOOST_CHECK_EQUAL( get_balance(buyer_id, asset_id_type()), buyer_balance );
+
+      const vector<operation_history_object> ops = expiration_ops();
+      BOOST_REQUIRE_EQUAL( ops.size(), 4u );
+      BOOST_CHECK( ops[0].op.get<omnibazaar::escrow_release_operation>().escrow == e1 );
+      BOOST_CHECK( ops[1].op.get<omnibazaar::escrow_release_operation>().escrow == e2 );
+      BOOST_CHECK( ops[2].op.get<omnibazaar::listing_delete_operation>().listing_id == l1 );
+      BOOST_CHECK( ops[3].op.get<omnibazaar::listing_delete_operation>().listing_id == l2 );
+      for( size_t i = 1; i < ops.size(); ++i )
+         BOOST_CHECK_EQUAL( ops[i].virtual_op, ops[i-1].virtual_op + 1 );
+   }
+
+   // One escrow can be neither released nor returned, because its agent spent the funds. The batch is undone,
+   // and escrows are closed one by one in the same order, as if there was no batch.
+   {
+      const fc::time_point_sec expiration = db.head_block_time() + 600;
+      const escrow_id_type e3 = create_escrow(buyer, seller, agent, asset(1000), expiration).id;
+      const escrow_id_type e4 = create_escrow(buyer, seller, agent, asset(2000), expiration).id;
+      const escrow_id_type e5 = create_escrow(buyer, seller, agent, asset(4000), expiration, true).id;
+      const listing_id_type l3 = create_listing(seller, publisher, asset(300)).id;
+      transfer(agent_id, sink_id, asset(4000));
+      const int64_t seller_balance = get_balance(seller_id, asset_id_type());
+      const int64_t buyer_balance = get_balance(buyer_id, asset_id_type());
+
+      generate_blocks(expiration);
+      BOOST_CHECK( db.find(e3) == nullptr );
+      BOOST_CHECK( db.find(e4) == nullptr );
+      BOOST_CHECK( db.find(e5) == nullptr );
+      BOOST_CHECK( db.find(l3) == nullptr );
+      BOOST_CHECK_EQUAL( get_balance(seller_id, asset_id_type()), seller_balance + 3000 );
+      BOOST_CHECK_EQUAL( get_balance(buyer_id, asset_id_type()), buyer_balance );
+      BOOST_CHECK_EQUAL( get_balance(agent_id, asset_id_type()), 0 );
+
+      // Failed release and return of the last escrow are not recorded, but use virtual operation numbers.
+      const vector<operation_history_object> ops = expiration_ops();
+      BOOST_REQUIRE_EQUAL( ops.size(), 3u );
+      BOOST_CHECK( ops[0].op.get<omnibazaar::escrow_release_operation>().escrow == e3 );
+      BOOST_CHECK( ops[1].op.get<omnibazaar::escrow_release_operation>().escrow == e4 );
+      BOOST_CHECK( ops[2].op.get<omnibazaar::listing_delete_operation>().listing_id == l3 );
+      BOOST_CHECK_EQUAL( ops[1].virtual_op, ops[0].virtual_op + 1 );
+      BOOST_CHECK_EQUAL( ops[2].virtual_op, ops[1].virtual_op + 3 );
+   }
+} FC_LOG_AND_RETHROW() }
+
 BOOST_FIXTURE_TEST_CASE( double_sign_check, database_fixture )
 { try {
    generate_block();
@@ -27,12 +27,65 @@
 #include <graphene/app/database_api.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/thread/thread.hpp>
 
 #include "../common/database_fixture.hpp"
 
 using namespace graphene::chain;
 using namespace graphene::chain::test;
 
+namespace {
+
+// Pages through listings with query( last, limit ), continuing each page from the last listing of the previous one.
+template<typename Query>
+vector<listing_id_type> page_through( const Query& query )
+{
+   vector<listing_id_type> result;
+   fc::optional<graphene::app::listing_summary> last;
+   while( true )
+   {
+      vector<graphene::app::listing_summary> page = query( last, 3 );
+      if( last.valid() )
+      {
+         // cursor is the first listing of the next page
+         BOOST_REQUIRE( !page.empty() && page.front().id == last->id );
+         page.erase( page.begin() );
+      }
+      if( page.empty() )
+         break;
+      for( const auto& listing : page )
+         result.push_back( listing.id );
+      last = page.back();
+   }
+   return result;
+}
+
+vector<listing_id_type> listing_ids( const vector<graphene::app::listing_summary>& listings )
+{
+   vector<listing_id_type> result;
+   for( const auto& listing : listings )
+      result.push_back( listing.id );
+   return result;
+}
+
+// Subscribers are notified in a separate task, which runs only when the test yields.
+void deliver_notifications()
+{
+   fc::usleep( fc::milliseconds(100) );
+}
+
+// Ids of objects in all notifications, changed objects are delivered in full and removed ones as ids.
+std::set<object_id_type> notified_ids( const vector<fc::variant>& notifications )
+{
+   std::set<object_id_type> result;
+   for( const fc::variant& notification : notifications )
+      for( const fc::variant& item : notification.get_array() )
+         result.insert( item.is_object() ? item.get_object()["id"].as<object_id_type>() : item.as<object_id_type>() );
+   return result;
+}
+
+}
+
 BOOST_FIXTURE_TEST_SUITE(database_api_tests, database_fixture)
 
 BOOST_AUTO_TEST_CASE(is_registered) {
@@ -124,4 +177,323 @@ BOOST_AUTO_TEST_CASE( get_potential_signatures_other ) {
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( listing_feed_reorganization ) {
+   try {
+      ACTORS( (seller)(publisher)(other) );
+      transfer( account_id_type(), seller_id, asset(1000000) );
+      make_publisher( publisher );
+      make_publisher( other );
+      generate_block();
+
+      omnibazaar::listing_feed feed( db, 100 );
+      vector<omnibazaar::listing_change> applied;
+      feed.changes_applied.connect( [&applied]( const vector<omnibazaar::listing_change>& changes ) {
+         applied.insert( applied.end(), changes.begin(), changes.end() );
+      });
+      const uint32_t start_block = db.head_block_num() + 1;
+
+      const listing_id_type listing_id = create_listing( seller, publisher, asset(1000) ).id;
+      generate_block();
+
+      // Move listing to another publisher in a block which is then replaced by an empty one.
+      omnibazaar::listing_update_operation update_op;
+      update_op.seller = seller_id;
+      update_op.listing_id = listing_id;
+      update_op.publisher = other_id;
+      update_op.ob_fee = update_op.calculate_omnibazaar_fee( db );
+      update_op.fee = asset(1);
+      trx.operations.push_back( update_op );
+      set_expiration( db, trx );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+      generate_block();
+      BOOST_CHECK( listing_id(db).publisher == other_id );
+
+      db.pop_block();
+      generate_block();
+      db.clear_pending();
+      BOOST_CHECK( listing_id(db).publisher == publisher_id );
+
+      omnibazaar::listing_delete_operation delete_op;
+      delete_op.seller = seller_id;
+      delete_op.listing_id = listing_id;
+      trx.operations.push_back( delete_op );
+      for( auto& op : trx.operations ) db.current_fee_schedule().set_fee( op );
+      set_expiration( db, trx );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+      generate_block();
+      const uint32_t delete_block = db.head_block_num();
+
+      // Changes are held back until their blocks are irreversible.
+      BOOST_CHECK( feed.get_changes( publisher_id, start_block, 0, 100 ).empty() );
+      BOOST_CHECK( applied.empty() );
+      while( db.get_dynamic_global_properties().last_irreversible_block_num < delete_block )
+         generate_block();
+
+      // Reverted update was never reported, and deletion is reported to the publisher restored by reorganization.
+      const vector<omnibazaar::listing_change> changes = feed.get_changes( publisher_id, start_block, 0, 100 );
+      BOOST_REQUIRE_EQUAL( changes.size(), 2u );
+      BOOST_CHECK_EQUAL( changes[0].type, omnibazaar::listing_created );
+      BOOST_CHECK_EQUAL( changes[1].type, omnibazaar::listing_deleted );
+      BOOST_CHECK( changes[1].listing_id == listing_id );
+      BOOST_CHECK( changes[1].publisher == publisher_id );
+      BOOST_CHECK_EQUAL( changes[1].block_num, delete_block );
+      BOOST_CHECK( feed.get_changes( other_id, start_block, 0, 100 ).empty() );
+      BOOST_CHECK_EQUAL( applied.size(), 2u );
+
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( listing_pages ) {
+   try {
+      using graphene::app::listing_summary;
+      typedef fc::optional<listing_summary> cursor;
+
+      ACTORS( (seller)(other)(publisher) );
+      transfer( account_id_type(), seller_id, asset(1000000) );
+      transfer( account_id_type(), other_id, asset(1000000) );
+      make_publisher( publisher );
+      const asset_id_type coin_id = create_user_issued_asset( "LISTCOIN" ).id;
+      generate_block();
+
+      // Listings created in one block share update and expiration times.
+      const listing_id_type l0 = create_listing( seller, publisher, asset(300), 100 ).id;
+      const listing_id_type l1 = create_listing( seller, publisher, asset(100), 0 ).id;
+      const listing_id_type l2 = create_listing( seller, publisher, asset(200), 100 ).id;
+      const listing_id_type l3 = create_listing( seller, publisher, asset(200), 50 ).id;
+      const listing_id_type l4 = create_listing( seller, publisher, asset(100), 100 ).id;
+      const listing_id_type other_listing = create_listing( other, publisher, asset(200), 0 ).id;
+      generate_block();
+
+      const listing_id_type later = create_listing( seller, publisher, asset(200), 0 ).id;
+      omnibazaar::listing_update_operation update_op;
+      update_op.seller = seller_id;
+      update_op.listing_id = l1;
+      update_op.price = asset(200);
+      update_op.update_expiration_time = true;
+      update_op.ob_fee = update_op.calculate_omnibazaar_fee( db );
+      update_op.fee = asset(1);
+      trx.operations.push_back( update_op );
+      set_expiration( db, trx );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+      generate_block();
+      BOOST_REQUIRE( l1(db).updated_at == later(db).updated_at );
+      BOOST_REQUIRE( l0(db).updated_at < l1(db).updated_at );
+
+      // Listings support only core asset, so price in another asset is set directly.
+      db.modify( other_listing(db), [&]( omnibazaar::listing_object& l ) { l.price = asset( 150, coin_id ); } );
+
+      graphene::app::database_api db_api( db );
+      const auto start = []( const cursor& last ) { return last.valid() ? last->id : listing_id_type(); };
+
+      BOOST_CHECK( page_through( [&]( const cursor& last, uint32_t limit ) {
+         return db_api.get_seller_listings( seller_id, start( last ), limit );
+      }) == vector<listing_id_type>({ l0, l1, l2, l3, l4, later }) );
+
+      BOOST_CHECK( page_through( [&]( const cursor& last, uint32_t limit ) {
+         return db_api.get_publisher_listings( publisher_id, start( last ), limit );
+      }) == vector<listing_id_type>({ l0, l1, l2, l3, l4, other_listing, later }) );
+
+      // listings with the same update time are ordered by ID
+      const auto update_time = []( const cursor& last ) { return last.valid() ? last->updated_at : time_point_sec(); };
+      BOOST_CHECK( page_through( [&]( const cursor& last, uint32_t limit ) {
+         return db_api.get_seller_listings_by_update_time( seller_id, update_time( last ), start( last ), limit );
+      }) == vector<listing_id_type>({ l0, l2, l3, l4, l1, later }) );
+      BOOST_CHECK( page_through( [&]( const cursor& last, uint32_t limit ) {
+         return db_api.get_publisher_listings_by_update_time( publisher_id, update_time( last ), start( last ), limit );
+      }) == vector<listing_id_type>({ l0, l2, l3, l4, other_listing, l1, later }) );
+      BOOST_CHECK( page_through( [&]( const cursor& last, uint32_t limit ) {
+         return db_api.get_listings_by_update_time( update_time( last ), start( last ), limit );
+      }) == vector<listing_id_type>({ l0, l2, l3, l4, other_listing, l1, later }) );
+      BOOST_CHECK( listing_ids( db_api.get_listings_by_update_time( l1(db).updated_at, listing_id_type(), 100 ) )
+                   == vector<listing_id_type>({ l1, later }) );
+      BOOST_CHECK( listing_ids( db_api.get_seller_listings_by_update_time( other_id, time_point_sec(), listing_id_type(), 100 ) )
+                   == vector<listing_id_type>({ other_listing }) );
+
+      BOOST_CHECK( page_through( [&]( const cursor& last, uint32_t limit ) {
+         return db_api.get_listings_by_expiration( last.valid() ? last->expiration_time : time_point_sec(), start( last ), limit );
+      }) == vector<listing_id_type>({ l0, l2, l3, l4, other_listing, l1, later }) );
+      BOOST_CHECK( listing_ids( db_api.get_listings_by_expiration( l1(db).expiration_time, listing_id_type(), 100 ) )
+                   == vector<listing_id_type>({ l1, later }) );
+
+      // both ends of price range are included, and only listings priced in requested asset are returned
+      const auto by_price = [&]( asset_id_type asset_id, share_type min_amount, share_type max_amount ) {
+         return page_through( [&]( const cursor& last, uint32_t limit ) {
+            return db_api.get_listings_by_price( asset_id, last.valid() ? last->price.amount : min_amount, max_amount,
+                                                 start( last ), limit );
+         });
+      };
+      BOOST_CHECK( by_price( asset_id_type(), 0, 1000 ) == vector<listing_id_type>({ l4, l1, l2, l3, later, l0 }) );
+      BOOST_CHECK( by_price( asset_id_type(), 100, 200 ) == vector<listing_id_type>({ l4, l1, l2, l3, later }) );
+      BOOST_CHECK( by_price( asset_id_type(), 101, 300 ) == vector<listing_id_type>({ l1, l2, l3, later, l0 }) );
+      BOOST_CHECK( by_price( asset_id_type(), 100, 199 ) == vector<listing_id_type>({ l4 }) );
+      BOOST_CHECK( by_price( asset_id_type(), 201, 299 ).empty() );
+      BOOST_CHECK( by_price( coin_id, 0, 1000 ) == vector<listing_id_type>({ other_listing }) );
+      BOOST_CHECK( by_price( coin_id, 150, 150 ) == vector<listing_id_type>({ other_listing }) );
+      BOOST_CHECK( by_price( coin_id, 151, 1000 ).empty() );
+      BOOST_CHECK( by_price( asset_id_type(12345), 0, 1000 ).empty() );
+
+      const auto by_priority_fee = [&]( uint16_t min_priority_fee ) {
+         return page_through( [&]( const cursor& last, uint32_t limit ) {
+            return db_api.get_listings_by_priority_fee( last.valid() ? last->priority_fee : min_priority_fee, start( last ), limit );
+         });
+      };
+      BOOST_CHECK( by_priority_fee( 0 ) == vector<listing_id_type>({ l1, other_listing, later, l3, l0, l2, l4 }) );
+      BOOST_CHECK( by_priority_fee( 50 ) == vector<listing_id_type>({ l3, l0, l2, l4 }) );
+      BOOST_CHECK( by_priority_fee( 101 ).empty() );
+
+      // every query returns at most 100 listings
+      GRAPHENE_REQUIRE_THROW( db_api.get_seller_listings( seller_id, listing_id_type(), 101 ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( db_api.get_publisher_listings( publisher_id, listing_id_type(), 101 ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( db_api.get_seller_listings_by_update_time( seller_id, time_point_sec(), listing_id_type(), 101 ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( db_api.get_publisher_listings_by_update_time( publisher_id, time_point_sec(), listing_id_type(), 101 ),
+                              fc::exception );
+      GRAPHENE_REQUIRE_THROW( db_api.get_listings_by_update_time( time_point_sec(), listing_id_type(), 101 ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( db_api.get_listings_by_expiration( time_point_sec(), listing_id_type(), 101 ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( db_api.get_listings_by_price( asset_id_type(), 0, 1000, listing_id_type(), 101 ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( db_api.get_listings_by_priority_fee( 0, listing_id_type(), 101 ), fc::exception );
+      BOOST_CHECK_EQUAL( db_api.get_listings_by_priority_fee( 0, listing_id_type(), 100 ).size(), 7 );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( object_subscriptions ) {
+   try {
+      ACTORS( (alice)(bob) );
+      transfer( account_id_type(), alice_id, asset(1000000) );
+      transfer( account_id_type(), bob_id, asset(1000000) );
+      generate_block();
+      const auto balance_id = [&]( account_id_type owner ) -> object_id_type {
+         return db.get_index_type<account_balance_index>().indices().get<by_account_asset>()
+                  .find( boost::make_tuple( owner, asset_id_type() ) )->id;
+      };
+
+      vector<fc::variant> notifications;
+      graphene::app::database_api db_api( db );
+      db_api.set_subscribe_callback( [&notifications]( const fc::variant& v ) { notifications.push_back( v ); }, false );
+      // typed id is subscribed the same way as the generic one
+      db_api.get_accounts( { alice_id } );
+      db_api.get_objects( { balance_id( alice_id ) } );
+
+      make_publisher( alice );
+      make_publisher( bob );
+      transfer( alice_id, bob_id, asset(1000) );
+      generate_block();
+      deliver_notifications();
+
+      const std::set<object_id_type> ids = notified_ids( notifications );
+      BOOST_CHECK( ids == std::set<object_id_type>({ alice_id, balance_id( alice_id ) }) );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( account_subscriptions ) {
+   try {
+      ACTORS( (alice)(bob)(carol) );
+      transfer( account_id_type(), alice_id, asset(1000000) );
+      generate_block();
+
+      vector<fc::variant> notifications;
+      graphene::app::database_api db_api( db );
+      db_api.set_subscribe_callback( [&notifications]( const fc::variant& v ) { notifications.push_back( v ); }, false );
+      BOOST_REQUIRE_EQUAL( db_api.get_full_accounts( { "bob" }, true ).size(), 1u );
+
+      transfer( alice_id, bob_id, asset(1000) );
+      generate_block();
+      deliver_notifications();
+
+      // objects which impact subscribed account are delivered, including the ones created for it
+      const auto& balances = db.get_index_type<account_balance_index>().indices().get<by_account_asset>();
+      BOOST_CHECK( notified_ids( notifications ).count( balances.find( boost::make_tuple( bob_id, asset_id_type() ) )->id ) );
+
+      notifications.clear();
+      transfer( alice_id, carol_id, asset(1000) );
+      generate_block();
+      deliver_notifications();
+      BOOST_CHECK( notifications.empty() );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( remove_create_subscriptions ) {
+   try {
+      ACTORS( (seller)(publisher) );
+      transfer( account_id_type(), seller_id, asset(1000000) );
+      make_publisher( publisher );
+      generate_block();
+
+      // Failing subscriber is notified first, it must not stop delivery to the others.
+      auto dispatcher = std::make_shared<graphene::app::subscription_dispatcher>( db );
+      vector<fc::variant> all_notifications;
+      vector<fc::variant> object_notifications;
+      uint32_t failures = 0;
+      graphene::app::database_api failing_api( db, nullptr, dispatcher );
+      graphene::app::database_api all_api( db, nullptr, dispatcher );
+      graphene::app::database_api object_api( db, nullptr, dispatcher );
+      failing_api.set_subscribe_callback( [&failures]( const fc::variant& ) { ++failures; throw fc::exception(); }, true );
+      all_api.set_subscribe_callback( [&all_notifications]( const fc::variant& v ) { all_notifications.push_back( v ); }, true );
+      object_api.set_subscribe_callback( [&object_notifications]( const fc::variant& v ) { object_notifications.push_back( v ); }, false );
+
+      const listing_id_type listing_id = create_listing( seller, publisher, asset(1000) ).id;
+      generate_block();
+      deliver_notifications();
+
+      BOOST_CHECK_GT( failures, 0u );
+      BOOST_CHECK( notified_ids( all_notifications ).count( listing_id ) );
+      BOOST_CHECK( object_notifications.empty() );
+
+      all_notifications.clear();
+      omnibazaar::listing_delete_operation delete_op;
+      delete_op.seller = seller_id;
+      delete_op.listing_id = listing_id;
+      trx.operations.push_back( delete_op );
+      for( auto& op : trx.operations ) db.current_fee_schedule().set_fee( op );
+      set_expiration( db, trx );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+      generate_block();
+      deliver_notifications();
+
+      // removed object is delivered as its id
+      bool removal_notified = false;
+      for( const fc::variant& notification : all_notifications )
+         for( const fc::variant& item : notification.get_array() )
+            removal_notified |= !item.is_object() && item.as<object_id_type>() == listing_id;
+      BOOST_CHECK( removal_notified );
+      BOOST_CHECK( object_notifications.empty() );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( subscriber_removed_with_api ) {
+   try {
+      ACTORS( (alice) );
+      transfer( account_id_type(), alice_id, asset(1000000) );
+      generate_block();
+
+      auto dispatcher = std::make_shared<graphene::app::subscription_dispatcher>( db );
+      uint32_t removed_count = 0;
+      uint32_t remaining_count = 0;
+      graphene::app::database_api remaining_api( db, nullptr, dispatcher );
+      remaining_api.set_subscribe_callback( [&remaining_count]( const fc::variant& ) { ++remaining_count; }, false );
+      remaining_api.get_objects( { alice_id } );
+      {
+         graphene::app::database_api removed_api( db, nullptr, dispatcher );
+         removed_api.set_subscribe_callback( [&removed_count]( const fc::variant& ) { ++removed_count; }, true );
+         removed_api.get_objects( { alice_id } );
+
+         // notifications queued before the API is destroyed are dropped too
+         make_publisher( alice );
+         generate_block();
+      }
+      deliver_notifications();
+      BOOST_CHECK_EQUAL( remaining_count, 1u );
+      BOOST_CHECK_EQUAL( removed_count, 0u );
+
+      ACTOR( bob );
+      transfer( alice_id, bob_id, asset(1000) );
+      generate_block();
+      deliver_notifications();
+      BOOST_CHECK_EQUAL( removed_count, 0u );
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
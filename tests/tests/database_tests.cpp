@@ -27,9 +27,15 @@
 #include <graphene/chain/database.hpp>
 
 #include <graphene/chain/account_object.hpp>
+#include <graphene/chain/witness_object.hpp>
+#include <../omnibazaar/reputation_vote_object.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
 
+#include <fstream>
+
 #include "../common/database_fixture.hpp"
 
 using namespace graphene::chain;
@@ -111,4 +117,207 @@ BOOST_AUTO_TEST_CASE( merge_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( packed_undo_test )
+{
+   try {
+      database db;
+      db._undo_db.set_packed_values( true );
+      db._undo_db.disable();
+      const auto& bal_obj1 = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.balance = 42;
+      });
+      const auto& bal_obj2 = db.create<account_balance_object>( [&]( account_balance_object& obj ){
+          obj.balance = 43;
+      });
+      const auto id1 = bal_obj1.id;
+      const auto id2 = bal_obj2.id;
+      db._undo_db.enable();
+
+      auto ses = db._undo_db.start_undo_session();
+      db.modify( bal_obj1, [&]( account_balance_object& obj ){
+          obj.balance = 1;
+      });
+      db.remove( bal_obj2 );
+
+      BOOST_CHECK( db._undo_db.head().old_values.at( id1 ).is_packed() );
+      BOOST_CHECK( db._undo_db.head().removed.at( id2 ).is_packed() );
+      const auto usage = db._undo_db.get_memory_usage();
+      BOOST_REQUIRE_EQUAL( usage.size(), 1u );
+      BOOST_CHECK_EQUAL( usage.back().objects, 2u );
+      BOOST_CHECK_EQUAL( usage.back().types.size(), 1u );
+      BOOST_CHECK( usage.back().bytes > 0 );
+
+      ses.undo();
+
+      BOOST_CHECK_EQUAL( 42, db.get<account_balance_object>( id1 ).balance.value );
+      BOOST_CHECK_EQUAL( 43, db.get<account_balance_object>( id2 ).balance.value );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( snapshot_format_test )
+{
+   try {
+      ACTORS((alice)(bob)(carol));
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path snapshot = data_dir.path() / "accounts";
+      const auto& accounts = db.get_index_type<account_index>();
+
+      graphene::db::object_database saved_db;
+      auto saved = saved_db.add_index< primary_index<account_index> >();
+      for( const account_object& a : accounts.indices() )
+      {
+         account_object copy = a;
+         saved->insert( std::move(copy) );
+      }
+      saved->set_next_id( accounts.get_next_id() );
+      saved->save( snapshot );
+
+      // save and reopen
+      {
+         graphene::db::object_database opened_db;
+         auto opened = opened_db.add_index< primary_index<account_index> >();
+         opened->open( snapshot );
+         BOOST_CHECK_EQUAL( opened->indices().size(), accounts.indices().size() );
+         BOOST_CHECK( opened->get_next_id() == accounts.get_next_id() );
+         BOOST_CHECK( opened->hash() == accounts.hash() );
+         BOOST_CHECK( static_cast<const account_object&>( opened->get( alice_id ) ).name == "alice" );
+      }
+
+      // corrupted chunk is rejected
+      {
+         std::vector<char> data( fc::file_size( snapshot ) );
+         {
+            std::ifstream in( snapshot.generic_string(), std::ifstream::binary );
+            in.read( data.data(), data.size() );
+         }
+         // magic, format version, next id and version hash are followed by the first chunk header
+         const size_t first_chunk = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(fc::sha256)
+                                  + sizeof(graphene::db::snapshot_chunk_header);
+         BOOST_REQUIRE( data.size() > first_chunk );
+         data[first_chunk] ^= 0x01;
+         const fc::path corrupted = data_dir.path() / "corrupted";
+         {
+            std::ofstream out( corrupted.generic_string(), std::ofstream::binary );
+            out.write( data.data(), data.size() );
+         }
+
+         graphene::db::object_database opened_db;
+         auto opened = opened_db.add_index< primary_index<account_index> >();
+         GRAPHENE_REQUIRE_THROW( opened->open( corrupted ), fc::exception );
+      }
+
+      // snapshot written in the format before GDBSNAP2 is imported
+      {
+         const fc::path legacy = data_dir.path() / "legacy";
+         {
+            std::ofstream out( legacy.generic_string(), std::ofstream::binary );
+            fc::raw::pack( out, accounts.get_next_id() );
+            fc::raw::pack( out, fc::sha256::hash( std::string("1.0") ) );
+            for( const account_object& a : accounts.indices() )
+               fc::raw::pack( out, fc::raw::pack( a ) );
+         }
+
+         graphene::db::object_database opened_db;
+         auto opened = opened_db.add_index< primary_index<account_index> >();
+         opened->open( legacy );
+         BOOST_CHECK_EQUAL( opened->indices().size(), accounts.indices().size() );
+         BOOST_CHECK( opened->get_next_id() == accounts.get_next_id() );
+         BOOST_CHECK( opened->hash() == accounts.hash() );
+
+         // and written back in the new format
+         const fc::path converted = data_dir.path() / "converted";
+         opened->save( converted );
+         graphene::db::object_database converted_db;
+         auto reopened = converted_db.add_index< primary_index<account_index> >();
+         reopened->open( converted );
+         BOOST_CHECK( reopened->hash() == accounts.hash() );
+      }
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( implicit_escrows )
+{
+   try {
+      ACTORS( (alice)(activew)(votedw)(rated)(unrated)(notescrow) );
+
+      for( const account_id_type id : { activew_id, votedw_id, rated_id, unrated_id } )
+         db.modify( id(db), []( account_object& a ) { a.is_an_escrow = true; } );
+
+      // notescrow qualifies for every rule, but is not an escrow
+      const witness_id_type active_witness = create_witness( activew ).id;
+      const witness_id_type voted_witness = create_witness( votedw ).id;
+      const witness_id_type notescrow_witness = create_witness( notescrow ).id;
+      db.modify( db.get_global_properties(), [&]( global_property_object& p ) {
+         p.active_witnesses.insert( active_witness );
+         p.active_witnesses.insert( notescrow_witness );
+      });
+      db.modify( alice, [&]( account_object& a ) {
+         a.options.votes.insert( voted_witness(db).vote_id );
+         a.options.votes.insert( notescrow_witness(db).vote_id );
+      });
+
+      const auto rate = [&]( account_id_type voter, account_id_type target, uint16_t reputation ) {
+         db.create<omnibazaar::reputation_vote_object>( [&]( omnibazaar::reputation_vote_object& v ) {
+            v.voter = voter;
+            v.target = target;
+            v.reputation = reputation;
+         });
+      };
+      rate( alice_id, rated_id, OMNIBAZAAR_REPUTATION_MAX );
+      rate( alice_id, unrated_id, OMNIBAZAAR_REPUTATION_DEFAULT );
+      rate( alice_id, notescrow_id, OMNIBAZAAR_REPUTATION_MAX );
+      // rating given by another account does not count
+      rate( rated_id, unrated_id, OMNIBAZAAR_REPUTATION_MAX );
+
+      const vector<account_id_type> candidates = { alice_id, activew_id, votedw_id, rated_id, unrated_id, notescrow_id,
+                                                   GRAPHENE_COMMITTEE_ACCOUNT };
+      const auto check_rules = [&]( bool active, bool voted, bool positive, const set<account_id_type>& expected ) {
+         db.modify( alice, [&]( account_object& a ) {
+            a.implicit_escrow_options.active_witness = active;
+            a.implicit_escrow_options.voted_witness = voted;
+            a.implicit_escrow_options.positive_rating = positive;
+         });
+
+         const set<account_id_type> escrows = db.get_implicit_escrows( alice_id );
+         for( const account_id_type& escrow : expected )
+            BOOST_CHECK( escrows.count( escrow ) == 1 );
+         // block processing uses is_implicit_escrow(), it must accept exactly the escrows listed to users
+         for( const account_id_type& candidate : candidates )
+            BOOST_CHECK_EQUAL( db.is_implicit_escrow( alice_id, candidate ), escrows.count( candidate ) == 1 );
+         BOOST_CHECK( escrows.count( notescrow_id ) == 0 );
+         BOOST_CHECK( escrows.count( unrated_id ) == 0 );
+      };
+
+      check_rules( false, false, false, {} );
+      check_rules( true, false, false, { activew_id } );
+      check_rules( false, true, false, { votedw_id } );
+      check_rules( false, false, true, { rated_id } );
+      check_rules( true, true, false, { activew_id, votedw_id } );
+      check_rules( true, false, true, { activew_id, rated_id } );
+      check_rules( false, true, true, { votedw_id, rated_id } );
+      check_rules( true, true, true, { activew_id, votedw_id, rated_id } );
+
+      // active witness which is also voted for is found by either rule
+      db.modify( alice, [&]( account_object& a ) { a.options.votes.insert( active_witness(db).vote_id ); } );
+      check_rules( false, true, false, { activew_id, votedw_id } );
+
+      // and accounts which stop being escrows are not accepted by any rule
+      db.modify( activew_id(db), []( account_object& a ) { a.is_an_escrow = false; } );
+      check_rules( true, true, true, { votedw_id, rated_id } );
+      BOOST_CHECK( !db.is_implicit_escrow( alice_id, activew_id ) );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
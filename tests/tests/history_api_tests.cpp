@@ -33,6 +33,7 @@
 #include <graphene/chain/committee_member_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
 #include <graphene/chain/market_object.hpp>
+#include <../omnibazaar/listing_object.hpp>
 
 #include <graphene/utilities/tempdir.hpp>
 
@@ -134,4 +135,154 @@ BOOST_AUTO_TEST_CASE(get_account_history_operations) {
    }
 }
 
+BOOST_AUTO_TEST_CASE(get_account_history_operations_range) {
+   try {
+      graphene::app::history_api hist_api(app);
+
+      create_account("bob");
+      ACTORS((alice));
+      const asset_id_type test_asset = create_user_issued_asset("HISTTEST").id;
+
+      // Transfers to alice alternate with her orders: T1, O1, T2, O2, T3, O3
+      for( int i = 0; i < 3; ++i )
+      {
+         transfer(account_id_type(), alice_id, asset(1000));
+         BOOST_REQUIRE( create_sell_order(alice_id, asset(10), asset(10, test_asset)) != nullptr );
+      }
+      generate_block();
+      fc::usleep(fc::milliseconds(2000));
+
+      int transfer_op_id = operation::tag<transfer_operation>::value;
+      int order_op_id = operation::tag<limit_order_create_operation>::value;
+      const operation_history_id_type none;
+
+      const vector<operation_history_object> transfers = hist_api.get_account_history_operations(alice_id, transfer_op_id, none, none, 100);
+      const vector<operation_history_object> orders = hist_api.get_account_history_operations(alice_id, order_op_id, none, none, 100);
+      BOOST_REQUIRE_EQUAL(transfers.size(), 3);
+      BOOST_REQUIRE_EQUAL(orders.size(), 3);
+      BOOST_CHECK(transfers[0].id > orders[1].id && orders[1].id > transfers[1].id);
+      BOOST_CHECK(transfers[1].id > orders[2].id && orders[2].id > transfers[2].id);
+
+      const auto ids = [](const vector<operation_history_object>& histories) {
+         vector<object_id_type> result;
+         for( const auto& h : histories )
+            result.push_back(h.id);
+         return result;
+      };
+
+      // Start is inclusive, and may be an operation of another type
+      vector<operation_history_object> histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, transfers[1].id, none, 100);
+      BOOST_CHECK(ids(histories) == vector<object_id_type>({ transfers[1].id, transfers[2].id }));
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, orders[1].id, none, 100);
+      BOOST_CHECK(ids(histories) == vector<object_id_type>({ transfers[1].id, transfers[2].id }));
+
+      // Stop is exclusive, and may be an operation of another type
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, none, transfers[2].id, 100);
+      BOOST_CHECK(ids(histories) == vector<object_id_type>({ transfers[0].id, transfers[1].id }));
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, none, orders[2].id, 100);
+      BOOST_CHECK(ids(histories) == vector<object_id_type>({ transfers[0].id, transfers[1].id }));
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, transfers[1].id, transfers[2].id, 100);
+      BOOST_CHECK(ids(histories) == vector<object_id_type>({ transfers[1].id }));
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, transfers[1].id, transfers[1].id, 100);
+      BOOST_CHECK_EQUAL(histories.size(), 0);
+
+      // Start before the first operation of the account
+      const operation_history_id_type bob_create = hist_api.get_account_history(get_account("bob").id, none, 100, none).back().id;
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, bob_create, none, 100);
+      BOOST_CHECK_EQUAL(histories.size(), 0);
+
+      // Limit is applied after start and stop
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, none, none, 2);
+      BOOST_CHECK(ids(histories) == vector<object_id_type>({ transfers[0].id, transfers[1].id }));
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, transfers[1].id, none, 1);
+      BOOST_CHECK(ids(histories) == vector<object_id_type>({ transfers[1].id }));
+      histories = hist_api.get_account_history_operations(alice_id, transfer_op_id, none, none, 0);
+      BOOST_CHECK_EQUAL(histories.size(), 0);
+      GRAPHENE_REQUIRE_THROW(hist_api.get_account_history_operations(alice_id, transfer_op_id, none, none, 101), fc::exception);
+
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(get_purchase_and_sale_history) {
+   try {
+      graphene::app::history_api hist_api(app);
+
+      ACTORS((buyer)(seller)(publisher));
+      transfer(account_id_type(), buyer_id, asset(100000));
+      transfer(account_id_type(), seller_id, asset(100000));
+      make_publisher(publisher);
+
+      // Purchases alternate with transfers that are not sales: P1, T1, P2, T2, P3, T3
+      vector<listing_id_type> listings;
+      for( int i = 0; i < 3; ++i )
+      {
+         listings.push_back(create_listing(seller, publisher, asset(100)).id);
+
+         transfer_operation purchase;
+         purchase.from = buyer_id;
+         purchase.to = seller_id;
+         purchase.amount = asset(100);
+         purchase.listing = listings.back();
+         purchase.listing_count = 1;
+         purchase.ob_fee = purchase.calculate_omnibazaar_fee(db);
+         trx.operations.push_back(purchase);
+         for( auto& op : trx.operations ) db.current_fee_schedule().set_fee(op);
+         set_expiration(db, trx);
+         PUSH_TX(db, trx, ~0);
+         trx.clear();
+
+         transfer(buyer_id, seller_id, asset(10));
+      }
+      generate_block();
+      fc::usleep(fc::milliseconds(2000));
+
+      const operation_history_id_type none;
+      const vector<operation_history_object> purchases = hist_api.get_purchase_history(buyer_id, none, none, 100);
+      BOOST_REQUIRE_EQUAL(purchases.size(), 3);
+      for( size_t i = 0; i < purchases.size(); ++i )
+         BOOST_CHECK(*purchases[i].op.get<transfer_operation>().listing == listings[2 - i]);
+      const vector<operation_history_object> transfers = hist_api.get_account_history_operations(
+               buyer_id, operation::tag<transfer_operation>::value, none, none, 100);
+      BOOST_REQUIRE_EQUAL(transfers.size(), 6);
+
+      const auto ids = [](const vector<operation_history_object>& histories) {
+         vector<object_id_type> result;
+         for( const auto& h : histories )
+            result.push_back(h.id);
+         return result;
+      };
+
+      // The same operations are sales of the seller, and neither account has the other role
+      BOOST_CHECK(ids(hist_api.get_sale_history(seller_id, none, none, 100)) == ids(purchases));
+      BOOST_CHECK_EQUAL(hist_api.get_sale_history(buyer_id, none, none, 100).size(), 0);
+      BOOST_CHECK_EQUAL(hist_api.get_purchase_history(seller_id, none, none, 100).size(), 0);
+
+      // Start is inclusive, stop is exclusive, both may be operations which are not sales
+      BOOST_CHECK(ids(hist_api.get_purchase_history(buyer_id, purchases[1].id, none, 100))
+                  == vector<object_id_type>({ purchases[1].id, purchases[2].id }));
+      BOOST_CHECK(ids(hist_api.get_purchase_history(buyer_id, transfers[2].id, none, 100))
+                  == vector<object_id_type>({ purchases[1].id, purchases[2].id }));
+      BOOST_CHECK(ids(hist_api.get_sale_history(seller_id, none, purchases[2].id, 100))
+                  == vector<object_id_type>({ purchases[0].id, purchases[1].id }));
+      BOOST_CHECK(ids(hist_api.get_sale_history(seller_id, none, transfers[4].id, 100))
+                  == vector<object_id_type>({ purchases[0].id, purchases[1].id }));
+      BOOST_CHECK(ids(hist_api.get_sale_history(seller_id, purchases[0].id, purchases[1].id, 100))
+                  == vector<object_id_type>({ purchases[0].id }));
+
+      // Limit
+      BOOST_CHECK(ids(hist_api.get_purchase_history(buyer_id, none, none, 1)) == vector<object_id_type>({ purchases[0].id }));
+      BOOST_CHECK(ids(hist_api.get_sale_history(seller_id, purchases[1].id, none, 1)) == vector<object_id_type>({ purchases[1].id }));
+      BOOST_CHECK_EQUAL(hist_api.get_purchase_history(buyer_id, none, none, 0).size(), 0);
+      GRAPHENE_REQUIRE_THROW(hist_api.get_purchase_history(buyer_id, none, none, 101), fc::exception);
+      GRAPHENE_REQUIRE_THROW(hist_api.get_sale_history(seller_id, none, none, 101), fc::exception);
+
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
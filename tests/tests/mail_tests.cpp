@@ -0,0 +1,497 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <mail_object.hpp>
+#include <mail_sender.hpp>
+#include <mail_storage.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/reflect/variant.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+using namespace omnibazaar;
+using graphene::net::peer_connection;
+using graphene::net::peer_connection_ptr;
+
+namespace {
+
+mail_object make_mail( const std::string& uuid, const std::string& recipient, const std::string& body = "body" )
+{
+   mail_object mail;
+   mail.uuid = uuid;
+   mail.sender = "sender";
+   mail.recipient = recipient;
+   mail.subject = "subject " + uuid;
+   mail.body = body;
+   mail.creation_time = 1000;
+   return mail;
+}
+
+std::vector<std::string> sorted( std::vector<std::string> values )
+{
+   std::sort( values.begin(), values.end() );
+   return values;
+}
+
+std::vector<std::string> uuids( const std::vector<mail_object>& mails )
+{
+   std::vector<std::string> result;
+   for( const mail_object& mail : mails )
+      result.push_back( mail.uuid );
+   return sorted( result );
+}
+
+// Checks state left by store_changes().
+void check_changes( const mail_storage& storage )
+{
+   BOOST_CHECK( sorted( storage.get_pending_mails() ) == std::vector<std::string>({ "a", "d" }) );
+   BOOST_CHECK( storage.get_received_mails() == std::vector<std::string>({ "b" }) );
+   BOOST_CHECK( uuids( storage.get_mails_by_receiver( "bob" ) ) == std::vector<std::string>({ "a" }) );
+   BOOST_CHECK( uuids( storage.get_mails_by_receiver( "carol" ) ) == std::vector<std::string>({ "d" }) );
+   BOOST_REQUIRE( storage.get_pending_mail( "a" ).valid() );
+   BOOST_CHECK_EQUAL( storage.get_pending_mail( "a" )->body, "body a" );
+   BOOST_CHECK_EQUAL( storage.get_pending_mail( "d" )->subject, "subject d" );
+   BOOST_CHECK( !storage.get_pending_mail( "b" ).valid() );
+   BOOST_CHECK( !storage.get_pending_mail( "c" ).valid() );
+}
+
+void store_changes( mail_storage& storage )
+{
+   storage.store( make_mail( "a", "bob", "body a" ) );
+   storage.store( make_mail( "b", "bob" ) );
+   storage.store( make_mail( "c", "carol" ) );
+   storage.set_received( "b" );
+   storage.remove( "c" );
+   storage.store( make_mail( "d", "carol" ) );
+}
+
+typedef graphene::net::detail::concurrent_unordered_set<peer_connection_ptr> peer_set;
+
+// Keeps messages instead of sending them to peers.
+class test_mail_sender : public mail_sender
+{
+public:
+   test_mail_sender( const peer_set& peers ) : mail_sender( peers ) {}
+
+   // Returns and forgets messages of type T sent to specified peer.
+   template<typename T>
+   std::vector<T> take( const peer_connection_ptr& peer )
+   {
+      std::vector<T> result;
+      for( auto itr = sent.begin(); itr != sent.end(); )
+      {
+         if( itr->first == peer.get() && itr->second.msg_type == T::type )
+         {
+            result.push_back( itr->second.as<T>() );
+            itr = sent.erase( itr );
+         }
+         else
+            ++itr;
+      }
+      return result;
+   }
+
+   std::vector<std::pair<peer_connection*, graphene::net::message>> sent;
+
+protected:
+   void send_message( peer_connection& peer, const graphene::net::message& msg ) override
+   {
+      sent.emplace_back( &peer, msg );
+   }
+};
+
+peer_connection_ptr add_peer( peer_set& peers, bool supports_mail_inventory = true )
+{
+   peer_connection_ptr peer = peer_connection::make_shared( nullptr );
+   peer->supports_mail_inventory = supports_mail_inventory;
+   peers.insert( peer );
+   return peer;
+}
+
+std::vector<std::string> fetched( test_mail_sender& sender, const peer_connection_ptr& peer )
+{
+   std::vector<std::string> result;
+   for( const graphene::net::mail_fetch_message& msg : sender.take<graphene::net::mail_fetch_message>( peer ) )
+      result.push_back( msg.mail_uuid );
+   return result;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(mail_tests)
+
+BOOST_AUTO_TEST_CASE( mail_storage_reopen )
+{
+   fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+   {
+      mail_storage storage( dir.path() );
+      store_changes( storage );
+      check_changes( storage );
+   }
+   BOOST_CHECK( fc::exists( dir.path() / "mails.log" ) );
+   BOOST_CHECK( fc::exists( dir.path() / "mails.index" ) );
+   {
+      mail_storage storage( dir.path() );
+      check_changes( storage );
+
+      // changes made after reopening are kept as well
+      storage.set_received( "a" );
+      storage.remove( "b" );
+   }
+   // without index, all records are replayed
+   fc::remove( dir.path() / "mails.index" );
+   {
+      mail_storage storage( dir.path() );
+      BOOST_CHECK( storage.get_pending_mails() == std::vector<std::string>({ "d" }) );
+      BOOST_CHECK( storage.get_received_mails() == std::vector<std::string>({ "a" }) );
+      BOOST_CHECK( storage.get_mails_by_receiver( "bob" ).empty() );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( mail_storage_incomplete_record )
+{
+   fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+   const fc::path log_path = dir.path() / "mails.log";
+   uint64_t complete_size = 0;
+   {
+      mail_storage storage( dir.path() );
+      store_changes( storage );
+   }
+   complete_size = fc::file_size( log_path );
+
+   // garbage after the last record described by index, as if node stopped in the middle of a write
+   {
+      std::ofstream out( log_path.generic_string(), std::ios::binary | std::ios::app );
+      out.write( "\x40\x00\x00\x00garbage", 11 );
+   }
+   {
+      mail_storage storage( dir.path() );
+      check_changes( storage );
+      BOOST_CHECK_EQUAL( fc::file_size( log_path ), complete_size );
+   }
+
+   // last record cut in half, index now describes more of the log than there is
+   {
+      mail_storage storage( dir.path() );
+      storage.store( make_mail( "e", "dave" ) );
+   }
+   fc::resize_file( log_path, fc::file_size( log_path ) - 10 );
+   {
+      mail_storage storage( dir.path() );
+      check_changes( storage );
+      BOOST_CHECK( !storage.get_pending_mail( "e" ).valid() );
+      BOOST_CHECK_EQUAL( fc::file_size( log_path ), complete_size );
+
+      // new records are appended in place of the dropped one
+      storage.store( make_mail( "f", "dave" ) );
+   }
+   {
+      mail_storage storage( dir.path() );
+      BOOST_CHECK( uuids( storage.get_mails_by_receiver( "dave" ) ) == std::vector<std::string>({ "f" }) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( mail_storage_stale_index )
+{
+   fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+   const fc::path index_path = dir.path() / "mails.index";
+   const fc::path old_index_path = dir.path() / "old.index";
+   {
+      mail_storage storage( dir.path() );
+      storage.store( make_mail( "a", "bob", "body a" ) );
+      storage.store( make_mail( "b", "bob" ) );
+   }
+   fc::copy( index_path, old_index_path );
+   {
+      mail_storage storage( dir.path() );
+      storage.store( make_mail( "c", "carol" ) );
+      storage.set_received( "b" );
+      storage.remove( "c" );
+      storage.store( make_mail( "d", "carol" ) );
+   }
+
+   // index saved earlier only covers the beginning of the log, the rest is replayed
+   fc::remove( index_path );
+   fc::copy( old_index_path, index_path );
+   {
+      mail_storage storage( dir.path() );
+      check_changes( storage );
+   }
+
+   // index of another log is not used
+   fc::temp_directory other_dir( graphene::utilities::temp_directory_path() );
+   {
+      mail_storage other( other_dir.path() );
+      other.store( make_mail( "x", "bob" ) );
+   }
+   fc::remove( index_path );
+   fc::copy( other_dir.path() / "mails.index", index_path );
+   {
+      mail_storage storage( dir.path() );
+      check_changes( storage );
+   }
+
+   // corrupted index is rebuilt
+   {
+      std::ofstream out( index_path.generic_string(), std::ios::binary | std::ios::trunc );
+      out.write( "\xff\xff\xff", 3 );
+   }
+   {
+      mail_storage storage( dir.path() );
+      check_changes( storage );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( mail_storage_compaction )
+{
+   fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+   const fc::path log_path = dir.path() / "mails.log";
+   const std::string large_body( 1024 * 1024, 'x' );
+   {
+      mail_storage storage( dir.path() );
+      storage.store( make_mail( "a", "bob", "body a" ) );
+      storage.store( make_mail( "b", "carol", "body b" ) );
+      storage.set_received( "b" );
+
+      // bodies of delivered mails are wasted space, log is compacted once they take 16 MiB
+      for( int i = 0; i < 16; ++i )
+      {
+         const std::string uuid = "large" + std::to_string( i );
+         storage.store( make_mail( uuid, "dave", large_body ) );
+         storage.set_received( uuid );
+      }
+      storage.store( make_mail( "c", "dave", large_body ) );
+      BOOST_CHECK_LT( fc::file_size( log_path ), 2 * large_body.size() );
+
+      BOOST_CHECK( sorted( storage.get_pending_mails() ) == std::vector<std::string>({ "a", "c" }) );
+      BOOST_CHECK_EQUAL( storage.get_received_mails().size(), 17 );
+      BOOST_REQUIRE( storage.get_pending_mail( "a" ).valid() );
+      BOOST_CHECK_EQUAL( storage.get_pending_mail( "a" )->body, "body a" );
+      BOOST_REQUIRE( storage.get_pending_mail( "c" ).valid() );
+      BOOST_CHECK( storage.get_pending_mail( "c" )->body == large_body );
+
+      storage.set_received( "a" );
+   }
+   {
+      mail_storage storage( dir.path() );
+      BOOST_CHECK( storage.get_pending_mails() == std::vector<std::string>({ "c" }) );
+      BOOST_CHECK_EQUAL( storage.get_received_mails().size(), 18 );
+      BOOST_CHECK( uuids( storage.get_mails_by_receiver( "dave" ) ) == std::vector<std::string>({ "c" }) );
+   }
+   // offsets of records in compacted log are also valid when they are replayed
+   fc::remove( dir.path() / "mails.index" );
+   {
+      mail_storage storage( dir.path() );
+      BOOST_REQUIRE( storage.get_pending_mail( "c" ).valid() );
+      BOOST_CHECK( storage.get_pending_mail( "c" )->body == large_body );
+      BOOST_CHECK_EQUAL( storage.get_received_mails().size(), 18 );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( mail_storage_legacy_import )
+{
+   fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+   const fc::path undelivered = dir.path() / "undelivered";
+   const fc::path delivered = dir.path() / "delivered";
+   fc::create_directories( undelivered );
+   fc::create_directories( delivered );
+   fc::json::save_to_file( make_mail( "a", "bob", "body a" ), undelivered / "a" );
+   fc::json::save_to_file( make_mail( "b", "bob" ), delivered / "b" );
+   {
+      std::ofstream out( ( undelivered / "broken" ).generic_string() );
+      out << "{ \"uuid\": ";
+   }
+
+   {
+      mail_storage storage( dir.path() );
+      BOOST_CHECK( storage.get_pending_mails() == std::vector<std::string>({ "a" }) );
+      BOOST_CHECK( storage.get_received_mails() == std::vector<std::string>({ "b" }) );
+      BOOST_REQUIRE( storage.get_pending_mail( "a" ).valid() );
+      BOOST_CHECK_EQUAL( storage.get_pending_mail( "a" )->body, "body a" );
+   }
+
+   // imported files are deleted, the file which could not be read is kept
+   BOOST_CHECK( !fc::exists( delivered ) );
+   BOOST_CHECK( !fc::exists( undelivered / "a" ) );
+   BOOST_CHECK( fc::exists( undelivered / "broken" ) );
+
+   {
+      mail_storage storage( dir.path() );
+      BOOST_CHECK( storage.get_pending_mails() == std::vector<std::string>({ "a" }) );
+      BOOST_CHECK( storage.get_received_mails() == std::vector<std::string>({ "b" }) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( mail_sender_subscription )
+{
+   using namespace graphene::net;
+   peer_set peers;
+   const peer_connection_ptr alice_node = add_peer( peers );
+   const peer_connection_ptr bob_node = add_peer( peers );
+   const peer_connection_ptr old_node = add_peer( peers, false );
+   test_mail_sender sender( peers );
+
+   // subscriptions are advertised to all peers once
+   sender.set_subscribed( "dave", true );
+   sender.set_subscribed( "dave", true );
+   for( const peer_connection_ptr& peer : { alice_node, bob_node, old_node } )
+   {
+      const std::vector<mail_subscription_message> messages = sender.take<mail_subscription_message>( peer );
+      BOOST_REQUIRE_EQUAL( messages.size(), 1 );
+      BOOST_CHECK( messages[0].subscribed == std::vector<std::string>({ "dave" }) );
+      BOOST_CHECK( messages[0].unsubscribed.empty() );
+   }
+   sender.set_subscribed( "dave", false );
+   const std::vector<mail_subscription_message> messages = sender.take<mail_subscription_message>( alice_node );
+   BOOST_REQUIRE_EQUAL( messages.size(), 1 );
+   BOOST_CHECK( messages[0].unsubscribed == std::vector<std::string>({ "dave" }) );
+   sender.sent.clear();
+
+   // newly connected peer gets current subscriptions
+   sender.set_subscribed( "erin", true );
+   sender.sent.clear();
+   const peer_connection_ptr new_node = add_peer( peers );
+   sender.on_peer_connected( new_node );
+   const std::vector<mail_subscription_message> current = sender.take<mail_subscription_message>( new_node );
+   BOOST_REQUIRE_EQUAL( current.size(), 1 );
+   BOOST_CHECK( current[0].subscribed == std::vector<std::string>({ "erin" }) );
+
+   // subscriptions of peers are tracked
+   sender.on_subscription( alice_node.get(), mail_subscription_message( { "alice", "carol" }, {} ) );
+   sender.on_subscription( bob_node.get(), mail_subscription_message( { "bob" }, {} ) );
+   sender.on_subscription( alice_node.get(), mail_subscription_message( {}, { "carol" } ) );
+   BOOST_CHECK( alice_node->mail_subscribers.count( "alice" ) == 1 );
+   BOOST_CHECK( alice_node->mail_subscribers.count( "carol" ) == 0 );
+
+   // mails are announced to all peers, peers without announcements get the mail right away
+   sender.send( make_mail( "a", "alice" ) );
+   for( const peer_connection_ptr& peer : { alice_node, bob_node, new_node } )
+   {
+      const std::vector<mail_inventory_message> inventory = sender.take<mail_inventory_message>( peer );
+      BOOST_REQUIRE_EQUAL( inventory.size(), 1 );
+      BOOST_CHECK_EQUAL( inventory[0].mail_uuid, "a" );
+      BOOST_CHECK_EQUAL( inventory[0].recipient, "alice" );
+   }
+   const std::vector<mail_message> pushed = sender.take<mail_message>( old_node );
+   BOOST_REQUIRE_EQUAL( pushed.size(), 1 );
+   BOOST_CHECK_EQUAL( pushed[0].mail.uuid, "a" );
+   BOOST_CHECK( sender.sent.empty() );
+
+   // with targeted routing, only to peers where recipient is subscribed, if there are any
+   sender.set_targeted_routing( true );
+   sender.send( make_mail( "b", "alice" ) );
+   BOOST_CHECK_EQUAL( sender.take<mail_inventory_message>( alice_node ).size(), 1 );
+   BOOST_CHECK( sender.sent.empty() );
+   sender.send( make_mail( "c", "carol" ) );
+   BOOST_CHECK_EQUAL( sender.sent.size(), 4 );
+}
+
+BOOST_AUTO_TEST_CASE( mail_sender_fetch )
+{
+   using namespace graphene::net;
+   peer_set peers;
+   const peer_connection_ptr sending_node = add_peer( peers );
+   const peer_connection_ptr receiving_node = add_peer( peers );
+   test_mail_sender sender( peers );
+
+   sender.send( make_mail( "a", "bob", "body a" ) );
+   sender.sent.clear();
+
+   sender.on_fetch( receiving_node.get(), mail_fetch_message( "a" ) );
+   const std::vector<mail_message> mails = sender.take<mail_message>( receiving_node );
+   BOOST_REQUIRE_EQUAL( mails.size(), 1 );
+   BOOST_CHECK_EQUAL( mails[0].mail.body, "body a" );
+
+   // unknown mails and mails confirmed by receiver are not sent
+   sender.on_fetch( receiving_node.get(), mail_fetch_message( "b" ) );
+   BOOST_CHECK( sender.sent.empty() );
+   sender.send_confirm_received( "a" );
+   sender.sent.clear();
+   sender.on_fetch( receiving_node.get(), mail_fetch_message( "a" ) );
+   BOOST_CHECK( sender.sent.empty() );
+}
+
+BOOST_AUTO_TEST_CASE( mail_sender_inventory )
+{
+   using namespace graphene::net;
+   peer_set peers;
+   const peer_connection_ptr first = add_peer( peers );
+   const peer_connection_ptr second = add_peer( peers );
+   const peer_connection_ptr third = add_peer( peers );
+   test_mail_sender sender( peers );
+
+   // mails are not requested until recipient subscribes on this node
+   sender.on_inventory( first.get(), mail_inventory_message( "a", "bob" ) );
+   BOOST_CHECK( sender.sent.empty() );
+   sender.set_subscribed( "bob", true );
+   sender.sent.clear();
+
+   // mail is requested from the first peer that announced it only
+   sender.on_inventory( first.get(), mail_inventory_message( "a", "bob" ) );
+   sender.on_inventory( second.get(), mail_inventory_message( "a", "bob" ) );
+   BOOST_CHECK( fetched( sender, first ) == std::vector<std::string>({ "a" }) );
+   BOOST_CHECK( sender.sent.empty() );
+
+   // requested mail is accepted once, later copies are ignored
+   BOOST_CHECK( sender.on_mail( make_mail( "a", "bob" ) ) );
+   BOOST_CHECK( !sender.on_mail( make_mail( "a", "bob" ) ) );
+   sender.on_inventory( third.get(), mail_inventory_message( "a", "bob" ) );
+   BOOST_CHECK( sender.sent.empty() );
+
+   // when request times out, mail is requested from the next peer that announced it
+   sender.on_inventory( first.get(), mail_inventory_message( "b", "bob" ) );
+   sender.on_inventory( second.get(), mail_inventory_message( "b", "bob" ) );
+   BOOST_CHECK( fetched( sender, first ) == std::vector<std::string>({ "b" }) );
+   sender.check_requests();
+   BOOST_CHECK( sender.sent.empty() );
+   sender.check_requests( fc::time_point::now() + fc::minutes(1) );
+   BOOST_CHECK( fetched( sender, second ) == std::vector<std::string>({ "b" }) );
+   BOOST_CHECK( sender.sent.empty() );
+
+   // when no other peer announced it, request is dropped and the next announcement is accepted
+   sender.check_requests( fc::time_point::now() + fc::minutes(1) );
+   BOOST_CHECK( sender.sent.empty() );
+   sender.on_inventory( third.get(), mail_inventory_message( "b", "bob" ) );
+   BOOST_CHECK( fetched( sender, third ) == std::vector<std::string>({ "b" }) );
+   BOOST_CHECK( sender.on_mail( make_mail( "b", "bob" ) ) );
+
+   // when requested peer disconnects, mail is requested from the next connected peer that announced it
+   sender.on_inventory( first.get(), mail_inventory_message( "c", "bob" ) );
+   sender.on_inventory( second.get(), mail_inventory_message( "c", "bob" ) );
+   sender.on_inventory( third.get(), mail_inventory_message( "c", "bob" ) );
+   BOOST_CHECK( fetched( sender, first ) == std::vector<std::string>({ "c" }) );
+   peers.erase( first );
+   peers.erase( second );
+   sender.check_requests();
+   BOOST_CHECK( fetched( sender, third ) == std::vector<std::string>({ "c" }) );
+   BOOST_CHECK( sender.sent.empty() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/net/config.hpp>
+#include <graphene/net/core_messages.hpp>
+
+#include <fc/variant_object.hpp>
+
+#include <random>
+
+using namespace graphene::net;
+
+namespace {
+
+message_ptr make_raw_message( core_message_type_enum type, std::vector<char> data )
+{
+   std::shared_ptr<message> result = std::make_shared<message>();
+   result->msg_type = type;
+   result->data = std::move(data);
+   result->size = (uint32_t)result->data.size();
+   return result;
+}
+
+std::vector<char> make_compressible_data( size_t size )
+{
+   std::vector<char> data(size);
+   for( size_t i = 0; i < size; ++i )
+      data[i] = "graphene"[i % 8];
+   return data;
+}
+
+std::vector<char> make_random_data( size_t size )
+{
+   std::mt19937 generator(42);
+   std::uniform_int_distribution<int> distribution(0, 255);
+   std::vector<char> data(size);
+   for( char& c : data )
+      c = (char)distribution(generator);
+   return data;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(net_tests)
+
+BOOST_AUTO_TEST_CASE( compressed_message_round_trip )
+{
+   const message_ptr original = make_raw_message( core_message_type_enum::block_message_type, make_compressible_data( 8192 ) );
+   const message_ptr compressed = compress_message( original );
+
+   BOOST_REQUIRE_EQUAL( compressed->msg_type, (uint32_t)core_message_type_enum::compressed_message_type );
+   BOOST_CHECK_LT( compressed->size, original->size );
+
+   const compressed_message wrapper = compressed->as<compressed_message>();
+   BOOST_CHECK_EQUAL( wrapper.msg_type, (uint32_t)core_message_type_enum::block_message_type );
+   BOOST_CHECK_EQUAL( wrapper.uncompressed_size, original->size );
+
+   const message restored = decompress_message( wrapper );
+   BOOST_CHECK_EQUAL( restored.msg_type, original->msg_type );
+   BOOST_CHECK_EQUAL( restored.size, original->size );
+   BOOST_CHECK( restored.data == original->data );
+}
+
+BOOST_AUTO_TEST_CASE( compress_message_passthrough )
+{
+   // below the threshold
+   const message_ptr small = make_raw_message( core_message_type_enum::trx_message_type,
+                                               make_compressible_data( GRAPHENE_NET_COMPRESSION_THRESHOLD_BYTES - 1 ) );
+   BOOST_CHECK( compress_message( small ) == small );
+
+   // large, but of a type which is never compressed
+   const message_ptr hello = make_raw_message( core_message_type_enum::hello_message_type, make_compressible_data( 8192 ) );
+   BOOST_CHECK( compress_message( hello ) == hello );
+
+   // compressed output would not be smaller
+   const message_ptr random = make_raw_message( core_message_type_enum::trx_message_type, make_random_data( 4096 ) );
+   BOOST_CHECK( compress_message( random ) == random );
+}
+
+BOOST_AUTO_TEST_CASE( decompress_invalid_message )
+{
+   const message_ptr original = make_raw_message( core_message_type_enum::trx_message_type, make_compressible_data( 4096 ) );
+   const compressed_message valid = compress_message( original )->as<compressed_message>();
+
+   compressed_message corrupt = valid;
+   for( size_t i = 2; i < corrupt.data.size(); ++i )
+      corrupt.data[i] = ~corrupt.data[i];
+   BOOST_CHECK_THROW( decompress_message( corrupt ), fc::exception );
+
+   compressed_message truncated = valid;
+   truncated.data.resize( truncated.data.size() / 2 );
+   BOOST_CHECK_THROW( decompress_message( truncated ), fc::exception );
+
+   compressed_message oversized = valid;
+   oversized.uncompressed_size = MAX_MESSAGE_SIZE + 1;
+   BOOST_CHECK_THROW( decompress_message( oversized ), fc::exception );
+
+   compressed_message empty = valid;
+   empty.uncompressed_size = 0;
+   BOOST_CHECK_THROW( decompress_message( empty ), fc::exception );
+
+   // declared size must match the actual one
+   compressed_message wrong_size = valid;
+   wrong_size.uncompressed_size = original->size - 1;
+   BOOST_CHECK_THROW( decompress_message( wrong_size ), fc::exception );
+   wrong_size.uncompressed_size = original->size + 1;
+   BOOST_CHECK_THROW( decompress_message( wrong_size ), fc::exception );
+
+   compressed_message nested = valid;
+   nested.msg_type = core_message_type_enum::compressed_message_type;
+   BOOST_CHECK_THROW( decompress_message( nested ), fc::exception );
+}
+
+BOOST_AUTO_TEST_CASE( compression_requires_peer_support )
+{
+   // peers running older versions don't send compression in hello user data
+   BOOST_CHECK( !peer_supports_compression( fc::variant_object() ) );
+   BOOST_CHECK( !peer_supports_compression( fc::mutable_variant_object( "node_id", "0" ) ) );
+   BOOST_CHECK( !peer_supports_compression( fc::mutable_variant_object( "compression", "lz4" ) ) );
+   BOOST_CHECK( peer_supports_compression( fc::mutable_variant_object( "compression", "zlib" ) ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()